@@ -16,6 +16,20 @@
 #include <string.h>
 #include <linux/limits.h>
 #include <stdint.h>
+#include <stdarg.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <initializer_list>
+#include "logTime.h"
+#include "logQueue.h"
+#include "logFormat.h"
+#include "logLimit.h"
+#include "logStats.h"
+#include "logJson.h"
+#include "logEpoch.h"
 
 #define ASCII_LOWER_START 97
 #define ASCII_LOWER_END   122
@@ -29,20 +43,37 @@
   #define PRINT_DEBUG(...)
 #endif
 
+/// Lowest severity the LOGGER_* macros compile in, e.g. -DLOGGER_MIN_LEVEL=ELogInfo
+#ifndef LOGGER_MIN_LEVEL
+  #define LOGGER_MIN_LEVEL ELogDebug
+#endif
+
+class LogSink;
+class LogBinary;
+class LogDedup;
+class LogChild;
+class LogWatch;
+
 /// Basic struct containing constants
 typedef struct cfgLog {
 
   // Constants
   static const int   CMaxPathLen        = PATH_MAX;   ///< max path length
-  static const int   CMaxLogMsgLen      = 200;        ///< max logger line length
+  static const int   CMaxLogMsgLen      = 512;        ///< size of the stack buffers of a log line, longer lines use a per-thread arena
   static const int   CMaxPrefixLen      = 10;         ///< maximum length of the msg prefix
   static const int   CMaxSepLen         = 5;          ///< maximum length of the separator
-  static const int   CMaxPatternItems   = 10;         ///< maximum number of pattern items which may be set
+  static const int   CMaxPatternItems   = 16;         ///< maximum number of pattern items which may be set, &jsn takes 11
   static const int   CMaxPatternItemLen = 10;         ///< maximum length of a pattern item
   static const int   CMaxPatternIdLen   = 5;          ///< max length of a pattern identifier
   static const int   CMaxPatternLen     = CMaxPatternItems * CMaxPatternIdLen + 1; ///< 10*4 characters + null termination
   static const int   CMaxLogLevelStrLen = 10;
   static const int   CLogColorLen       = 15;
+  static const int   CAsyncQueueLenDefault = 4096;  ///< default number of records held by the async queue
+  static const int   CFlushBufSizeDefault  = 65536; ///< default size of the output buffer of file loggers
+  static const int   CFlushIntervalDefault = 1000;  ///< default max milliseconds between flushes in interval mode
+  static const size_t CMmapChunkSizeDefault = 64 * 1024 * 1024; ///< default chunk size of memory mapped logfiles
+  static const int   CRotateKeepDefault    = 5;     ///< default number of rotated logfiles to keep
+  static const int   CRecorderLenDefault   = 1024;  ///< default number of records the flight recorder keeps per thread
 
   static const char  CLogMsgLevel[][CMaxLogLevelStrLen]; ///< List of loglevel strings
 
@@ -54,6 +85,9 @@ typedef struct cfgLog {
 class CfgLog : public cfgLog_t {
 public:
 
+  /// Return values used by CfgLog
+  enum { EErr = 0, ENoErr };
+
   // Enums
   /// @brief Enumeration of available log levels
   typedef enum {
@@ -75,7 +109,8 @@ public:
     ELogProfileMinimal,    ///< print level and message
     ELogProfileDefault,    ///< print time, level, and message
     ELogProfileVerbose,    ///< print pid, time, level, and message
-    ELogProfileUser        ///< user-defined style
+    ELogProfileUser,       ///< user-defined style
+    ELogProfileJson        ///< print one JSON object per line with time, level, pid, tid, message and fields
   } profile_e;             ///< logstyle
 
   /// @brief Enumeration of level string casing
@@ -87,6 +122,7 @@ public:
 
   /// @brief Enumeration of available colors
   typedef enum {
+    EColorNone = 0,         ///< no color
     EColorBlack = 30,
     EColorRed,
     EColorGreen,
@@ -97,6 +133,37 @@ public:
     EColorWhite
   } color_e;                ///< terminal color values
 
+  /// @brief Enumeration of policies applied when the async queue is full
+  typedef enum {
+    EAsyncBlock = 0,        ///< block the caller until the writer has made room
+    EAsyncDrop,             ///< drop the record and count it
+    EAsyncDropLowest        ///< shed low severity records first as the queue fills up, block for error and above
+  } asyncPolicy_e;          ///< full-queue policy
+
+  /// @brief Enumeration of output flush policies
+  typedef enum {
+    EFlushRecord = 0,       ///< flush after every record
+    EFlushSeverity,         ///< flush right away on records of flushLevel and above and always msgs, buffer everything else
+    EFlushSize,             ///< flush whenever the output buffer of flushBufSize bytes is full
+    EFlushInterval          ///< flush at most flushInterval milliseconds after a record, by the next record or by a background thread
+  } flush_e;                ///< flush policy
+
+  /// @brief Enumeration of msync policies of the memory mapped backend
+  typedef enum {
+    EMsyncNever = 0,        ///< never msync, the kernel writes the pages back on its own
+    EMsyncInterval,         ///< msync at most flushInterval milliseconds after a record, like EFlushInterval
+    EMsyncSeverity          ///< msync on records of flushLevel and above and always msgs
+  } msync_e;                ///< msync policy
+
+  /// @brief Enumeration of output backends
+  typedef enum {
+    EBackendStdio = 0,      ///< buffered stdio stream
+    EBackendFd,             ///< raw file descriptor, one writev per record without intermediate copy
+    EBackendFdBatch,        ///< raw file descriptor, records coalesced into one writev per flush
+    EBackendMmap,           ///< memory mapped logfile, records are copied into the mapping (file logging only)
+    EBackendBinary          ///< binary records with deferred formatting, written like EBackendFdBatch (see LogBinary)
+  } backend_e;              ///< output backend
+
   static const level_e   CLogLevelDefault   = ELogDebug;        ///< default loglevel
   static const profile_e CLogProfileDefault = ELogProfileNone;  ///< default profile
 
@@ -106,10 +173,42 @@ public:
   bool logToFile;                 ///< enable file logging
   bool useColor;                  ///< enable colorful logging
   bool useUsrPattern;             ///< ebable user defined patterns
+  bool useAsync;                  ///< enable asynchronous logging through a background writer thread
 
-  color_e color;                  ///< if colorful logging is enabled, use specified color
+  color_e color;                  ///< if colorful logging is enabled, use specified color for levels up to error
+  color_e levelColor[ELogAlways + 1]; ///< per level color, overrides color unless EColorNone
+  bool colorAlways;               ///< keep colors when the output is not a terminal
   int  logLevelCase;              ///< print loglevel in default, lower- or uppercase
 
+  asyncPolicy_e asyncPolicy;      ///< what to do when the async queue is full
+
+  backend_e backend;              ///< how records are written to the output
+  size_t mmapChunkSize;           ///< with EBackendMmap, size of the preallocated and mapped chunks of the logfile
+  msync_e msyncMode;              ///< with EBackendMmap, when to msync the logfile, takes the place of flushMode
+
+  flush_e flushMode;              ///< when to flush the output
+  level_e flushLevel;             ///< with EFlushSeverity, flush on records of this level and above, always msgs are flushed too
+  int  flushBufSize;              ///< size of the output buffer in bytes (file logging only)
+  int  flushInterval;             ///< with EFlushInterval, max milliseconds between flushes
+  int  asyncQueueLen;             ///< number of records the async queue can hold (rounded up to a power of two)
+
+  bool   appendToFile;            ///< append to an existing logfile instead of truncating it
+  size_t rotateSize;              ///< rotate the logfile once it has grown to this many bytes, 0 to disable
+  int    rotateInterval;          ///< rotate the logfile every this many seconds (aligned to the epoch), 0 to disable
+  int    rotateKeep;              ///< number of rotated logfiles to keep (logfile.1 is the newest), 0 to keep none
+
+  int  dedupWindow;               ///< suppress exact repeats of a msg within this many milliseconds, 0 to disable
+
+  bool    useRecorder;            ///< keep msgs below the loglevel in the flight recorder, see LogRecorder
+  level_e recorderLevel;          ///< max level kept by the flight recorder
+  int     recorderLen;            ///< number of records kept per thread (rounded up to a power of two)
+  char    recorderFile[CMaxPathLen]; ///< binary logfile the recorder is written to on SIGSEGV and SIGABRT, empty to install no handler
+
+  int  statsInterval;             ///< log the counters of the Logger every this many seconds, 0 to disable, see Logger::getStats()
+
+  char configFile[CMaxPathLen];   ///< config file read by load()
+  bool watchConfig;               ///< reload configFile whenever it changes, see Logger::reload()
+
   char logfile[CMaxPathLen];      ///< path to logfile
   char prefix[CMaxPrefixLen];     ///< prefix
   char postfix[CMaxPrefixLen];    ///< postfix
@@ -133,8 +232,42 @@ public:
   /// @return a pointer to the user pattern at position nr
   char *getUsrPattern(int nr);
 
+  /// @brief Set the loglevel of a named child logger, applied by the Logger, see Logger::getChild()
+  /// @param [in] name the name of the child, e.g. net.http
+  /// @param [in] level the loglevel, replaces one set before for \a name
+  void addModuleLevel(const char *name, level_e level);
+
+  /// @brief Retrieve a module level
+  /// @param [in] idx index of the module level, starting at 0
+  /// @param [out] level the loglevel
+  /// @return the name of the module, NULL if there are fewer module levels
+  const char *getModuleLevel(int idx, level_e *level) const;
+
+  /// @brief Replace the user patterns and module levels by those of another config
+  /// @param [in] from the config to copy from
+  void copyLists(const CfgLog *from);
+
+  /// @brief Read settings from a config file
+  /// The file holds one <i>key = value</i> setting per line, keys are the names of the members,
+  /// e.g. <i>logLevel = info</i>, lines starting with # are comments. Values may be quoted to keep
+  /// blanks, quoted values take \\n, \\t, \\" and \\\\ escapes. Besides the members,
+  /// - <i>usrPattern.N</i> adds user pattern N,
+  /// - <i>logLevel.name</i> sets the level of a child logger, see addModuleLevel(),
+  /// - <i>color.level</i> sets the color of a level,
+  /// - <i>pattern</i> also selects ELogProfileUser, unless a later <i>profile</i> line says otherwise.
+  /// @param [in] path the config file, remembered in configFile
+  /// @return EErr on failure, ENoErr on success
+  /// @note On failure the settings read up to the bad line are kept, load into a fresh CfgLog to keep a config intact.
+  int load(const char *path);
+
 private:
 
+  /// @brief Apply one setting of a config file
+  /// @param [in] key the key
+  /// @param [in] value the unquoted value
+  /// @return EErr if the key is unknown or the value invalid
+  int set(const char *key, const char *value);
+
   typedef struct usrPattern {
     char pat[CMaxPatternItemLen];
     int nr;
@@ -152,19 +285,37 @@ private:
 
   UsrPattern *usrPattern;         ///< head of linked list of user patterns
 
+  typedef struct moduleLevel {
+    char *name;
+    level_e level;
+    struct moduleLevel *next;
+  } ModuleLevel;
+
+  ModuleLevel *moduleLevel;       ///< head of linked list of module levels
+
 };
 
 /// @brief Logger class
 ///
 /// The Logger provides simple API calls for configuration and logging
-/// @todo Implement log rotation (file size based or time based)
-/// @todo Implement choice between new file or append to file
+///
+/// All logging calls as well as setLevel(), setProfile(), setPattern() and addSink() may be used from
+/// any number of threads. Records are rendered into per-thread buffers without locking,
+/// only writing the finished record to the output is serialized.<br>
+/// Patterns and sinks form an immutable configuration snapshot: a record loads it once, and
+/// reconfiguration publishes a new one, freeing the replaced one through LogEpoch once no thread
+/// renders with it anymore.<br>
+/// init() and the destructor must not run concurrently with other calls.
 class Logger {
 public:
 
   /// Return values used by Logger
   enum { EErr = 0, ENoErr };
 
+  static const int CMaxSinks = 8;   ///< max number of sinks attached with addSink()
+  static const int CSinkTickMs = 50; ///< period of LogSink::tick() while sinks are attached
+  static const int CReportMs = 1000; ///< period of the reports of suppressed calls, see suppressed()
+
   /// Default constructor
   Logger();
 
@@ -206,11 +357,157 @@ public:
   /// @brief Print an always message
   void always(const char *fmt, ...);
 
+  /// @name Type-safe logging
+  /// Take a format string created by LOGGER_FMT(), checked at compile time and formatted
+  /// without printf, see LogFormat.
+  /// @code
+  /// log->info(LOGGER_FMT("user {} took {} us"), id, dt);
+  /// @endcode
+  /// @{
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type emergency(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogEmergency, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type alert(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogAlert, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type critical(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogCritical, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type error(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogError, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type warning(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogWarn, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type notice(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogNotice, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type info(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogInfo, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type debug(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogDebug, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type always(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogAlways, fmt, args...);
+  }
+  /// @}
+
+  /// @name Structured logging
+  /// Take a plain msg, not a format string, and typed key/value fields. JSON patterns render
+  /// the fields as members of the record, all other patterns append them to the msg as key=value.
+  /// @code
+  /// log->info("request served", {{"path", path}, {"status", 200}, {"ms", 1.25}});
+  /// @endcode
+  /// @{
+  void emergency(const char *msg, std::initializer_list<LogJson::field_t> fields) { logKv(CfgLog::ELogEmergency, msg, fields); }
+  void alert(const char *msg, std::initializer_list<LogJson::field_t> fields)     { logKv(CfgLog::ELogAlert, msg, fields); }
+  void critical(const char *msg, std::initializer_list<LogJson::field_t> fields)  { logKv(CfgLog::ELogCritical, msg, fields); }
+  void error(const char *msg, std::initializer_list<LogJson::field_t> fields)     { logKv(CfgLog::ELogError, msg, fields); }
+  void warning(const char *msg, std::initializer_list<LogJson::field_t> fields)   { logKv(CfgLog::ELogWarn, msg, fields); }
+  void notice(const char *msg, std::initializer_list<LogJson::field_t> fields)    { logKv(CfgLog::ELogNotice, msg, fields); }
+  void info(const char *msg, std::initializer_list<LogJson::field_t> fields)      { logKv(CfgLog::ELogInfo, msg, fields); }
+  void debug(const char *msg, std::initializer_list<LogJson::field_t> fields)     { logKv(CfgLog::ELogDebug, msg, fields); }
+  void always(const char *msg, std::initializer_list<LogJson::field_t> fields)    { logKv(CfgLog::ELogAlways, msg, fields); }
+  /// @}
+
+  /// @brief Wait until all records logged so far have been written and flushed
+  /// @note In asynchronous mode this is a barrier for the background writer,
+  ///       otherwise it simply flushes the output stream.
+  ///       Use it to drain buffered output regardless of CfgLog::flushMode.
+  void flush(void);
+
+  /// @brief Return the number of records dropped because the async queue was full
+  /// @return number of dropped records
+  uint64_t getDropCount(void);
+
+  /// @brief Check whether a message of level \a lev would be logged
+  /// @param [in] lev msg level
+  /// @return true if \a lev passes the configured loglevel or that of an attached sink
+  bool isEnabled(CfgLog::level_e lev) {
+    return (lev == CfgLog::ELogAlways) || (m_enabled.load(std::memory_order_relaxed) >= lev);
+  }
+
+  /// @brief Report calls suppressed by a rate limited or sampled call site
+  /// Logs "suppressed N lines at file:line" at level \a lev, see LOGGER_INFO_RATE() and LOGGER_INFO_SAMPLE().
+  /// @param [in] lev level of the call site
+  /// @param [in] file source file of the call site
+  /// @param [in] line source line of the call site
+  /// @param [in] cnt number of suppressed calls
+  void reportSuppressed(CfgLog::level_e lev, const char *file, int line, uint32_t cnt);
+
+  /// @brief Count a call suppressed by a rate limited or sampled call site
+  /// The first suppressed call since the last report lists the site, the timer thread reports the
+  /// calls of listed sites about every CReportMs, so a call site going quiet after a burst is reported too.
+  /// @param [in,out] site state of the call site
+  /// @param [in] lev level of the call site
+  /// @param [in] file source file of the call site
+  /// @param [in] line source line of the call site
+  void suppressed(LogLimit::site_t *site, CfgLog::level_e lev, const char *file, int line) {
+    countFiltered(lev);
+    if (!site->listed.load(std::memory_order_relaxed)) listSuppressed(site, lev, file, line, NULL);
+  }
+
+  /// @brief Attach an additional output
+  /// Every record passing \a level is also written to \a sink, rendered with its own pattern.
+  /// The payload of a call is formatted once for all outputs, and sinks using the same pattern
+  /// share one rendering of the record. Attached sinks are written by the logging thread, also
+  /// in asynchronous mode, and are flushed by flush().
+  /// @param [in] sink the output, owned and deleted by the Logger once attached, left to the caller on failure
+  /// @param [in] level max level written to \a sink, always msgs are written regardless
+  /// @param [in] pattern a pattern as for setPattern(), NULL to follow the pattern of the Logger
+  /// @return EErr on failure, ENoErr on success
+  int addSink(LogSink *sink, CfgLog::level_e level, const char *pattern = NULL);
+
+  /// @brief Write out the flight recorder
+  /// The msgs this Logger kept since its last dump are written to the outputs in timestamp order, with
+  /// the time, thread and level they were logged with. Msgs of other Loggers sharing the recorder are
+  /// left out. Emergency and alert msgs dump it on their own.
+  /// @return number of records written
+  int dumpRecorder(void);
+
+  /// @brief Return the counters of the Logger
+  /// Lines logged and filtered per level, bytes written, truncations, write errors and flushes
+  /// are counted since the Logger was created, queue depth and drops refer to the current queue.
+  /// @param [out] stats the counters
+  void getStats(LogStats::stats_t *stats);
+
+  /// @brief Count a msg of level \a lev discarded before it reached the Logger, used by the LOGGER_* macros
+  /// @param [in] lev msg level
+  void countFiltered(CfgLog::level_e lev) { m_stats->filtered(lev); }
+
+  /// @brief Return the named child logger \a name, creating it and its parents if needed
+  /// The name is made of parts separated by '.', e.g. <i>net.http.client</i>. The child writes through
+  /// this Logger and is owned by it, repeated calls return the same child. See LogChild.
+  /// @param [in] name the name
+  /// @return the child, NULL if \a name is empty or has an empty part
+  LogChild *getChild(const char *name);
+
+  /// @brief Apply the live settings of another config
+  /// Takes over level, profile, pattern, user patterns, prefix, postfix, separator, level case, colors
+  /// and the module levels of the children, e.g. of a config file read by CfgLog::load(). Module levels
+  /// dropped since the previous config return their children to inheriting. Settings of the output,
+  /// such as the logfile or asynchronous mode, only take effect with init().<br>
+  /// With CfgLog::watchConfig set, init() starts a thread calling this whenever CfgLog::configFile changes.
+  /// @param [in] cfg the config to take the settings from, not kept
+  /// @return EErr if the pattern could not be applied, ENoErr on success
+  int reload(const CfgLog *cfg);
+
   /// @brief Return the currently set log level
   /// @return the loglevel
   CfgLog::level_e getLevel(void);
 
   /// @brief Set the log level
+  /// Children without a level override follow, see getChild().
   /// @param [in] level a loglevel
   void setLevel(CfgLog::level_e level);
 
@@ -234,9 +531,9 @@ public:
 
 private:
 
-  #define LOG(...) \
-    (void)vfprintf(m_fd, __VA_ARGS__); \
-    (void)fflush(m_fd); \
+  friend class LogBinary;
+  friend class LogRecorder;
+  friend class LogChild;
 
   enum {
     EPatInvalid = 0,
@@ -247,22 +544,536 @@ private:
     EPatMsg,
     EPatPrefix,
     EPatEnd,
+    EPatTimeUs,
+    EPatTimeIso,
+    EPatTimeEpoch,
+    EPatTimeMono,
+    EPatLiteral,
+    EPatTID,
     EPatUsr
   };            ///< message pattern identifier
 
+  /// A compiled pattern item
+  typedef struct patItem {
+    int type;   ///< EPatLiteral or one of the dynamic items (time formats, pid, level, msg)
+    int off;    ///< offset of the literal text in pattern_t::lit
+    int len;    ///< length of the literal text
+  } patItem_t;
+
+  /// A compiled pattern, immutable once published
+  typedef struct pattern {
+    patItem_t items[CfgLog::CMaxPatternItems];  ///< literal runs joined
+    int       len;                              ///< number of items
+    int       msgItem;                          ///< index of the msg item, len if there is none
+    bool      json;                             ///< the pattern renders a JSON object, the msg is escaped
+    char      lit[CfgLog::CMaxPatternItems * CfgLog::CMaxPatternItemLen];  ///< literal text of the items
+    char      levelStr[CfgLog::ELogAlways + 1][CfgLog::CMaxLogLevelStrLen];  ///< padded level strings in the configured case
+    int       levelLen[CfgLog::ELogAlways + 1];  ///< lengths of levelStr
+    char      color[CfgLog::ELogAlways + 1][CfgLog::CLogColorLen];  ///< escape sequences starting a record of each level
+    int       colorLen[CfgLog::ELogAlways + 1];  ///< lengths of color, 0 if the level is not colored
+  } pattern_t;
+
+  static const int CAsyncBatchLen = 64;  ///< max number of records the writer drains before flushing
+
+  /// max length of the pattern items around the msg, each at most a timestamp
+  static const int CMaxHeaderLen = CfgLog::CMaxPatternItems * (CfgLog::CMaxPatternItemLen + LogTime::CMaxTimeLen);
+
+  /// Buffers of the per-thread arena, used at the same time by one logging call
+  enum { EArenaMsg = 0, EArenaRecord, EArenaFields, EArenaCnt };
+
+  /// Per-thread buffers for records that do not fit the stack buffers
+  typedef struct arenaBuffers {
+    char  *buf[EArenaCnt];    ///< the buffers, NULL until first used
+    size_t size[EArenaCnt];   ///< sizes of the buffers
+    ~arenaBuffers();
+  } arena_t;
+
+  static thread_local arena_t s_arena;    ///< arena of the calling thread
+
+  /// An attached sink
+  typedef struct sinkRef {
+    LogSink   *sink;                          ///< the output
+    int        level;                         ///< max level written to the sink
+    pattern_t *pattern;                       ///< compiled pattern, NULL to use that of the output
+    char       patStr[CfgLog::CMaxPatternLen];  ///< source of pattern
+  } sinkRef_t;
+
+  /// The attached sinks, immutable once published
+  typedef struct sinkSet {
+    sinkRef_t sinks[CMaxSinks];   ///< sinks sharing a pattern are adjacent, those using the output pattern first
+    int       cnt;                ///< number of sinks
+    int       level;              ///< highest level of the sinks
+  } sinkSet_t;
+
+  /// @brief The configuration records are rendered with, immutable once published
+  /// Logging threads load it once per record, between LogEpoch::enter() and LogEpoch::leave().
+  /// Reconfiguration publishes a new snapshot, the replaced one and the parts it does not share
+  /// with the new one are freed through LogEpoch.
+  typedef struct config {
+    pattern_t *pattern;   ///< compiled pattern of the output
+    sinkSet_t *sinks;     ///< attached sinks, NULL if there are none
+  } config_t;
+
+  /// Origin of a record rendered on behalf of another process, e.g. when decoding a binary logfile
+  typedef struct recCtx {
+    struct timespec real;   ///< wall clock time of the record
+    struct timespec mono;   ///< monotonic time of the record
+    int  pid;               ///< process id
+    long tid;               ///< kernel thread id
+  } recCtx_t;
+
+  /// An opened log destination
+  typedef struct output {
+    FILE    *fd;      ///< stdio stream, NULL if a sink is used
+    char    *fdBuf;   ///< output buffer of fd
+    LogSink *sink;    ///< raw output backend
+  } output_t;
+
   CfgLog  *m_cfg;                         ///< logger config
   FILE    *m_fd;                          ///< file descriptor
+  char    *m_fdBuf;                       ///< output buffer of m_fd when logging to file
+  LogSink *m_sink;                        ///< raw output backend, replaces m_fd if set
+  LogBinary *m_binary;                    ///< binary record encoder, only set with EBackendBinary
+  LogDedup  *m_dedup;                     ///< duplicate msg filter, only set if dedupWindow is configured
+  std::atomic<uint64_t> m_lastFlush;                   ///< time of the last flush in ms, for EFlushInterval
+  std::atomic<LogLimit::site_t*> m_suppressed;         ///< call sites with suppressed calls to report, see suppressed()
   bool     m_removeCfg;                   ///< flag to remove cfgLog in case it was created at ctor
-  int      m_pattern[CfgLog::CMaxPatternItems];   ///< currently set pattern array
+  bool     m_tty;                         ///< the output is a terminal, colors are rendered
+  std::atomic<config_t*> m_config;        ///< current configuration snapshot
+  std::atomic<int> m_level;               ///< loglevel of the output
+  std::atomic<int> m_enabled;             ///< highest level of the output, the attached sinks and the recorder, read by every logging call
+  std::atomic<int> m_recLevel;            ///< max level kept by the flight recorder, -1 if it is disabled
+  uint32_t         m_recId;               ///< tag of the records this Logger keeps in the flight recorder, unique in the process
+  uint64_t        *m_recDumped;           ///< per recorder ring, position up to which dumpRecorder() has written, NULL before the first dump
+  std::atomic<int> m_sinkLevel;           ///< highest level of the attached sinks, -1 if there are none
+  LogChild *m_children;                   ///< first top level child logger, changed under m_cfgLock
+  std::mutex m_sinkLock;                  ///< serializes writes to the attached sinks
+  std::mutex m_cfgLock;                   ///< serializes configuration changes
+  std::mutex m_emitLock;                  ///< serializes writes to the output
+
+  LogQueue                *m_queue;       ///< record queue, only set in asynchronous mode
+  std::thread              m_writer;      ///< background writer draining m_queue
+  std::mutex               m_asyncLock;   ///< protects writer sleep and flush handshakes
+  std::condition_variable  m_wakeWriter;  ///< signalled to wake an idle writer
+  std::condition_variable  m_flushed;     ///< signalled by the writer after each flushed batch
+  std::atomic<bool>        m_stop;        ///< tells the writer to drain and exit
+  std::atomic<bool>        m_writerIdle;  ///< set while the writer sleeps
+  std::atomic<size_t>      m_flushTarget; ///< queue position flush() is waiting for
+  std::atomic<size_t>      m_flushedPos;  ///< queue position up to which records have been flushed
+  std::atomic<uint64_t>    m_dropped;     ///< number of records dropped on a full queue
+
+  bool                     m_rotate;      ///< log rotation is configured and the rotator runs
+  size_t                   m_outBytes;    ///< bytes written to the current logfile
+  output_t                 m_next;        ///< logfile opened by the rotator, waiting to be swapped in
+  output_t                 m_old;         ///< logfile swapped out, waiting to be closed by the rotator
+  std::thread              m_rotator;     ///< background thread renaming, opening and closing logfiles
+  std::mutex               m_rotateLock;  ///< protects m_next, m_old and the rotator sleep
+  std::condition_variable  m_wakeRotator; ///< signalled to wake the rotator
+  std::atomic<bool>        m_nextReady;   ///< m_next holds a fresh logfile
+  std::atomic<bool>        m_rotating;    ///< a rotation has been requested and is not finished yet
+  bool                     m_rotatorStop; ///< tells the rotator to exit
+
+  LogStats                *m_stats;       ///< counters, kept across init()
+  std::thread              m_timer;       ///< background thread of the periodic duties, see timerLoop()
+  std::mutex               m_timerLock;   ///< protects the timer sleep
+  std::condition_variable  m_wakeTimer;   ///< signalled to stop the timer or when a sink is attached
+  bool                     m_timerStop;   ///< tells the timer to exit
+
+  LogWatch                *m_watch;       ///< watch of CfgLog::configFile, only set while the watcher runs
+  std::thread              m_watchThread; ///< background thread reloading CfgLog::configFile on changes
 
   /// Initialize logger
   void init(void);
 
+  /// Flush and close the output if it is a file
+  void closeOutput(void);
+
+  /// @brief Open the configured logfile
+  /// @param [out] out the opened destination
+  /// @param [in] append append to the file instead of truncating it
+  /// @return EErr on failure, ENoErr on success
+  int openOutput(output_t *out, bool append);
+
+  /// @brief Flush and close a destination, stdout is only flushed
+  /// @param [in,out] out the destination, cleared on return
+  void closeOutput(output_t *out);
+
+  /// Start the rotator if rotation is configured
+  void startRotator(void);
+
+  /// Stop the rotator, a prepared but unused logfile is closed
+  void stopRotator(void);
+
+  /// Rotator main loop
+  void rotatorLoop(void);
+
+  /// Start the timer thread
+  void startTimer(void);
+
+  /// Stop the timer thread
+  void stopTimer(void);
+
+  /// @brief Timer main loop
+  /// Logs the counters every CfgLog::statsInterval, ticks the attached sinks every CSinkTickMs and,
+  /// in synchronous mode, flushes the output once CfgLog::flushInterval has passed without a record doing so.
+  void timerLoop(void);
+
+  /// @brief Check whether the output is flushed by time, see CfgLog::flushInterval
+  /// @return true for EFlushInterval, or EMsyncInterval with the memory mapped backend
+  bool flushByInterval(void);
+
+  /// Start the config file watcher if CfgLog::watchConfig is set
+  void startWatch(void);
+
+  /// Stop the config file watcher
+  void stopWatch(void);
+
+  /// Watcher main loop
+  void watchLoop(void);
+
+  /// Log the counters in one line
+  void logStats(void);
+
+  /// @brief Account written bytes and swap in a rotated logfile, called by the writing thread
+  /// @param [in] written number of bytes just written to the output
+  void rotateCheck(size_t written);
+
+  /// @brief Compute the next interval rotation
+  /// @return epoch seconds of the next rotation, 0 if interval rotation is disabled
+  time_t nextRotation(void);
+
+  /// @brief Shift the rotated logfiles, rename the logfile and open a fresh one
+  /// @param [out] out the new destination
+  /// @return EErr on failure, ENoErr on success
+  int rotateFiles(output_t *out);
+
+  /// Write out buffered output, timed for the flush latency histogram
+  void flushOutput(void);
+
+  /// @brief Check the flush policy after a record has been written
+  /// @param [in] lev level of the record
+  /// @return true if the output should be flushed now
+  bool flushDue(CfgLog::level_e lev);
+
+  /// Start the background writer if asynchronous logging is configured
+  void startWriter(void);
+
+  /// Drain the queue and stop the background writer
+  void stopWriter(void);
+
+  /// Background writer main loop
+  void writerLoop(void);
+
+  /// @brief Log a message of level \a lev
+  /// @param [in] lev msg level
+  /// @param [in] fmt the msg payload
+  /// @param [in] args arguments to \a fmt
+  void logv(CfgLog::level_e lev, const char *fmt, va_list args);
+
+  /// @brief Log a message that passed isEnabled(), see logv()
+  /// @param [in] lev msg level
+  /// @param [in] outLevel loglevel the output applies to the msg, that of a LogChild for its msgs
+  /// @param [in] fmt the msg payload
+  /// @param [in] args arguments to \a fmt
+  void logvAs(CfgLog::level_e lev, int outLevel, const char *fmt, va_list args);
+
+  /// @brief Log a message with key/value fields
+  /// @param [in] lev msg level
+  /// @param [in] msg the msg
+  /// @param [in] list the fields
+  void logKv(CfgLog::level_e lev, const char *msg, std::initializer_list<LogJson::field_t> list);
+
+  /// @brief Log a message with key/value fields that passed isEnabled(), see logKv()
+  /// @param [in] lev msg level
+  /// @param [in] outLevel loglevel the output applies to the msg
+  /// @param [in] msg the msg
+  /// @param [in] list the fields
+  void logKvAs(CfgLog::level_e lev, int outLevel, const char *msg, std::initializer_list<LogJson::field_t> list);
+
+  /// @brief Format a message of the type-safe API and log it
+  /// @param [in] lev msg level
+  /// @param [in] fmt the format, created by LOGGER_FMT()
+  /// @param [in] args arguments to \a fmt
+  template<typename F, typename... Args>
+  void logFmt(CfgLog::level_e lev, F fmt, const Args&... args) {
+    static_assert(LogFormat::valid(F::value()), "malformed placeholder in format string");
+    static_assert(LogFormat::count(F::value()) == sizeof...(Args), "number of arguments does not match the format string");
+    static_assert(LogFormat::check<F, 0, Args...>(), "argument type does not match its placeholder");
+    if (!isEnabled(lev)) {
+      m_stats->filtered(lev);
+      return;
+    }
+    logFmtAs(lev, ownLevel(), fmt, args...);
+  }
+
+  /// @brief Format a message of the type-safe API that passed isEnabled() and log it, see logFmt()
+  /// @param [in] lev msg level
+  /// @param [in] outLevel loglevel the output applies to the msg
+  /// @param [in] fmt the format, created by LOGGER_FMT()
+  /// @param [in] args arguments to \a fmt
+  template<typename F, typename... Args>
+  void logFmtAs(CfgLog::level_e lev, int outLevel, F fmt, const Args&... args) {
+    (void)fmt;
+    bool recordOnly = (m_recLevel.load(std::memory_order_relaxed) >= 0) && recorderCheck(lev, outLevel);
+
+    char payload[CfgLog::CMaxLogMsgLen];
+    char *text = payload;
+    size_t size = sizeof(payload);
+    char *end = LogFormat::format(text, text + size - 1, F::value(), args...);
+
+    // the msg may have been cut, retry in the arena until it fits
+    while ((end == text + size - 1) && ((text = arena(EArenaRecord, size * 2)) != NULL)) {
+      size *= 2;
+      end = LogFormat::format(text, text + size - 1, F::value(), args...);
+    }
+    if (text == NULL) {
+      text = payload;
+      end = payload + sizeof(payload) - 1;
+      m_stats->truncated();
+    }
+    *end = '\0';
+    if (recordOnly) {
+      recordText(lev, text);
+      return;
+    }
+    if ((m_dedup != NULL) && suppress(lev, F::value(), text, end - text)) return;
+    m_stats->emitted(lev);
+    writeText(lev, outLevel, text, end - text);
+  }
+
+  /// @brief Check a msg while the flight recorder is enabled, dumping it on emergency and alert msgs
+  /// @param [in] lev msg level
+  /// @param [in] outLevel loglevel the output applies to the msg
+  /// @return true if the msg is below the level of the outputs and only goes to the recorder, it is counted as filtered
+  bool recorderCheck(CfgLog::level_e lev, int outLevel);
+
+  /// @brief Keep an already formatted msg in the flight recorder
+  /// @param [in] lev msg level
+  /// @param [in] text the null terminated msg
+  void recordText(CfgLog::level_e lev, const char *text);
+
+  /// @brief Write a record kept by the flight recorder to the output and the attached sinks
+  /// In async mode the record is queued for the writer thread, which owns the output.
+  /// @param [in] lev msg level
+  /// @param [in] ctx time and thread the record was logged with
+  /// @param [in] payload the formatted msg
+  /// @param [in] len length of \a payload
+  void replayRecord(CfgLog::level_e lev, const recCtx_t *ctx, const char *payload, int len);
+
+  /// @brief Pass a msg through the duplicate filter, logging due summaries of suppressed repeats
+  /// @param [in] lev msg level
+  /// @param [in] key format string of the call
+  /// @param [in] payload the formatted msg
+  /// @param [in] len length of \a payload
+  /// @return true if the msg is a repeat and must not be logged, it is counted as filtered
+  bool suppress(CfgLog::level_e lev, const void *key, const char *payload, int len);
+
+  /// @brief Log the summaries of suppressed repeats whose window has closed
+  /// @param [in] now monotonic time in milliseconds, UINT64_MAX to report all repeats
+  void reportRepeats(uint64_t now);
+
+  /// @brief Log an already formatted message
+  /// @param [in] lev msg level
+  /// @param [in] outLevel loglevel the output applies to the msg
+  /// @param [in] payload the null terminated msg
+  /// @param [in] len length of \a payload
+  /// @param [in] fields key/value fields of the msg, NULL if there are none
+  void writeText(CfgLog::level_e lev, int outLevel, const char *payload, int len, const LogJson::fields_t *fields = NULL);
+
+  /// @brief Encode a message as binary record, see writeBinary()
+  /// @param [in] lev msg level
+  /// @param [in] ctx origin of the record, NULL for the calling thread right now
+  /// @param [in] fmt the msg payload, followed by its arguments
+  void writeBinaryf(CfgLog::level_e lev, const recCtx_t *ctx, const char *fmt, ...);
+
+  /// @brief Render a message in pieces and emit them
+  /// @param [in] lev msg level
+  /// @param [in] fmt the msg payload
+  /// @param [in] args arguments to \a fmt
+  void writeParts(CfgLog::level_e lev, const char *fmt, va_list args);
+
+  /// @brief Format the payload of a printf style call
+  /// @param [out] buf stack buffer for the payload
+  /// @param [in] size size of \a buf
+  /// @param [out] len length of the payload
+  /// @param [in] fmt the msg payload
+  /// @param [in] args arguments to \a fmt
+  /// @return \a buf, or an arena buffer if the payload did not fit
+  char *formatPayload(char *buf, int size, int *len, const char *fmt, va_list args);
+
+  /// @brief Render a formatted payload and emit it to the output and the attached sinks
+  /// @param [in] lev msg level
+  /// @param [in] ctx origin of the record, NULL for the calling thread right now
+  /// @param [in] payload the formatted msg
+  /// @param [in] len length of \a payload
+  /// @param [in] toOutput write the record to the output, otherwise only to the attached sinks
+  /// @param [in] fields key/value fields of the msg, NULL if there are none
+  void writeRecord(CfgLog::level_e lev, const recCtx_t *ctx, const char *payload, int len, bool toOutput = true,
+                   const LogJson::fields_t *fields = NULL);
+
+  /// @brief Render the pieces of a record
+  /// @param [in] pat the compiled pattern
+  /// @param [in] lev msg level
+  /// @param [in] ctx origin of the record, NULL for the calling thread right now
+  /// @param [in] payload the formatted msg
+  /// @param [in] len length of \a payload
+  /// @param [in] fields key/value fields of the msg, NULL if there are none
+  /// @param [out] head buffer of CfgLog::CLogColorLen + CMaxHeaderLen bytes for the items before the msg
+  /// @param [out] tail buffer of CMaxHeaderLen + CfgLog::CLogColorLen bytes for the items after the msg
+  /// @param [out] iov the pieces, room for 3
+  /// @return number of pieces, 0 if the record could not be rendered
+  int renderParts(const pattern_t *pat, CfgLog::level_e lev, const recCtx_t *ctx, const char *payload, int len,
+                  const LogJson::fields_t *fields, char *head, char *tail, struct iovec *iov);
+
+  /// @brief Render the msg item, escaped for JSON patterns and followed by the fields
+  /// @param [in] pat the compiled pattern
+  /// @param [in] pos where to render to
+  /// @param [in] end end of the buffer
+  /// @param [in] payload the formatted msg
+  /// @param [in] len length of \a payload
+  /// @param [in] fields key/value fields of the msg, NULL if there are none
+  /// @return position after the msg, NULL if it did not fit
+  char *addMsg(const pattern_t *pat, char *pos, const char *end, const char *payload, int len,
+                const LogJson::fields_t *fields);
+
+  /// Return the loglevel of the output for msgs of the Logger itself
+  int ownLevel(void) { return m_level.load(std::memory_order_relaxed); }
+
+  /// Check whether the output, at loglevel \a outLevel, takes a record of level \a lev
+  bool outputAccepts(CfgLog::level_e lev, int outLevel) {
+    return (lev == CfgLog::ELogAlways) || (outLevel >= lev);
+  }
+
+  /// Check whether an attached sink takes a record of level \a lev
+  bool sinksAccept(CfgLog::level_e lev) {
+    int level = m_sinkLevel.load(std::memory_order_relaxed);
+    return (level >= 0) && ((lev == CfgLog::ELogAlways) || (level >= lev));
+  }
+
+  /// Recompute m_enabled from the output and the attached sinks, and the levels of the children
+  void updateEnabled(void);
+
+  /// Return the highest level of the attached sinks and the recorder, -1 if there are none
+  int extraLevel(void);
+
+  /// @brief Return the named child logger, creating it and its parents, called with m_cfgLock held or from init()
+  /// @param [in] name the name, see getChild()
+  /// @return the child, NULL if \a name is empty or has an empty part
+  LogChild *addChild(const char *name);
+
+  /// @brief Replace the module levels of \a prev by those of \a next, followed by updateEnabled()
+  /// Called with m_cfgLock held or from init().
+  /// @param [in] prev config whose module levels are cleared, NULL if there is none
+  /// @param [in] next config whose module levels are set
+  void applyModuleLevels(const CfgLog *prev, const CfgLog *next);
+
+  /// @brief Log "suppressed N lines at file:line", see reportSuppressed()
+  /// @param [in] lev level of the call site
+  /// @param [in] outLevel loglevel the output applies to the msg
+  /// @param [in] file source file of the call site
+  /// @param [in] line source line of the call site
+  /// @param [in] cnt number of suppressed calls
+  void writeSuppressed(CfgLog::level_e lev, int outLevel, const char *file, int line, uint32_t cnt);
+
+  /// @brief List a call site with suppressed calls, unless it is listed already
+  /// @param [in,out] site state of the call site
+  /// @param [in] lev level of the call site
+  /// @param [in] file source file of the call site
+  /// @param [in] line source line of the call site
+  /// @param [in] child child logger the call site logs through, NULL for this Logger
+  void listSuppressed(LogLimit::site_t *site, CfgLog::level_e lev, const char *file, int line, LogChild *child);
+
+  /// Report the calls suppressed by the listed call sites and empty the list
+  void reportListed(void);
+
+  /// @brief Publish a configuration snapshot, called with m_cfgLock held or from init()
+  /// The replaced snapshot and its parts not taken over are retired to LogEpoch.
+  /// @param [in] pat compiled pattern of the output
+  /// @param [in] set attached sinks, NULL if there are none
+  void publish(pattern_t *pat, sinkSet_t *set);
+
+  /// Flush, delete and free the attached sinks, the patterns and the configuration snapshot
+  void freeConfig(void);
+
+  /// @brief Encode a message as binary record and emit or enqueue it
+  /// Records too long for the stack buffer are encoded in the arena, up to LogBinary::CMaxLogRecLen.
+  /// @param [in] lev msg level
+  /// @param [in] ctx origin of the record, NULL for the calling thread right now
+  /// @param [in] fmt the msg payload
+  /// @param [in] args arguments to \a fmt
+  void writeBinary(CfgLog::level_e lev, const recCtx_t *ctx, const char *fmt, va_list args);
+
+  /// @brief Write a rendered record to the output and apply the flush policy and rotation
+  /// @param [in] lev msg level
+  /// @param [in] iov the pieces of the record
+  /// @param [in] cnt number of pieces in \a iov
+  void emit(CfgLog::level_e lev, const struct iovec *iov, int cnt);
+
+  /// @brief Write pieces to the output and count the bytes and failures, called with the output locked
+  /// @param [in] iov the pieces
+  /// @param [in] cnt number of pieces in \a iov
+  /// @return number of bytes handed to the output
+  size_t writeOutput(const struct iovec *iov, int cnt);
+
+  /// @brief Render a message straight into the async queue
+  /// The pattern items are rendered into the slot, only the payload goes through vsnprintf.
+  /// @param [in] lev msg level
+  /// @param [in] fmt the msg payload
+  /// @param [in] args arguments to \a fmt
+  void enqueueParts(CfgLog::level_e lev, const char *fmt, va_list args);
+
+  /// @brief Copy a rendered or encoded record into the async queue
+  /// Records longer than a slot are split over consecutive slots, up to half the queue.
+  /// @param [in] lev msg level
+  /// @param [in] buf the record
+  /// @param [in] len length of \a buf
+  /// @param [in] mayDrop apply the drop policy, if false wait for room
+  void enqueueRaw(CfgLog::level_e lev, const char *buf, int len, bool mayDrop);
+
+  /// @brief Reserve queue slots according to the drop policy
+  /// @param [in] lev msg level
+  /// @param [out] pos queue position of the first slot
+  /// @param [in] mayDrop apply the drop policy, if false wait for room
+  /// @param [in] cnt number of consecutive slots
+  /// @return the first slot, NULL if the record is dropped
+  LogQueue::record_t *reserveSlot(CfgLog::level_e lev, size_t *pos, bool mayDrop, size_t cnt = 1);
+
+  /// Publish a filled queue slot and wake the writer
+  void commitSlot(LogQueue::record_t *rec, size_t pos, CfgLog::level_e lev, int len);
+
   /// Initialize configuration from pattern
+  /// The pattern is compiled into a sequence of literal runs (prefix, separators,
+  /// postfix and user patterns joined) and dynamic items, which renderItems() renders in a single pass.
+  /// The compiled pattern is published in a new configuration snapshot, logging threads keep
+  /// rendering with the pattern they loaded, which is freed once all of them are done.
   /// @param[in] pattern string
   /// @return ENoErr on success, EErr on failure
   int initPattern(const char *pattern);
 
+  /// @brief Append a compiled pattern item
+  /// @param [in,out] pat the pattern being compiled
+  /// @param [in] type the pattern identifier
+  /// @param [in] lit literal text if \a type is a literal item
+  /// @return ENoErr on success, EErr if the pattern is too long
+  int compileItem(pattern_t *pat, int type, const char *lit);
+
+  /// @brief Append the items of a JSON object with time, level, pid, tid and msg, for &jsn
+  /// @param [in,out] pat the pattern being compiled
+  /// @return ENoErr on success, EErr if the pattern is too long
+  int compileJson(pattern_t *pat);
+
+  /// Render the level strings of \a pat in the configured case
+  void initLevelStrings(pattern_t *pat);
+
+  /// Render the color escape sequences of \a pat for all levels, unless \a tty is false and colorAlways is not set
+  void initColors(pattern_t *pat, bool tty);
+
+  /// @brief Compile a pattern
+  /// @param [in] pattern the pattern string
+  /// @param [in] tty the pattern renders to a terminal
+  /// @return the compiled pattern, NULL if \a pattern is invalid
+  pattern_t *compilePattern(const char *pattern, bool tty);
+
   /// Initialize a plogging profile
   /// sets all style setting to defaults depending on profile set
   /// @param [in] profile a default profile
@@ -272,21 +1083,52 @@ private:
   /// @param [in] profile a profile
   int initStandardProfile(CfgLog::profile_e profile);
 
-  /// Add individual parts of the message
-  int  addUsr(char *msg, int no);
-  void addMsg(char *msg, const char *fmt);
-  void addTime(char *msg);
-  void addPID(char *msg);
-  void addLevel(char *msg, CfgLog::level_e lev);
-  void addPostfix(char *msg);
-  void addPrefix(char *msg);
-  void addSeparator(char *msg);
-
-  /// @brief Construct a log message
-  /// @param[in,out] msg contains the contructed log msg after call
-  /// @param[in] fmt the msg payload
-  /// @param[in] level msg level
-  void constructMsg(char *msg, const char *fmt, CfgLog::level_e lev);
+  /// Add individual parts of the message at \a pos, return the position after them.
+  /// Nothing is written past \a end, in which case NULL is returned.
+  char *addLiteral(char *pos, const char *end, const char *str, int len);
+  /// With \a ctx set, time, pid and tid are taken from it instead of the calling thread.
+  char *addTime(char *pos, const char *end, LogTime::format_e fmt, const recCtx_t *ctx);
+  char *addPID(char *pos, const char *end, const recCtx_t *ctx);
+  char *addTID(char *pos, const char *end, const recCtx_t *ctx);
+
+  /// @brief Render a range of pattern items
+  /// @param [in] pat the compiled pattern
+  /// @param [in] pos where to render to
+  /// @param [in] end last usable position
+  /// @param [in] from first item
+  /// @param [in] to item after the last one
+  /// @param [in] fmt text of msg items, NULL to skip them
+  /// @param [in] lev msg level
+  /// @param [in] ctx origin of the record, NULL for the calling thread right now
+  /// @return position after the rendered items, NULL if they did not fit
+  char *renderItems(const pattern_t *pat, char *pos, const char *end, int from, int to, const char *fmt,
+                    CfgLog::level_e lev, const recCtx_t *ctx);
+
+  /// @brief Check whether a record of level \a lev is colored
+  bool isColored(const pattern_t *pat, CfgLog::level_e lev) {
+    return pat->colorLen[lev] > 0;
+  }
+
+  /// @brief Render a whole line with color escapes
+  /// @param [in] pat the compiled pattern
+  /// @param [out] buf where to render to, no null termination is added
+  /// @param [in] size size of \a buf
+  /// @param [in] payload the formatted msg
+  /// @param [in] len length of \a payload
+  /// @param [in] fields key/value fields of the msg, NULL if there are none
+  /// @param [in] lev msg level
+  /// @param [in] ctx time and thread to render, NULL for the calling thread now
+  /// @return length of the line, -1 if it did not fit
+  int renderLine(const pattern_t *pat, char *buf, size_t size, const char *payload, int len,
+                 const LogJson::fields_t *fields, CfgLog::level_e lev, const recCtx_t *ctx = NULL);
+
+  /// @brief Return a buffer of the calling thread's arena
+  /// The buffers grow on demand and are kept until the thread exits, so long records
+  /// only allocate until the largest one has been seen.
+  /// @param [in] which one of EArenaMsg, EArenaRecord, EArenaFields
+  /// @param [in] len number of bytes needed
+  /// @return the buffer, NULL if it could not grow
+  static char *arena(int which, size_t len);
 
   /// @brief Convert a string \a buf to uppercase letters
   /// @param[in,out] buf the character array to be converted
@@ -308,4 +1150,72 @@ private:
 
 };
 
+/// @brief Log through \a log if \a lev is compiled in and enabled
+///
+/// Levels below LOGGER_MIN_LEVEL are removed at compile time, for the others the
+/// loglevel is checked inline. In both cases the arguments are only evaluated if the
+/// message is actually logged. Msgs dropped by the loglevel are counted, see Logger::getStats().
+#define LOGGER_LOG(log, lev, func, ...) \
+  do { \
+    if ((CfgLog::lev == CfgLog::ELogAlways) || (CfgLog::lev <= CfgLog::LOGGER_MIN_LEVEL)) { \
+      if ((log)->isEnabled(CfgLog::lev)) (log)->func(__VA_ARGS__); \
+      else (log)->countFiltered(CfgLog::lev); \
+    } \
+  } while (0)
+
+#define LOGGER_EMERGENCY(log, ...) LOGGER_LOG(log, ELogEmergency, emergency, __VA_ARGS__)
+#define LOGGER_ALERT(log, ...)     LOGGER_LOG(log, ELogAlert,     alert,     __VA_ARGS__)
+#define LOGGER_CRITICAL(log, ...)  LOGGER_LOG(log, ELogCritical,  critical,  __VA_ARGS__)
+#define LOGGER_ERROR(log, ...)     LOGGER_LOG(log, ELogError,     error,     __VA_ARGS__)
+#define LOGGER_WARNING(log, ...)   LOGGER_LOG(log, ELogWarn,      warning,   __VA_ARGS__)
+#define LOGGER_NOTICE(log, ...)    LOGGER_LOG(log, ELogNotice,    notice,    __VA_ARGS__)
+#define LOGGER_INFO(log, ...)      LOGGER_LOG(log, ELogInfo,      info,      __VA_ARGS__)
+#define LOGGER_DEBUG(log, ...)     LOGGER_LOG(log, ELogDebug,     debug,     __VA_ARGS__)
+#define LOGGER_ALWAYS(log, ...)    LOGGER_LOG(log, ELogAlways,    always,    __VA_ARGS__)
+
+/// @brief Log through \a log if \a lev is enabled and the LogLimit \a check lets the call site pass
+///
+/// The call site keeps its state in a static LogLimit::site_t. Disabled levels do not touch it,
+/// rejected calls neither evaluate nor format their arguments. Suppressed calls are reported with
+/// Logger::reportSuppressed() by the first logged call of a later second, or by the timer thread
+/// of the Logger if the call site stays quiet, see Logger::suppressed().
+#define LOGGER_LOG_LIMIT(log, lev, func, check, n, ...) \
+  do { \
+    static LogLimit::site_t _loggerSite; \
+    uint32_t _loggerDropped; \
+    if ((CfgLog::lev == CfgLog::ELogAlways) || (CfgLog::lev <= CfgLog::LOGGER_MIN_LEVEL)) { \
+      if ((log)->isEnabled(CfgLog::lev)) { \
+        bool _loggerPass = LogLimit::check(&_loggerSite, (n), &_loggerDropped); \
+        if (_loggerDropped != 0) (log)->reportSuppressed(CfgLog::lev, __FILE__, __LINE__, _loggerDropped); \
+        if (_loggerPass) (log)->func(__VA_ARGS__); \
+        else (log)->suppressed(&_loggerSite, CfgLog::lev, __FILE__, __LINE__); \
+      } \
+      else (log)->countFiltered(CfgLog::lev); \
+    } \
+  } while (0)
+
+/// Log at most \a perSec calls per second from this call site, e.g. LOGGER_DEBUG_RATE(log, 10, "x %d", x)
+#define LOGGER_EMERGENCY_RATE(log, perSec, ...) LOGGER_LOG_LIMIT(log, ELogEmergency, emergency, rate, perSec, __VA_ARGS__)
+#define LOGGER_ALERT_RATE(log, perSec, ...)     LOGGER_LOG_LIMIT(log, ELogAlert,     alert,     rate, perSec, __VA_ARGS__)
+#define LOGGER_CRITICAL_RATE(log, perSec, ...)  LOGGER_LOG_LIMIT(log, ELogCritical,  critical,  rate, perSec, __VA_ARGS__)
+#define LOGGER_ERROR_RATE(log, perSec, ...)     LOGGER_LOG_LIMIT(log, ELogError,     error,     rate, perSec, __VA_ARGS__)
+#define LOGGER_WARNING_RATE(log, perSec, ...)   LOGGER_LOG_LIMIT(log, ELogWarn,      warning,   rate, perSec, __VA_ARGS__)
+#define LOGGER_NOTICE_RATE(log, perSec, ...)    LOGGER_LOG_LIMIT(log, ELogNotice,    notice,    rate, perSec, __VA_ARGS__)
+#define LOGGER_INFO_RATE(log, perSec, ...)      LOGGER_LOG_LIMIT(log, ELogInfo,      info,      rate, perSec, __VA_ARGS__)
+#define LOGGER_DEBUG_RATE(log, perSec, ...)     LOGGER_LOG_LIMIT(log, ELogDebug,     debug,     rate, perSec, __VA_ARGS__)
+#define LOGGER_ALWAYS_RATE(log, perSec, ...)    LOGGER_LOG_LIMIT(log, ELogAlways,    always,    rate, perSec, __VA_ARGS__)
+
+/// Log the first of every \a every calls from this call site, e.g. LOGGER_DEBUG_SAMPLE(log, 100, "x %d", x)
+#define LOGGER_EMERGENCY_SAMPLE(log, every, ...) LOGGER_LOG_LIMIT(log, ELogEmergency, emergency, sample, every, __VA_ARGS__)
+#define LOGGER_ALERT_SAMPLE(log, every, ...)     LOGGER_LOG_LIMIT(log, ELogAlert,     alert,     sample, every, __VA_ARGS__)
+#define LOGGER_CRITICAL_SAMPLE(log, every, ...)  LOGGER_LOG_LIMIT(log, ELogCritical,  critical,  sample, every, __VA_ARGS__)
+#define LOGGER_ERROR_SAMPLE(log, every, ...)     LOGGER_LOG_LIMIT(log, ELogError,     error,     sample, every, __VA_ARGS__)
+#define LOGGER_WARNING_SAMPLE(log, every, ...)   LOGGER_LOG_LIMIT(log, ELogWarn,      warning,   sample, every, __VA_ARGS__)
+#define LOGGER_NOTICE_SAMPLE(log, every, ...)    LOGGER_LOG_LIMIT(log, ELogNotice,    notice,    sample, every, __VA_ARGS__)
+#define LOGGER_INFO_SAMPLE(log, every, ...)      LOGGER_LOG_LIMIT(log, ELogInfo,      info,      sample, every, __VA_ARGS__)
+#define LOGGER_DEBUG_SAMPLE(log, every, ...)     LOGGER_LOG_LIMIT(log, ELogDebug,     debug,     sample, every, __VA_ARGS__)
+#define LOGGER_ALWAYS_SAMPLE(log, every, ...)    LOGGER_LOG_LIMIT(log, ELogAlways,    always,    sample, every, __VA_ARGS__)
+
+#include "logChild.h"
+
 #endif //_CPP_LOGGER_H_
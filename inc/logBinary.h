@@ -0,0 +1,174 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logBinary.h
+/// @brief Header file of the LogBinary record encoder and decoder
+
+#ifndef _CPP_LOGGER_BINARY_H_
+#define _CPP_LOGGER_BINARY_H_
+
+#include "log.h"
+#include "logSink.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <time.h>
+#include <atomic>
+
+/// @brief LogBinary class
+///
+/// Encodes log calls into compact binary records instead of text. A record holds the id of
+/// its format string, the level, the thread id, a raw timestamp and the raw argument bytes.
+/// Every format string is registered once, identified by its address, and written to the
+/// output as a dictionary record, so formatting happens only when the file is decoded.<br>
+/// The file is a sequence of records, each starting with its type byte:
+/// Type | Content
+/// ---- | -------
+/// ERecHeader | uint32 pid, uint64 process start in ns since the epoch, uint64 session
+/// ERecFormat | uint32 id, uint8 number of arguments, argument kinds, uint16 length, format string
+/// ERecLog    | uint32 id, uint8 level, uint32 thread id, uint64 ns since the epoch, uint16 length, arguments
+///
+/// Integers are stored in host byte order. Strings are stored as uint16 length and bytes.<br>
+/// Format ids are only unique within a session, i.e. one LogBinary, which numbers its format strings from 1.
+/// A Logger starts a new session with every init(), so a file appended to across restarts holds several
+/// sessions. Each starts with a header carrying its session and the decoder keeps a dictionary per session.<br>
+/// Format strings the encoder can not handle (e.g. %n or positional arguments), and buffers reused for
+/// a different format string, are formatted right away and stored as a string argument of format id 0 ("%s").
+class LogBinary {
+public:
+
+  /// Return values used by LogBinary
+  enum { EErr = 0, ENoErr };
+
+  /// Record types
+  enum { ERecHeader = 'H', ERecFormat = 'F', ERecLog = 'R' };
+
+  /// Kinds of arguments, determined from the format string
+  enum { EArgInt = 1, EArgLong, EArgDouble, EArgLongDouble, EArgStr, EArgPtr };
+
+  static const int      CMaxFormats = 4096;   ///< number of distinct format strings that can be registered
+  static const int      CMaxArgs    = 32;     ///< max number of arguments of a format string
+  static const uint32_t CTextId     = 0;      ///< format id of preformatted text
+  static const int      CMaxFormatRecLen = 512; ///< max size of a dictionary record, longer format strings are stored as text
+  static const int      CMaxLogRecLen = 1 + 4 + 1 + 4 + 8 + 2 + UINT16_MAX; ///< max size of a log record, longer arguments are cut
+
+  /// Constructor
+  LogBinary();
+
+  /// Destructor
+  ~LogBinary();
+
+  /// @brief Encode a log call
+  /// @param [out] buf where to encode the record to
+  /// @param [in] len size of \a buf
+  /// @param [out] dict dictionary record of \a fmt if it has just been registered
+  /// @param [in,out] dictLen size of \a dict, length of the dictionary record on return (0 if none)
+  /// @param [in] lev msg level
+  /// @param [in] tid kernel thread id of the caller
+  /// @param [in] ts time of the call
+  /// @param [in] fmt the msg payload
+  /// @param [in] args arguments to \a fmt
+  /// @param [out] cut set to whether arguments had to be cut to fit into \a len bytes, may be NULL
+  /// @return length of the record, arguments that do not fit are cut
+  int encode(char *buf, int len, char *dict, int *dictLen, CfgLog::level_e lev, long tid,
+             const struct timespec *ts, const char *fmt, va_list args, bool *cut = NULL);
+
+  /// @brief Write the header and all format strings registered so far
+  /// Starts every file, so that each rotated file can be decoded on its own.
+  /// @param [in] sink the output
+  /// @return EErr on failure, ENoErr on success
+  int writeDictionary(LogSink *sink);
+
+  /// @brief Write the header and all format strings registered so far to a file descriptor
+  /// Only uses async-signal-safe calls, see LogRecorder.
+  /// @param [in] fd the output
+  /// @return EErr on failure, ENoErr on success
+  int writeDictionary(int fd);
+
+  /// @brief Decode binary logfiles into text
+  /// The dictionaries of all files are read first, then every record is rendered with the pattern of \a out.
+  /// @param [in] files paths to the files, oldest first
+  /// @param [in] cnt number of files
+  /// @param [in] out the Logger rendering the records
+  /// @return EErr on failure, ENoErr on success
+  static int decode(const char * const *files, int cnt, Logger *out);
+
+private:
+
+  friend class LogRecorder;
+
+  /// A conversion in a format string
+  typedef struct spec {
+    int     start;    ///< offset of the '%'
+    int     end;      ///< offset after the conversion character
+    int     stars;    ///< number of '*' width and precision arguments
+    uint8_t kind;     ///< kind of the converted argument
+  } spec_t;
+
+  /// A registered format string
+  typedef struct format {
+    std::atomic<const char*> key;     ///< the format string, NULL if the slot is unused
+    std::atomic<bool>        ready;   ///< id and kinds are valid
+    char    *text;                    ///< copy of the format string, detects reused buffers
+    uint32_t id;                      ///< format id, CTextId if the format can not be encoded
+    int      nargs;                   ///< number of arguments
+    uint8_t  kinds[CMaxArgs];         ///< argument kinds
+    int      fixed[CMaxArgs];         ///< bytes needed by the arguments after each one, strings counted empty
+  } format_t;
+
+  format_t             *m_formats;    ///< open addressing table of format strings
+  std::atomic<uint32_t> m_nextId;     ///< next free format id
+  uint64_t              m_session;    ///< session of the format ids, written in the header
+
+  static std::atomic<uint32_t> s_sessions;  ///< number of sessions started by this process
+
+  /// Format strings of one session, read by decode()
+  typedef struct session {
+    uint64_t        key;      ///< the session
+    const char    **dict;     ///< format strings by id
+    struct session *next;     ///< next session
+  } session_t;
+
+  /// @brief Find the session \a key in \a list, adding it if \a add is set
+  /// @return the session, NULL if it is unknown and \a add is not set
+  static session_t *findSession(session_t **list, uint64_t key, bool add);
+
+  /// @brief Find or register \a fmt
+  /// @param [in] fmt the format string
+  /// @param [out] added true if \a fmt has just been registered
+  /// @return the format, NULL if the table is full
+  format_t *lookup(const char *fmt, bool *added);
+
+  /// @brief Encode the header record
+  /// @return length of the record, 0 if it did not fit
+  int encodeHeader(char *buf, int len);
+
+  /// @brief Encode the dictionary record of \a f
+  /// @return length of the record, 0 if it did not fit
+  int encodeFormat(char *buf, int len, const format_t *f);
+
+  /// @brief Split a format string into its conversions
+  /// @param [in] fmt the format string
+  /// @param [out] specs the conversions, may be NULL
+  /// @param [in] maxSpecs size of \a specs
+  /// @param [out] kinds argument kinds in call order, may be NULL
+  /// @return number of arguments, -1 if the format can not be encoded
+  static int parse(const char *fmt, spec_t *specs, int maxSpecs, uint8_t *kinds);
+
+  /// @brief Format the arguments of a record
+  /// @param [out] buf where to write the text to
+  /// @param [in] len size of \a buf
+  /// @param [in] fmt the format string
+  /// @param [in] arg the encoded arguments
+  /// @param [in] argLen length of \a arg
+  /// @return length of the text
+  static int format(char *buf, int len, const char *fmt, const char *arg, int argLen);
+
+};
+
+#endif //_CPP_LOGGER_BINARY_H_
@@ -0,0 +1,215 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logChild.h
+/// @brief Header file of the LogChild named loggers
+
+#ifndef _CPP_LOGGER_CHILD_H_
+#define _CPP_LOGGER_CHILD_H_
+
+#include "log.h"
+
+/// @brief LogChild class
+///
+/// A named logger for a module, e.g. <i>net.http.client</i>, created by Logger::getChild().
+/// Children write through the output, the attached sinks and the pattern of their Logger and
+/// only carry a level override of their own. A child without an override follows its parent,
+/// <i>net.http</i> for <i>net.http.client</i>, and top level children follow the Logger.
+///
+/// The effective level is resolved whenever a level along the path changes and cached, so
+/// isEnabled() is a single load just as for the Logger. Children live as long as their Logger
+/// and may be used from any number of threads.
+/// @code
+/// LogChild *http = log->getChild("net.http");
+/// http->setLevel(CfgLog::ELogDebug);
+/// LOGGER_DEBUG(http, "%d bytes in", n);
+/// @endcode
+class LogChild {
+public:
+
+  /// @brief Print an emergency message
+  void emergency(const char *fmt, ...);
+  /// @brief Print an alert message
+  void alert(const char *fmt, ...);
+  /// @brief Print a critical message
+  void critical(const char *fmt, ...);
+  /// @brief Print an error message
+  void error(const char *fmt, ...);
+  /// @brief Print a warning message
+  void warning(const char *fmt, ...);
+  /// @brief Print a notice
+  void notice(const char *fmt, ...);
+  /// @brief Print an info
+  void info(const char *fmt, ...);
+  /// @brief Print a debug message
+  void debug(const char *fmt, ...);
+  /// @brief Print an always message
+  void always(const char *fmt, ...);
+
+  /// @name Type-safe logging
+  /// As for Logger, see LOGGER_FMT().
+  /// @{
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type emergency(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogEmergency, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type alert(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogAlert, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type critical(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogCritical, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type error(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogError, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type warning(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogWarn, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type notice(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogNotice, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type info(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogInfo, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type debug(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogDebug, fmt, args...);
+  }
+  template<typename F, typename... Args>
+  typename std::enable_if<LogFormat::IsFormat<F>::value>::type always(F fmt, const Args&... args) {
+    logFmt(CfgLog::ELogAlways, fmt, args...);
+  }
+  /// @}
+
+  /// @name Structured logging
+  /// As for Logger, a plain msg followed by typed key/value fields.
+  /// @{
+  void emergency(const char *msg, std::initializer_list<LogJson::field_t> fields) { logKv(CfgLog::ELogEmergency, msg, fields); }
+  void alert(const char *msg, std::initializer_list<LogJson::field_t> fields)     { logKv(CfgLog::ELogAlert, msg, fields); }
+  void critical(const char *msg, std::initializer_list<LogJson::field_t> fields)  { logKv(CfgLog::ELogCritical, msg, fields); }
+  void error(const char *msg, std::initializer_list<LogJson::field_t> fields)     { logKv(CfgLog::ELogError, msg, fields); }
+  void warning(const char *msg, std::initializer_list<LogJson::field_t> fields)   { logKv(CfgLog::ELogWarn, msg, fields); }
+  void notice(const char *msg, std::initializer_list<LogJson::field_t> fields)    { logKv(CfgLog::ELogNotice, msg, fields); }
+  void info(const char *msg, std::initializer_list<LogJson::field_t> fields)      { logKv(CfgLog::ELogInfo, msg, fields); }
+  void debug(const char *msg, std::initializer_list<LogJson::field_t> fields)     { logKv(CfgLog::ELogDebug, msg, fields); }
+  void always(const char *msg, std::initializer_list<LogJson::field_t> fields)    { logKv(CfgLog::ELogAlways, msg, fields); }
+  /// @}
+
+  /// @brief Check whether a message of level \a lev would be logged
+  /// @param [in] lev msg level
+  /// @return true if \a lev passes the effective level of the child, an attached sink or the recorder
+  bool isEnabled(CfgLog::level_e lev) {
+    return (lev == CfgLog::ELogAlways) || (m_enabled.load(std::memory_order_relaxed) >= lev);
+  }
+
+  /// @brief Count a msg of level \a lev discarded before it reached the child, used by the LOGGER_* macros
+  /// @param [in] lev msg level
+  void countFiltered(CfgLog::level_e lev) { m_root->countFiltered(lev); }
+
+  /// @brief Report calls suppressed by a rate limited or sampled call site, see Logger::reportSuppressed()
+  void reportSuppressed(CfgLog::level_e lev, const char *file, int line, uint32_t cnt);
+
+  /// @brief Count a call suppressed by a rate limited or sampled call site, see Logger::suppressed()
+  void suppressed(LogLimit::site_t *site, CfgLog::level_e lev, const char *file, int line) {
+    m_root->countFiltered(lev);
+    if (!site->listed.load(std::memory_order_relaxed)) m_root->listSuppressed(site, lev, file, line, this);
+  }
+
+  /// @brief Return the effective log level, the override or the one inherited
+  /// @return the loglevel
+  CfgLog::level_e getLevel(void) { return (CfgLog::level_e)m_outLevel.load(std::memory_order_relaxed); }
+
+  /// @brief Set the level override of the child, children without an override of their own follow
+  /// @param [in] level a loglevel
+  void setLevel(CfgLog::level_e level);
+
+  /// @brief Drop the level override, the child follows its parent again
+  void clearLevel(void);
+
+  /// @brief Check whether the child has a level override
+  bool hasLevel(void);
+
+  /// @brief Return the full name of the child, e.g. net.http.client
+  const char *getName(void) { return m_name; }
+
+  /// @brief Return the Logger the child writes through
+  Logger *getLogger(void) { return m_root; }
+
+private:
+
+  friend class Logger;
+
+  /// @brief Constructor, children are created by Logger::getChild()
+  /// @param [in] root the Logger
+  /// @param [in] parent the parent, NULL for a top level child
+  /// @param [in] name the full name
+  /// @param [in] len length of \a name
+  LogChild(Logger *root, LogChild *parent, const char *name, size_t len);
+
+  /// Destructor, deletes the children as well
+  ~LogChild();
+
+  LogChild(const LogChild&) = delete;
+  LogChild &operator=(const LogChild&) = delete;
+
+  /// @brief Resolve the effective level of the child and its subtree, called with the config lock of the Logger held
+  /// @param [in] inherited effective level of the parent
+  /// @param [in] floor highest level of the attached sinks and the recorder
+  void resolve(int inherited, int floor);
+
+  /// @brief Return the child named \a name among \a first and its siblings, NULL if there is none
+  /// @param [in] first first child of the list
+  /// @param [in] name the last part of the name
+  /// @param [in] len length of \a name
+  static LogChild *find(LogChild *first, const char *name, size_t len);
+
+  /// @brief Log a message of level \a lev
+  void logv(CfgLog::level_e lev, const char *fmt, va_list args);
+
+  /// @brief Log a message with key/value fields
+  void logKv(CfgLog::level_e lev, const char *msg, std::initializer_list<LogJson::field_t> list) {
+    if (!isEnabled(lev)) {
+      m_root->countFiltered(lev);
+      return;
+    }
+    m_root->logKvAs(lev, m_outLevel.load(std::memory_order_relaxed), msg, list);
+  }
+
+  /// @brief Format a message of the type-safe API and log it
+  template<typename F, typename... Args>
+  void logFmt(CfgLog::level_e lev, F fmt, const Args&... args) {
+    static_assert(LogFormat::valid(F::value()), "malformed placeholder in format string");
+    static_assert(LogFormat::count(F::value()) == sizeof...(Args), "number of arguments does not match the format string");
+    static_assert(LogFormat::check<F, 0, Args...>(), "argument type does not match its placeholder");
+
+    if (!isEnabled(lev)) {
+      m_root->countFiltered(lev);
+      return;
+    }
+    m_root->logFmtAs(lev, m_outLevel.load(std::memory_order_relaxed), fmt, args...);
+  }
+
+  Logger   *m_root;                 ///< the Logger written through
+  LogChild *m_parent;               ///< the parent, NULL for top level children
+  LogChild *m_first;                ///< first child
+  LogChild *m_next;                 ///< next sibling
+  char     *m_name;                 ///< full name
+  const char *m_base;               ///< last part of m_name
+  int       m_level;                ///< level override, -1 to follow the parent
+  std::atomic<int> m_outLevel;      ///< effective level, applied to msgs by the output
+  std::atomic<int> m_enabled;       ///< highest of m_outLevel, the attached sinks and the recorder, read by every logging call
+
+};
+
+#endif //_CPP_LOGGER_CHILD_H_
@@ -0,0 +1,107 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logDedup.h
+/// @brief Header file of the LogDedup duplicate msg filter
+
+#ifndef _CPP_LOGGER_DEDUP_H_
+#define _CPP_LOGGER_DEDUP_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+/// @brief LogDedup class
+///
+/// Suppresses exact repeats of a msg within a time window. Msgs are keyed on the format
+/// string of the call and the formatted payload, and kept in a small fixed-size hash table,
+/// one msg per slot. A repeat within the window of its slot is counted instead of logged.<br>
+/// The count is reported as a summary line "last message repeated N times: msg"
+/// - when another msg is logged,
+/// - when the msg is logged again after its window has closed,
+/// - when a colliding msg takes its slot,
+/// - or by expire() once the window has closed.
+///
+/// Each slot has its own lock, so threads logging different msgs rarely contend.
+class LogDedup {
+public:
+
+  static const int CSlots         = 64;                 ///< number of msgs tracked at once, a power of two
+  static const int CMaxTextLen    = 512;                ///< longer msgs are never suppressed
+  static const int CMaxSummaryLen = CMaxTextLen + 48;   ///< max length of a summary line
+  static const int CMaxSummaries  = 2;                  ///< max number of summaries returned by check()
+
+  /// A summary of suppressed repeats
+  typedef struct summary {
+    int  level;                   ///< level of the suppressed msg
+    int  len;                     ///< length of text
+    char text[CMaxSummaryLen];    ///< the summary line
+  } summary_t;
+
+  /// @brief Constructor
+  /// @param [in] windowMs repeats within this many milliseconds after a msg are suppressed
+  LogDedup(int windowMs);
+
+  /// Destructor
+  ~LogDedup();
+
+  /// @brief Check a msg before it is logged
+  /// @param [in] key format string of the call
+  /// @param [in] level msg level
+  /// @param [in] msg the formatted payload
+  /// @param [in] len length of \a msg
+  /// @param [in] now monotonic time in milliseconds
+  /// @param [out] sums room for CMaxSummaries summaries to log before the msg
+  /// @param [out] cnt number of summaries written to \a sums
+  /// @return true if the msg is a repeat and must not be logged
+  bool check(const void *key, int level, const char *msg, int len, uint64_t now, summary_t *sums, int *cnt);
+
+  /// @brief Check whether a window may have closed with repeats left to report
+  /// @param [in] now monotonic time in milliseconds
+  /// @return true if expire() should be called
+  bool expiring(uint64_t now) const { return now >= m_nextExpiry.load(std::memory_order_relaxed); }
+
+  /// @brief Report the next msg whose window has closed with suppressed repeats
+  /// Call repeatedly with the same \a cursor, starting at 0, until it returns false.
+  /// @param [in] now monotonic time in milliseconds, UINT64_MAX to report all repeats
+  /// @param [in,out] cursor slot to continue at
+  /// @param [out] sum the summary
+  /// @return true if \a sum was filled
+  bool expire(uint64_t now, int *cursor, summary_t *sum);
+
+private:
+
+  /// A tracked msg
+  typedef struct entry {
+    std::mutex       lock;              ///< protects the entry
+    const void      *key;               ///< format string, NULL if the slot is unused
+    uint64_t         hash;              ///< hash of key and text
+    int              level;             ///< msg level
+    int              len;               ///< length of text
+    uint64_t         start;             ///< start of the window in ms
+    std::atomic<int> count;             ///< repeats suppressed in the window, written under lock
+    char             text[CMaxTextLen]; ///< the msg
+  } entry_t;
+
+  entry_t              *m_slots;      ///< the hash table
+  uint64_t              m_window;     ///< window length in ms
+  std::atomic<int>      m_last;       ///< slot of the msg logged last, -1 if none
+  std::atomic<uint64_t> m_nextExpiry; ///< earliest close of a window with repeats, UINT64_MAX if none
+
+  /// Write the summary of \a e into \a sum and reset its count
+  void summarize(entry_t *e, summary_t *sum);
+
+  /// Report the repeats of the msg logged last unless it is in slot \a slot
+  void reportLast(int slot, summary_t *sums, int *cnt);
+
+  /// Lower m_nextExpiry to \a at
+  void armExpiry(uint64_t at);
+
+};
+
+#endif //_CPP_LOGGER_DEDUP_H_
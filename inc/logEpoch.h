@@ -0,0 +1,121 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logEpoch.h
+/// @brief Header file of the LogEpoch reclamation of replaced configurations
+
+#ifndef _CPP_LOGGER_EPOCH_H_
+#define _CPP_LOGGER_EPOCH_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+
+/// @brief LogEpoch class
+///
+/// Epoch based reclamation for the immutable configuration snapshots of all Loggers.<br>
+/// Logging threads read a snapshot between enter() and leave(), which only store the current
+/// epoch into a slot of the thread and clear it again. A replaced snapshot is handed to retire()
+/// and freed once no thread is still inside a section that began before it was replaced.
+///
+/// Readers take no lock and no atomic read-modify-write. Their slot store is ordered before the
+/// snapshot load by a membarrier() issued by the writer, so readers need no fence either; kernels
+/// without membarrier make readers issue a full fence instead. Threads beyond CSlots share a
+/// counter that holds back all reclamation while it is not 0.
+class LogEpoch {
+public:
+
+  static const int CSlots = 64;   ///< number of threads reading with a slot of their own
+
+  /// Keeps the calling thread inside a section for the lifetime of the guard
+  class guard {
+  public:
+    guard()  { enter(); }
+    ~guard() { leave(); }
+  private:
+    guard(const guard&) = delete;
+    guard &operator=(const guard&) = delete;
+  };
+
+  /// @brief Begin reading snapshots, sections may nest
+  static void enter(void) {
+    if (s_depth++ > 0) return;
+    int i = s_slot;
+    if (i < 0) i = claim();
+    if (i == CSlots) {
+      s_shared.fetch_add(1, std::memory_order_seq_cst);
+      return;
+    }
+    s_slots[i].epoch.store(s_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+    if (s_membarrier.load(std::memory_order_relaxed)) std::atomic_signal_fence(std::memory_order_seq_cst);
+    else std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  /// @brief End reading snapshots, none of them may be used afterwards
+  static void leave(void) {
+    if (--s_depth > 0) return;
+    if (s_slot == CSlots) s_shared.fetch_sub(1, std::memory_order_release);
+    else s_slots[s_slot].epoch.store(0, std::memory_order_release);
+  }
+
+  /// @brief Hand over \a ptr to be freed once no reader can hold it anymore, by the next reclaim()
+  /// The caller has already replaced it, readers entering from now on do not see it.
+  /// @param [in] ptr the replaced object, NULL is ignored
+  /// @param [in] release frees \a ptr
+  static void retire(void *ptr, void (*release)(void*));
+
+  /// @brief Free the retired objects no reader holds anymore
+  /// @return number of objects still waiting
+  static int reclaim(void);
+
+private:
+
+  /// The epoch a thread entered in, 0 outside of a section, on a cache line of its own
+  typedef struct alignas(64) slot {
+    std::atomic<uint64_t> epoch;
+  } slot_t;
+
+  /// A retired object
+  typedef struct retired {
+    void            *ptr;                 ///< the object
+    void           (*release)(void*);     ///< frees ptr
+    uint64_t         epoch;               ///< first epoch not holding ptr
+    struct retired  *next;                ///< next retired object
+  } retired_t;
+
+  /// Hands the slot of a thread back when it exits
+  typedef struct owner {
+    int slot;       ///< the owned slot, -1 if none
+    ~owner();
+  } owner_t;
+
+  static slot_t                s_slots[CSlots];  ///< the slots
+  static std::atomic<uint64_t> s_owned;          ///< bit i is set while a thread owns slot i
+  static std::atomic<uint64_t> s_shared;         ///< threads without a slot inside a section
+  static std::atomic<uint64_t> s_epoch;          ///< current epoch, starting at 1
+  static std::atomic<bool>     s_membarrier;     ///< writers order the slot stores of readers with membarrier()
+  static std::mutex            s_lock;           ///< serializes retire() and reclaim()
+  static retired_t            *s_retired;        ///< objects waiting to be freed
+
+  static thread_local int      s_slot;           ///< slot of the calling thread, CSlots for none, -1 until claimed
+  static thread_local int      s_depth;          ///< nesting of enter() in the calling thread
+  static thread_local owner_t  s_owner;          ///< releases s_slot
+
+  /// Claim a slot for the calling thread, CSlots if all are taken
+  static int claim(void);
+
+  /// Make the slot stores of all readers visible and ordered before their following loads
+  static void barrier(void);
+
+  /// Free the retired objects of epochs no reader is in anymore, called with s_lock held
+  static int reclaimLocked(void);
+
+};
+
+#endif //_CPP_LOGGER_EPOCH_H_
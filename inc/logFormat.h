@@ -0,0 +1,201 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logFormat.h
+/// @brief Header file of the LogFormat type-safe message formatter
+
+#ifndef _CPP_LOGGER_FORMAT_H_
+#define _CPP_LOGGER_FORMAT_H_
+
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+
+/// @brief Wrap a string literal as a compile-time format string for the type-safe Logger API
+///
+/// @code
+/// log->info(LOGGER_FMT("user {} took {} us"), id, dt);
+/// @endcode
+#define LOGGER_FMT(str) \
+  ([]() { \
+    struct fmt_t : LogFormat::Tag { \
+      static constexpr const char *value() { return str; } \
+    }; \
+    return fmt_t(); \
+  }())
+
+/// @brief LogFormat class
+///
+/// Formats messages of the type-safe Logger API. A format string contains placeholders
+/// which are replaced by the arguments in order:
+/// Placeholder | Meaning
+/// ----------- | -------
+/// {}          | the argument in its natural format
+/// {:x}        | an integer in hexadecimal
+/// {:.N}       | a floating point number with N (0-9) decimals
+/// {{ and }}   | literal braces
+///
+/// The format string is parsed at compile time: malformed placeholders, a wrong number of
+/// arguments and placeholders not matching their argument's type are compile errors.
+/// Numbers are converted without printf and independent of the locale.
+class LogFormat {
+public:
+
+  /// Base of the format types created by LOGGER_FMT()
+  struct Tag {};
+
+  /// Check whether \a F is a format type created by LOGGER_FMT()
+  template<typename F>
+  struct IsFormat : std::is_base_of<Tag, F> {};
+
+  /// @brief Check the syntax of a format string
+  /// @param [in] f the format string
+  /// @return true if all braces form valid placeholders or escapes
+  static constexpr bool valid(const char *f) {
+    return (*f == '\0') ? true :
+           ((f[0] == '{') && (f[1] == '{')) ? valid(f + 2) :
+           ((f[0] == '}') && (f[1] == '}')) ? valid(f + 2) :
+           (f[0] == '{') ? validSpec(f + 1) :
+           (f[0] == '}') ? false :
+           valid(f + 1);
+  }
+
+  /// @brief Count the placeholders of a format string
+  /// @param [in] f the format string
+  /// @return number of placeholders
+  static constexpr int count(const char *f) {
+    return (*f == '\0') ? 0 :
+           (((f[0] == '{') && (f[1] == '{')) || ((f[0] == '}') && (f[1] == '}'))) ? count(f + 2) :
+           (f[0] == '{') ? 1 + count(close(f)) :
+           count(f + 1);
+  }
+
+  /// @brief Check that each argument type matches its placeholder
+  /// @return true if all arguments match
+  template<typename F, int I>
+  static constexpr bool check() {
+    return true;
+  }
+
+  template<typename F, int I, typename T, typename... Rest>
+  static constexpr bool check() {
+    return matches<typename std::decay<T>::type>(spec(F::value(), I)) && check<F, I + 1, Rest...>();
+  }
+
+  /// @brief Format a message
+  /// @param [in] pos where to write to
+  /// @param [in] end end of the buffer, nothing is written at or after it
+  /// @param [in] fmt the format string, checked at compile time
+  /// @param [in] args the arguments
+  /// @return position after the message
+  static char *format(char *pos, char *end, const char *fmt) {
+    return literal(pos, end, &fmt);
+  }
+
+  template<typename T, typename... Rest>
+  static char *format(char *pos, char *end, const char *fmt, const T &val, const Rest&... rest) {
+    pos = literal(pos, end, &fmt);
+    char kind = (fmt[1] == ':') ? fmt[2] : '\0';
+    int  prec = (kind == '.') ? fmt[3] - '0' : -1;
+    pos = put(pos, end, val, kind, prec);
+    return format(pos, end, close(fmt), rest...);
+  }
+
+private:
+
+  /// Position after the placeholder starting at \a f
+  static constexpr const char *close(const char *f) {
+    return (*f == '\0') ? f : (*f == '}') ? f + 1 : close(f + 1);
+  }
+
+  /// Check a placeholder after its opening brace
+  static constexpr bool validSpec(const char *s) {
+    return (s[0] == '}') ? valid(s + 1) :
+           ((s[0] == ':') && (s[1] == 'x') && (s[2] == '}')) ? valid(s + 3) :
+           ((s[0] == ':') && (s[1] == '.') && (s[2] >= '0') && (s[2] <= '9') && (s[3] == '}')) ? valid(s + 4) :
+           false;
+  }
+
+  /// Kind of the placeholder number \a n: '\0' for {}, 'x' or '.'
+  static constexpr char spec(const char *f, int n) {
+    return (*f == '\0') ? '\0' :
+           (((f[0] == '{') && (f[1] == '{')) || ((f[0] == '}') && (f[1] == '}'))) ? spec(f + 2, n) :
+           (f[0] == '{') ? ((n == 0) ? ((f[1] == ':') ? f[2] : '\0') : spec(close(f), n - 1)) :
+           spec(f + 1, n);
+  }
+
+  /// Check whether type \a T can be formatted by a placeholder of kind \a kind
+  template<typename T>
+  static constexpr bool matches(char kind) {
+    return (kind == '\0') ? formattable<T>() :
+           (kind == 'x') ? (std::is_integral<T>::value && !std::is_same<T, bool>::value) :
+           std::is_floating_point<T>::value;
+  }
+
+  template<typename T>
+  static constexpr bool formattable() {
+    return std::is_arithmetic<T>::value || std::is_pointer<T>::value ||
+           std::is_same<T, std::string>::value || std::is_same<T, std::nullptr_t>::value;
+  }
+
+  /// Copy literal text up to the next placeholder, which \a fmt points to on return
+  static char *literal(char *pos, char *end, const char **fmt);
+
+  static char *putInt(char *pos, char *end, int64_t val, bool hex);
+  static char *putUint(char *pos, char *end, uint64_t val, bool hex);
+  static char *putFloat(char *pos, char *end, double val, int prec);
+  static char *putStr(char *pos, char *end, const char *str, size_t len);
+  static char *putPtr(char *pos, char *end, const void *ptr);
+
+  // formatting of the supported argument types
+  static char *put(char *pos, char *end, bool val, char, int) {
+    return val ? putStr(pos, end, "true", 4) : putStr(pos, end, "false", 5);
+  }
+  static char *put(char *pos, char *end, char val, char kind, int) {
+    return (kind == 'x') ? putUint(pos, end, (unsigned char)val, true) : putStr(pos, end, &val, 1);
+  }
+  template<typename T>
+  static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, char*>::type
+  put(char *pos, char *end, T val, char kind, int) {
+    return (kind == 'x') ? putUint(pos, end, (uint64_t)(typename std::make_unsigned<T>::type)val, true)
+                         : putInt(pos, end, val, false);
+  }
+  template<typename T>
+  static typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, char*>::type
+  put(char *pos, char *end, T val, char kind, int) {
+    return putUint(pos, end, val, (kind == 'x'));
+  }
+  template<typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value, char*>::type
+  put(char *pos, char *end, T val, char, int prec) {
+    return putFloat(pos, end, val, prec);
+  }
+  static char *put(char *pos, char *end, const char *val, char, int) {
+    return (val == NULL) ? putStr(pos, end, "(null)", 6) : putStr(pos, end, val, SIZE_MAX);
+  }
+  static char *put(char *pos, char *end, char *val, char kind, int prec) {
+    return put(pos, end, (const char*)val, kind, prec);
+  }
+  static char *put(char *pos, char *end, const std::string &val, char, int) {
+    return putStr(pos, end, val.data(), val.size());
+  }
+  static char *put(char *pos, char *end, std::nullptr_t, char, int) {
+    return putPtr(pos, end, NULL);
+  }
+  template<typename T>
+  static char *put(char *pos, char *end, T *val, char, int) {
+    return putPtr(pos, end, (const void*)val);
+  }
+  template<size_t N>
+  static char *put(char *pos, char *end, const char (&val)[N], char kind, int prec) {
+    return put(pos, end, (const char*)val, kind, prec);
+  }
+
+};
+
+#endif //_CPP_LOGGER_FORMAT_H_
@@ -0,0 +1,125 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logJson.h
+/// @brief Header file of the LogJson encoder for JSON lines and key/value fields
+
+#ifndef _CPP_LOGGER_JSON_H_
+#define _CPP_LOGGER_JSON_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+
+/// @brief LogJson class
+///
+/// Encodes msgs and typed key/value fields, straight into the output buffer:
+/// - as JSON string and object members for JSON patterns, see CfgLog::ELogProfileJson,
+/// - as <i>key=value</i> pairs appended to the msg for all other patterns.
+///
+/// String escaping scans 32 (AVX2) or 16 (SSE2) bytes at a time for quotes, backslashes and
+/// control characters and copies clean runs in one store, other CPUs take the scalar loop.
+/// Bytes of 0x80 and above are copied as they are, UTF-8 passes unchanged.
+class LogJson {
+public:
+
+  /// Value types of a field
+  enum {
+    EFieldString = 0,
+    EFieldInt,
+    EFieldUint,
+    EFieldDouble,
+    EFieldBool
+  };
+
+  /// @brief A typed key/value field, e.g. {"status", 200}
+  /// Strings are referenced, not copied: a field is only valid during the logging call.
+  typedef struct field {
+    const char *key;      ///< the key, a null terminated string
+    int         type;     ///< one of EFieldString ... EFieldBool
+    union {
+      struct {
+        const char *ptr;
+        size_t      len;
+      } s;                ///< EFieldString
+      int64_t  i;         ///< EFieldInt
+      uint64_t u;         ///< EFieldUint
+      double   d;         ///< EFieldDouble
+      bool     b;         ///< EFieldBool
+    } val;                ///< the value
+
+    field(const char *k, const char *v)        : key(k), type(EFieldString) { val.s.ptr = (v != NULL) ? v : ""; val.s.len = strlen(val.s.ptr); }
+    field(const char *k, const std::string &v) : key(k), type(EFieldString) { val.s.ptr = v.c_str(); val.s.len = v.size(); }
+    field(const char *k, bool v)               : key(k), type(EFieldBool)   { val.b = v; }
+    field(const char *k, int v)                : key(k), type(EFieldInt)    { val.i = v; }
+    field(const char *k, long v)               : key(k), type(EFieldInt)    { val.i = v; }
+    field(const char *k, long long v)          : key(k), type(EFieldInt)    { val.i = v; }
+    field(const char *k, unsigned v)           : key(k), type(EFieldUint)   { val.u = v; }
+    field(const char *k, unsigned long v)      : key(k), type(EFieldUint)   { val.u = v; }
+    field(const char *k, unsigned long long v) : key(k), type(EFieldUint)   { val.u = v; }
+    field(const char *k, double v)             : key(k), type(EFieldDouble) { val.d = v; }
+  } field_t;
+
+  /// The fields of a record
+  typedef struct fields {
+    const field_t *list;  ///< the fields
+    int            cnt;   ///< number of fields in list
+  } fields_t;
+
+  /// @brief Write \a str as JSON string contents, without the quotes
+  /// @param [in] pos where to write
+  /// @param [in] end end of the buffer
+  /// @param [in] str the string
+  /// @param [in] len length of \a str
+  /// @return the end of the written text, NULL if it does not fit
+  static char *escape(char *pos, const char *end, const char *str, size_t len);
+
+  /// @brief Scalar version of escape(), used for the tails of the vectorized loops
+  static char *escapeScalar(char *pos, const char *end, const char *str, size_t len);
+
+  /// @brief Write \a msg as JSON string followed by \a fields as members of the enclosing object
+  /// The result is <i>"msg","key":value,...</i>
+  /// @param [in] pos where to write
+  /// @param [in] end end of the buffer
+  /// @param [in] msg the msg
+  /// @param [in] len length of \a msg
+  /// @param [in] fields the fields, NULL if there are none
+  /// @return the end of the written text, NULL if it does not fit
+  static char *json(char *pos, const char *end, const char *msg, size_t len, const fields_t *fields);
+
+  /// @brief Write \a msg followed by \a fields as <i>key=value</i> pairs
+  /// Values containing blanks, quotes, '=' or control characters are quoted and escaped like JSON strings.
+  /// @param [in] pos where to write
+  /// @param [in] end end of the buffer
+  /// @param [in] msg the msg
+  /// @param [in] len length of \a msg
+  /// @param [in] fields the fields, NULL if there are none
+  /// @return the end of the written text, NULL if it does not fit
+  static char *text(char *pos, const char *end, const char *msg, size_t len, const fields_t *fields);
+
+  /// @brief Return the max length of json() or text() for a msg of \a len bytes and \a fields
+  static size_t maxLen(size_t len, const fields_t *fields);
+
+private:
+
+  /// Write the value of \a f as JSON value
+  static char *jsonValue(char *pos, const char *end, const field_t *f);
+
+  /// Write a signed integer
+  static char *putInt(char *pos, const char *end, int64_t v);
+
+  /// Write an unsigned integer
+  static char *putUint(char *pos, const char *end, uint64_t v);
+
+  /// Write a double with the shortest of 15 or 17 digits that reads back the same, NaN and infinities as null
+  static char *putDouble(char *pos, const char *end, double v);
+
+};
+
+#endif //_CPP_LOGGER_JSON_H_
@@ -0,0 +1,99 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logLimit.h
+/// @brief Header file of the LogLimit per call site rate limiter and sampler
+
+#ifndef _CPP_LOGGER_LIMIT_H_
+#define _CPP_LOGGER_LIMIT_H_
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+
+class LogChild;
+
+/// @brief LogLimit class
+///
+/// Decides whether a call of a rate limited or sampled call site is logged, see the
+/// LOGGER_*_RATE and LOGGER_*_SAMPLE macros. Each call site keeps its state in a static
+/// site_t, so the decision is made with a few relaxed atomic operations before any
+/// argument is evaluated or formatted.<br>
+/// Suppressed calls are counted and handed back once per second, with the first call
+/// of a call site that is logged in a new second, to be reported by the Logger. A call site
+/// which falls silent after suppressing calls is listed with the Logger instead, whose timer
+/// thread reports the count within a second, see Logger::suppressed().
+class LogLimit {
+public:
+
+  /// State of a call site, zero initialized as a static
+  typedef struct site {
+    std::atomic<uint32_t> window;     ///< second of the current window
+    std::atomic<uint32_t> count;      ///< calls in the window (rate) or in total (sample)
+    std::atomic<uint32_t> dropped;    ///< calls suppressed since the last report
+    std::atomic<bool>     listed;     ///< the site waits in the list of a Logger for its report
+    struct site          *next;       ///< next listed site, set by the thread listing it
+    const char           *file;       ///< source file of the call site, set when listed
+    int                   line;       ///< source line of the call site, set when listed
+    int                   level;      ///< level of the call site, set when listed
+    LogChild             *child;      ///< child logger the site logs through, NULL for the Logger
+  } site_t;
+
+  /// @brief Check a call of a rate limited call site
+  /// @param [in,out] site state of the call site
+  /// @param [in] perSec max number of calls logged per second
+  /// @param [out] report calls suppressed in the previous windows, to be reported, 0 if none
+  /// @return true if the call is logged
+  static bool rate(site_t *site, uint32_t perSec, uint32_t *report) {
+    uint32_t now = seconds();
+    uint32_t w = site->window.load(std::memory_order_relaxed);
+
+    *report = 0;
+    if ((w != now) && site->window.compare_exchange_strong(w, now, std::memory_order_relaxed)) {
+      // the first call of a new second starts its window, racing calls may slip through
+      site->count.store(0, std::memory_order_relaxed);
+      *report = site->dropped.exchange(0, std::memory_order_relaxed);
+    }
+    if (site->count.fetch_add(1, std::memory_order_relaxed) < perSec) return true;
+    site->dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  /// @brief Check a call of a sampled call site
+  /// @param [in,out] site state of the call site
+  /// @param [in] every log the first of every \a every calls
+  /// @param [out] report calls suppressed in the previous windows, to be reported, 0 if none
+  /// @return true if the call is logged
+  static bool sample(site_t *site, uint32_t every, uint32_t *report) {
+    *report = 0;
+    if ((every > 1) && (site->count.fetch_add(1, std::memory_order_relaxed) % every != 0)) {
+      site->dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    // only logged calls read the clock
+    uint32_t now = seconds();
+    uint32_t w = site->window.load(std::memory_order_relaxed);
+    if ((w != now) && site->window.compare_exchange_strong(w, now, std::memory_order_relaxed)) {
+      *report = site->dropped.exchange(0, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+private:
+
+  /// Coarse monotonic seconds, served from the vDSO without reading the TSC
+  static uint32_t seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint32_t)ts.tv_sec;
+  }
+
+};
+
+#endif //_CPP_LOGGER_LIMIT_H_
@@ -0,0 +1,95 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logQueue.h
+/// @brief Header file of the LogQueue used for asynchronous logging
+
+#ifndef _CPP_LOGGER_QUEUE_H_
+#define _CPP_LOGGER_QUEUE_H_
+
+#include <stddef.h>
+#include <atomic>
+
+/// @brief LogQueue class
+///
+/// A preallocated, bounded, lock-free multi-producer single-consumer ring of log records.<br>
+/// Producers claim a slot with a single CAS on the enqueue position, render the record
+/// directly into the slot and publish it by updating the slot's sequence number.
+/// The single consumer (the Logger's writer thread) drains published slots in order.<br>
+/// A record longer than a slot claims several consecutive slots at once, which the consumer
+/// drains like any others, so its pieces are written back to back.
+class LogQueue {
+public:
+
+  static const int CMaxRecordLen = 512;   ///< max length of a record in one slot
+
+  /// A queued log record
+  typedef struct record {
+    std::atomic<size_t> seq;              ///< slot sequence number
+    int  level;                           ///< record level
+    int  len;                             ///< length of msg
+    char msg[CMaxRecordLen];              ///< the formatted record, or a piece of it
+  } record_t;
+
+  /// @brief Constructor
+  /// @param [in] len number of slots, rounded up to the next power of two
+  LogQueue(int len);
+
+  /// Destructor
+  ~LogQueue();
+
+  /// @brief Claim free slots (producer side)
+  /// @param [out] pos queue position of the first claimed slot, to be passed to commit()
+  /// @param [in] cnt number of consecutive slots to claim
+  /// @return pointer to the first slot, NULL if the queue has not enough room
+  record_t *reserve(size_t *pos, size_t cnt = 1);
+
+  /// @brief Return the slot of a claimed queue position
+  /// @param [in] pos a queue position returned by reserve(), plus the index of a further claimed slot
+  /// @return pointer to the slot
+  record_t *at(size_t pos) { return &m_ring[pos & m_mask]; }
+
+  /// @brief Publish a slot previously claimed by reserve() (producer side)
+  /// @param [in] rec the slot
+  /// @param [in] pos queue position of the slot
+  void commit(record_t *rec, size_t pos);
+
+  /// @brief Return a published slot (consumer side)
+  /// @param [in] ahead number of slots to look past the oldest one
+  /// @return pointer to the slot, NULL if no record is ready
+  record_t *peek(size_t ahead = 0);
+
+  /// @brief Hand the oldest slots back to the producers (consumer side)
+  /// @param [in] cnt number of slots, all of which must have been returned by peek()
+  void release(size_t cnt = 1);
+
+  /// @brief Return the enqueue position, i.e. the number of slots ever claimed
+  size_t head(void) { return m_head.load(std::memory_order_acquire); }
+
+  /// @brief Return the dequeue position, i.e. the number of slots ever released
+  size_t tail(void) { return m_tail.load(std::memory_order_acquire); }
+
+  /// @brief Return the number of free slots (approximate while producers are active)
+  size_t space(void);
+
+  /// @brief Return the number of slots
+  size_t capacity(void) { return m_mask + 1; }
+
+private:
+
+  record_t            *m_ring;            ///< the slots
+  size_t               m_mask;            ///< capacity - 1
+
+  char                 m_pad0[64];        ///< keep the positions on separate cache lines
+  std::atomic<size_t>  m_head;            ///< next position to be claimed by a producer
+  char                 m_pad1[64];
+  std::atomic<size_t>  m_tail;            ///< next position to be read by the consumer
+
+};
+
+#endif //_CPP_LOGGER_QUEUE_H_
@@ -0,0 +1,123 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logRecorder.h
+/// @brief Header file of the LogRecorder flight recorder
+
+#ifndef _CPP_LOGGER_RECORDER_H_
+#define _CPP_LOGGER_RECORDER_H_
+
+#include "log.h"
+#include <stdint.h>
+#include <stdarg.h>
+#include <atomic>
+#include <mutex>
+
+/// @brief LogRecorder class
+///
+/// A process wide flight recorder keeping the last records of each thread in memory.
+/// Records are encoded by LogBinary, so capturing a record copies its raw arguments into the
+/// next slot of the calling thread's ring without formatting, locking or allocating. Each record
+/// is tagged with the Logger capturing it.<br>
+/// The rings are written out in timestamp order
+/// - as text through a Logger by dump(), which replays the records of that Logger not dumped before,
+/// - or from a handler for SIGSEGV and SIGABRT as binary logfile, which only uses
+///   async-signal-safe calls and is decoded with <i>logdecode</i>.
+///
+/// A thread gets its ring with its first record and hands it on to a later thread when it exits.
+class LogRecorder {
+public:
+
+  static const int CSlotLen  = 240;     ///< max length of an encoded record, longer ones are cut
+  static const int CMaxRings = 256;     ///< max number of threads recording at once
+
+  /// @brief Enable recording, the first call sets the ring size for good
+  /// @param [in] records number of records kept per thread, rounded up to a power of two
+  /// @param [in] crashFile where the signal handler writes the rings, NULL or empty to install none
+  static void enable(int records, const char *crashFile);
+
+  /// @brief Capture a record into the ring of the calling thread
+  /// @param [in] owner the Logger the record is logged through
+  /// @param [in] lev msg level
+  /// @param [in] fmt the msg payload
+  /// @param [in] args arguments to \a fmt
+  static void record(const Logger *owner, CfgLog::level_e lev, const char *fmt, va_list args);
+
+  /// @brief Capture an already formatted record
+  /// @param [in] owner the Logger the record is logged through
+  /// @param [in] lev msg level
+  /// @param [in] fmt "%s"
+  /// @param [in] ... the msg
+  static void recordf(const Logger *owner, CfgLog::level_e lev, const char *fmt, ...);
+
+  /// @brief Render the records of a Logger not dumped before, oldest first
+  /// @param [in] out the Logger whose records are written to it, they keep their time, thread and level
+  /// @return number of records written
+  static int dump(Logger *out);
+
+  /// @brief Write all records to \a fd as binary logfile, async-signal-safe
+  /// @param [in] fd an open file descriptor
+  static void dumpBinary(int fd);
+
+private:
+
+  /// A slot of a ring, guarded by a sequence number while it is written
+  typedef struct slot {
+    std::atomic<uint64_t> seq;      ///< 2 * (position + 1) once written, odd while being written
+    uint32_t owner;                 ///< Logger::m_recId of the Logger which captured the record
+    uint16_t len;                   ///< length of rec
+    char     rec[CSlotLen];         ///< the encoded record
+  } slot_t;
+
+  /// The ring of a thread
+  typedef struct ring {
+    std::atomic<long>     owner;    ///< thread id of the owner, 0 if free
+    std::atomic<uint64_t> head;     ///< number of records written
+    slot_t *slots;                  ///< the slots, s_len of them
+  } ring_t;
+
+  /// Read position of a ring while merging
+  typedef struct cursor {
+    uint64_t pos;     ///< next record
+    uint64_t end;     ///< head at the start of the merge
+  } cursor_t;
+
+  /// Called for each merged record
+  typedef void (*emit_t)(void *arg, const char *rec, int len);
+
+  static LogBinary            *s_binary;        ///< encoder and dictionary of the records
+  static std::atomic<ring_t*>  s_rings[CMaxRings]; ///< rings handed out so far, NULL while being set up
+  static std::atomic<int>      s_ringCnt;       ///< number of rings handed out
+  static int                   s_len;           ///< slots per ring, a power of two
+  static std::mutex            s_lock;          ///< serializes enable() and dump()
+  static char                  s_crashFile[CfgLog::CMaxPathLen];  ///< target of the signal handler
+  static std::atomic<bool>     s_crashed;       ///< set by the first signal handled
+
+  /// Return the ring of the calling thread, NULL if none is left
+  static ring_t *ring(void);
+
+  /// @brief Merge the rings by record time
+  /// @param [in,out] cur one cursor per ring, CMaxRings of them
+  /// @param [in] owner merge the records of the Logger with this Logger::m_recId only, 0 for all records
+  /// @param [in] emit called with each record
+  /// @param [in] arg passed to \a emit
+  /// @return number of records
+  static int merge(cursor_t *cur, uint32_t owner, emit_t emit, void *arg);
+
+  /// Render a record through the Logger passed as \a arg
+  static void emitText(void *arg, const char *rec, int len);
+
+  /// Write a record to the file descriptor pointed to by \a arg
+  static void emitRaw(void *arg, const char *rec, int len);
+
+  /// Handler of SIGSEGV and SIGABRT
+  static void onSignal(int sig);
+
+};
+
+#endif //_CPP_LOGGER_RECORDER_H_
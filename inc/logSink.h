@@ -0,0 +1,301 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logSink.h
+/// @brief Header file of the LogSink output backends
+
+#ifndef _CPP_LOGGER_SINK_H_
+#define _CPP_LOGGER_SINK_H_
+
+#include <sys/uio.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+/// @brief LogSink class
+///
+/// Interface of an output backend. A sink receives finished records as
+/// a vector of pieces (color escape, header, payload, postfix, ...).
+class LogSink {
+public:
+
+  /// Return values used by LogSink
+  enum { EErr = 0, ENoErr };
+
+  /// Destructor
+  virtual ~LogSink() {}
+
+  /// @brief Write whole records
+  /// @param [in] iov the pieces of one or more complete records
+  /// @param [in] cnt number of pieces in \a iov
+  /// @return EErr on failure, ENoErr on success
+  virtual int write(const struct iovec *iov, int cnt) = 0;
+
+  /// @brief Write one record of loglevel \a level
+  /// Called by the Logger for each record, sinks framing records by their level override it.
+  /// @param [in] level the CfgLog::level_e of the record
+  /// @param [in] iov the pieces of the record
+  /// @param [in] cnt number of pieces in \a iov
+  /// @return EErr on failure, ENoErr on success
+  virtual int writeRecord(int level, const struct iovec *iov, int cnt) { (void)level; return write(iov, cnt); }
+
+  /// @brief Write out anything the sink has buffered
+  /// @return EErr on failure, ENoErr on success
+  virtual int flush(void) = 0;
+
+  /// @brief Write out records which have waited long enough
+  /// Called about every Logger::CSinkTickMs by the timer thread of the Logger the sink is attached to,
+  /// sinks holding records back for a batch override it to bound the delay.
+  virtual void tick(void) {}
+
+};
+
+/// @brief FdSink class
+///
+/// Output backend writing to a raw file descriptor with writev(), bypassing stdio.<br>
+/// In direct mode every call to write() is a single writev() of all pieces, without an
+/// intermediate copy. In batch mode records are coalesced into a buffer which is written
+/// out with one call when it is full or when flush() is called. Records are never split
+/// across two writes, so with O_APPEND each record lands in the file in one piece even
+/// if several processes append to the same file.
+class FdSink : public LogSink {
+public:
+
+  /// @brief Constructor opening a file
+  /// @param [in] path path to the file
+  /// @param [in] batch coalesce records into a buffer
+  /// @param [in] bufSize size of the batch buffer in bytes
+  /// @param [in] append keep existing content instead of truncating the file
+  FdSink(const char *path, bool batch, int bufSize, bool append = false);
+
+  /// @brief Constructor using an open file descriptor, which is not closed by the sink
+  /// @param [in] fd the file descriptor
+  /// @param [in] batch coalesce records into a buffer
+  /// @param [in] bufSize size of the batch buffer in bytes
+  FdSink(int fd, bool batch, int bufSize);
+
+  /// Destructor
+  ~FdSink();
+
+  /// @brief Check whether the file descriptor is usable
+  /// @return true if the sink can be written to
+  bool isOpen(void) { return m_fd >= 0; }
+
+  int write(const struct iovec *iov, int cnt);
+  int flush(void);
+
+private:
+
+  int   m_fd;           ///< the file descriptor
+  bool  m_ownFd;        ///< close m_fd on destruction
+  char *m_buf;          ///< batch buffer, NULL in direct mode
+  int   m_bufSize;      ///< size of m_buf
+  int   m_bufLen;       ///< bytes currently in m_buf
+
+  /// Initialize the batch buffer
+  void initBuffer(bool batch, int bufSize);
+
+  /// Write all pieces, retrying on partial writes
+  int writeAll(const struct iovec *iov, int cnt);
+
+};
+
+/// @brief MmapSink class
+///
+/// Output backend copying records straight into a shared memory mapping of the logfile,
+/// so that the write path issues no syscalls.<br>
+/// The file is grown with fallocate() in chunks of \a chunkSize bytes and one chunk at a time is
+/// mapped. Writers reserve their bytes with an atomic cursor and copy into the mapping concurrently,
+/// only moving on to the next chunk takes a lock. On destruction the file is truncated to the bytes
+/// actually used.<br>
+/// flush() runs msync() on the current chunk, which makes written records durable.
+class MmapSink : public LogSink {
+public:
+
+  static const size_t CChunkSizeDefault = 64 * 1024 * 1024;  ///< default size of a mapped chunk
+
+  /// @brief Constructor
+  /// @param [in] path path to the file
+  /// @param [in] chunkSize size of the preallocated and mapped chunks, rounded up to the page size
+  /// @param [in] append keep existing content and continue writing behind it
+  MmapSink(const char *path, size_t chunkSize, bool append = false);
+
+  /// Destructor
+  ~MmapSink();
+
+  /// @brief Check whether the file could be opened
+  /// @return true if the sink can be written to
+  bool isOpen(void) { return m_fd >= 0; }
+
+  int write(const struct iovec *iov, int cnt);
+  int flush(void);
+
+private:
+
+  /// A mapped chunk of the file
+  typedef struct window {
+    char    *base;      ///< start of the mapping, NULL if unmapped
+    uint64_t start;     ///< file offset of the mapping
+  } window_t;
+
+  int                    m_fd;          ///< the file descriptor
+  size_t                 m_chunk;       ///< chunk size
+  window_t               m_windows[2];  ///< current and previous window
+  std::atomic<window_t*> m_win;         ///< current window
+  std::atomic<uint64_t>  m_cursor;      ///< next free file offset
+  std::atomic<int>       m_users;       ///< writers currently copying through m_win
+  uint64_t               m_synced;      ///< file offset up to which the records were synced, under m_lock
+  std::mutex             m_lock;        ///< serializes moving the window
+
+  /// @brief Map the chunk containing file offset \a off as the current window, m_lock must be held
+  /// @return the new current window, NULL on failure
+  window_t *mapWindow(uint64_t off);
+
+  /// @brief Copy a record to file offset \a off, moving the window as needed, m_lock must be held
+  int copyLocked(uint64_t off, const struct iovec *iov, int cnt);
+
+  /// @brief msync the part of \a win between file offsets \a from and \a to, m_lock must be held
+  /// @return number of bytes of the range within \a win, -1 on failure
+  long syncWindow(const window_t *win, uint64_t from, uint64_t to);
+
+};
+
+/// @brief RingSink class
+///
+/// Output backend keeping the most recent records in memory, e.g. the last debug lines
+/// to be dumped after an error. The records are kept in a preallocated ring of \a lines
+/// entries of up to \a lineLen bytes, the oldest one is overwritten when the ring is full
+/// and longer records are cut. Each call to write() is taken as one record.
+class RingSink : public LogSink {
+public:
+
+  static const int CLineLenDefault = 512;   ///< default max length of a kept record
+
+  /// @brief Constructor
+  /// @param [in] lines number of records to keep
+  /// @param [in] lineLen max length of a record
+  RingSink(int lines, int lineLen = CLineLenDefault);
+
+  /// Destructor
+  ~RingSink();
+
+  int write(const struct iovec *iov, int cnt);
+  int flush(void) { return ENoErr; }
+
+  /// @brief Return the number of records currently kept
+  int count(void);
+
+  /// @brief Write the kept records, oldest first
+  /// @param [in] out stream to write to
+  /// @return EErr on failure, ENoErr on success
+  int dump(FILE *out);
+
+private:
+
+  char    *m_buf;         ///< the records, lineLen bytes each
+  int     *m_len;         ///< length of each record
+  int      m_lines;       ///< number of records in the ring
+  int      m_lineLen;     ///< max length of a record
+  uint64_t m_next;        ///< number of records ever written
+  std::mutex m_lock;      ///< serializes writers and dump()
+
+};
+
+/// @brief SyslogSink class
+///
+/// Output backend sending each record as an RFC 5424 syslog message to a local collector listening
+/// on a Unix datagram socket, such as /dev/log of rsyslog or syslog-ng, or the syslog socket of journald.
+/// The loglevels map onto the syslog severities of the same number, always msgs are sent as notices.
+/// Attach it with a pattern of just <i>&msg</i>, the syslog header already carries time, host, program and pid.<br>
+/// Records are collected in a buffer and sent with one sendmmsg() per \a batch records, right away
+/// for errors and more severe msgs, and by flush(). No record waits much longer than \a maxDelay ms:
+/// the next write or tick() sends the batch once its oldest record is due. The socket never blocks:
+/// while the collector is gone or falls behind, records stay in the buffer up to \a bufLimit bytes
+/// and further ones are dropped and counted. Reconnecting is tried at most every CRetryMs, on the
+/// next write, tick or flush, and is followed by a warning about the records dropped in between.
+class SyslogSink : public LogSink {
+public:
+
+  static const int    CFacilityUser    = 1;                  ///< facility of user level msgs
+  static const int    CFacilityDaemon  = 3;                  ///< facility of system daemons
+  static const int    CFacilityLocal0  = 16;                 ///< first local facility, up to local7 = 23
+  static const int    CSeverityError   = 3;                  ///< severity of errors, records up to it are sent right away
+  static const int    CSeverityWarning = 4;                  ///< severity of warnings
+  static const int    CSeverityNotice  = 5;                  ///< severity of records without a syslog level, e.g. always msgs
+  static const int    CBatchDefault    = 32;                 ///< default number of records per sendmmsg()
+  static const size_t CBufLimitDefault = 1024 * 1024;        ///< default size of the record buffer
+  static const int    CMaxRecordLen    = 8192;               ///< longer records are cut
+  static const int    CRetryMs         = 1000;               ///< min time between two connection attempts
+  static const int    CMaxDelayDefault = 200;                ///< default max time in ms a record waits for its batch
+
+  /// @brief Constructor, connecting right away
+  /// @param [in] path path of the collector socket
+  /// @param [in] facility syslog facility of all records
+  /// @param [in] batch number of records sent with one sendmmsg(), 1 sends each record on its own
+  /// @param [in] bufLimit bytes of records kept while the collector is unreachable
+  /// @param [in] appName APP-NAME of the records, NULL for the name of the program
+  /// @param [in] maxDelay ms after which a buffered record is sent although its batch is not full
+  SyslogSink(const char *path = "/dev/log", int facility = CFacilityUser, int batch = CBatchDefault,
+             size_t bufLimit = CBufLimitDefault, const char *appName = NULL, int maxDelay = CMaxDelayDefault);
+
+  /// Destructor, sending what is buffered if the collector takes it
+  ~SyslogSink();
+
+  /// @brief Check whether the sink is connected to the collector
+  /// @return true if records are currently delivered
+  bool isConnected(void);
+
+  /// @brief Return the number of records dropped because the buffer was full
+  uint64_t getDropped(void);
+
+  /// @brief Write a record as notice
+  int write(const struct iovec *iov, int cnt) { return writeRecord(CSeverityNotice, iov, cnt); }
+
+  int writeRecord(int level, const struct iovec *iov, int cnt);
+
+  /// @brief Send the buffered records
+  /// @return EErr if records are left in the buffer because the collector is unreachable
+  int flush(void);
+
+  /// @brief Send the buffered records once the oldest has waited \a maxDelay ms, or retry after an outage
+  void tick(void);
+
+private:
+
+  int       m_fd;             ///< the socket, -1 while disconnected
+  char      m_path[108];      ///< path of the collector socket
+  int       m_facility;       ///< syslog facility
+  int       m_batch;          ///< records per sendmmsg()
+  int       m_sendAt;         ///< number of buffered records at which the next send is tried
+  char     *m_buf;            ///< buffered records, each a 32 bit length followed by the message
+  size_t    m_bufSize;        ///< size of m_buf
+  size_t    m_head;           ///< offset of the first unsent record
+  size_t    m_tail;           ///< offset behind the last record
+  int       m_cnt;            ///< number of buffered records
+  uint64_t  m_retryAt;        ///< monotonic ms before which no reconnect is tried
+  int       m_maxDelay;       ///< max ms a record waits for its batch
+  uint64_t  m_sendBy;         ///< monotonic ms of the next send due to the delay, UINT64_MAX while nothing waits
+  uint64_t  m_dropped;        ///< records dropped in total
+  uint64_t  m_unreported;     ///< records dropped since the last warning about it
+  char      m_ident[160];     ///< " HOSTNAME APP-NAME PROCID - - " following the timestamp
+  int       m_identLen;       ///< length of m_ident
+  std::mutex m_lock;          ///< serializes writers and flush()
+
+  /// Connect to the collector unless the last attempt was too recent, called with m_lock held
+  int connectLocked(void);
+
+  /// Send the buffered records, called with m_lock held
+  int sendLocked(void);
+
+  /// Append a record to the buffer, called with m_lock held, EErr if it does not fit
+  int appendLocked(int level, const struct iovec *iov, int cnt);
+
+};
+
+#endif //_CPP_LOGGER_SINK_H_
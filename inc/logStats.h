@@ -0,0 +1,128 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logStats.h
+/// @brief Header file of the LogStats self-instrumentation counters
+
+#ifndef _CPP_LOGGER_STATS_H_
+#define _CPP_LOGGER_STATS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/// @brief LogStats class
+///
+/// Counts what a Logger does: lines logged and filtered per level, bytes written,
+/// truncated lines, write errors and flushes with their latency.<br>
+/// Each thread counts into a shard of its own with plain loads and stores, so counting
+/// costs no atomic read-modify-write and no shared cache line. Threads beyond CShards
+/// share an overflow shard counted with atomic adds. snapshot() sums all shards.
+class LogStats {
+public:
+
+  static const int CLevels       = 9;    ///< number of log levels, CfgLog::ELogAlways + 1
+  static const int CShards       = 64;   ///< number of threads counting without sharing a shard
+  static const int CFlushBuckets = 24;   ///< buckets of the flush latency histogram
+
+  /// A snapshot of the counters
+  typedef struct stats {
+    uint64_t emitted[CLevels];        ///< lines logged per level
+    uint64_t filtered[CLevels];       ///< lines discarded per level by the loglevel, the duplicate filter or a rate limit
+    uint64_t bytes;                   ///< bytes written to the output and the attached sinks
+    uint64_t truncated;               ///< lines cut or dropped for being too long
+    uint64_t writeErrors;             ///< failed writes and flushes
+    uint64_t flushes;                 ///< flushes of the output
+    uint64_t flushNs;                 ///< time spent flushing in ns
+    uint64_t flushHist[CFlushBuckets];  ///< flushes by latency, bucket i counts those below 2^i us, the last one all others
+    uint64_t dropped;                 ///< records dropped on a full async queue since the last init
+    uint64_t queueDepth;              ///< records waiting in the async queue
+    uint64_t queueLen;                ///< capacity of the async queue, 0 in synchronous mode
+  } stats_t;
+
+  /// Constructor
+  LogStats();
+
+  /// Destructor
+  ~LogStats();
+
+  /// Count a line logged at level \a lev
+  void emitted(int lev) { bump(&shard()->emitted[lev], 1); }
+
+  /// Count \a cnt lines of level \a lev that were discarded
+  void filtered(int lev, uint64_t cnt = 1) { bump(&shard()->filtered[lev], cnt); }
+
+  /// Count \a len bytes written
+  void written(size_t len) { bump(&shard()->bytes, len); }
+
+  /// Count a line cut or dropped for its length
+  void truncated(void) { bump(&shard()->truncated, 1); }
+
+  /// Count a failed write or flush
+  void writeError(void) { bump(&shard()->writeErrors, 1); }
+
+  /// @brief Count a flush
+  /// @param [in] ns time it took
+  void flushed(uint64_t ns);
+
+  /// @brief Sum the counters of all threads
+  /// The queue and drop fields are left to the caller.
+  /// @param [out] stats the sums
+  void snapshot(stats_t *stats) const;
+
+  /// @brief Return the upper bound of the flush latency bucket holding quantile \a q
+  /// @param [in] stats a snapshot
+  /// @param [in] q the quantile, e.g. 0.99
+  /// @return latency in us, 0 if there were no flushes
+  static uint64_t flushQuantile(const stats_t *stats, double q);
+
+private:
+
+  /// The counters of a thread, on cache lines of their own
+  typedef struct alignas(64) shard {
+    std::atomic<uint64_t> emitted[CLevels];
+    std::atomic<uint64_t> filtered[CLevels];
+    std::atomic<uint64_t> bytes;
+    std::atomic<uint64_t> truncated;
+    std::atomic<uint64_t> writeErrors;
+    std::atomic<uint64_t> flushes;
+    std::atomic<uint64_t> flushNs;
+    std::atomic<uint64_t> flushHist[CFlushBuckets];
+  } shard_t;
+
+  shard_t *m_shards;      ///< CShards shards owned by a thread each, followed by the shared overflow shard
+
+  /// Hands the shard of a thread back when it exits
+  typedef struct owner {
+    int shard;      ///< the owned shard, -1 if none
+    ~owner();
+  } owner_t;
+
+  static thread_local int      s_shard;   ///< shard index of the calling thread, -1 until it counts first
+  static thread_local owner_t  s_owner;   ///< releases s_shard
+  static std::atomic<uint64_t> s_owned;   ///< bit i is set while a thread owns shard i
+
+  /// Return the shard of the calling thread
+  shard_t *shard(void) {
+    int i = s_shard;
+    if (i < 0) i = claim();
+    return &m_shards[i];
+  }
+
+  /// Add \a n to a counter of the calling thread, a shard owned by it has no other writer
+  void bump(std::atomic<uint64_t> *c, uint64_t n) {
+    if (s_shard < CShards) c->store(c->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    else c->fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /// Claim a shard index for the calling thread, CShards if all are taken
+  static int claim(void);
+
+};
+
+#endif //_CPP_LOGGER_STATS_H_
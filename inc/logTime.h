@@ -0,0 +1,85 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logTime.h
+/// @brief Header file of the LogTime timestamp engine
+
+#ifndef _CPP_LOGGER_TIME_H_
+#define _CPP_LOGGER_TIME_H_
+
+#include <time.h>
+#include <stdint.h>
+
+/// @brief LogTime class
+///
+/// Renders timestamps for the Logger's time pattern items.<br>
+/// Time is read with clock_gettime(), which is served from the vDSO without a syscall.
+/// The calendar and timezone conversion only runs when the second changes and its
+/// result is cached per thread, so most timestamps only patch in the sub-second digits.
+class LogTime {
+public:
+
+  /// @brief Enumeration of available timestamp formats
+  typedef enum {
+    ETimeClock = 0,       ///< local time, e.g. 15:52:55
+    ETimeClockUs,         ///< local time with microseconds, e.g. 15:52:55.123456
+    ETimeIso,             ///< ISO-8601 local time with offset, e.g. 2020-05-01T15:52:55.123456+02:00
+    ETimeEpochNs,         ///< nanoseconds since the epoch, e.g. 1588341175123456789
+    ETimeMono             ///< seconds since process start from the monotonic clock, e.g. 12.345678
+  } format_e;             ///< timestamp format
+
+  static const int CMaxTimeLen = 40;    ///< max length of a rendered timestamp
+
+  /// @brief Read the clock used by format \a fmt
+  /// @param [in] fmt a timestamp format
+  /// @param [out] ts the current time
+  static void now(format_e fmt, struct timespec *ts);
+
+  /// @brief Render a timestamp
+  /// @param [out] buf buffer to render to, no null termination is added
+  /// @param [in] len size of \a buf
+  /// @param [in] fmt a timestamp format
+  /// @param [in] ts time as read by now() for \a fmt
+  /// @return number of characters written, -1 if \a buf is too small
+  static int format(char *buf, int len, format_e fmt, const struct timespec *ts);
+
+  /// @brief Render the current time
+  /// @param [out] buf buffer to render to, no null termination is added
+  /// @param [in] len size of \a buf
+  /// @param [in] fmt a timestamp format
+  /// @return number of characters written, -1 if \a buf is too small
+  static int render(char *buf, int len, format_e fmt);
+
+  /// @brief Return the monotonic time at startup, which ETimeMono counts from
+  /// @return the start time
+  static const struct timespec *start(void) { return &s_start; }
+
+private:
+
+  /// Per-thread result of the last calendar conversion
+  typedef struct timeCache {
+    time_t sec;           ///< second the cache was filled for
+    char   clock[8];      ///< HH:MM:SS
+    char   date[11];      ///< YYYY-MM-DD plus 'T'
+    char   offset[6];     ///< +HH:MM
+  } timeCache_t;
+
+  static struct timespec s_start;       ///< monotonic time at startup
+
+  /// Return the calendar conversion for second \a sec, updating the cache if needed
+  static const timeCache_t *lookup(time_t sec);
+
+  /// Write the \a digits most significant digits of the nanoseconds \a ns
+  static void putFraction(char *buf, long ns, int digits);
+
+  /// Write \a val in decimal, return the number of characters written
+  static int putUint(char *buf, uint64_t val);
+
+};
+
+#endif //_CPP_LOGGER_TIME_H_
@@ -0,0 +1,56 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logWatch.h
+/// @brief Header file of the LogWatch config file watcher
+
+#ifndef _CPP_LOGGER_WATCH_H_
+#define _CPP_LOGGER_WATCH_H_
+
+#include <linux/limits.h>
+
+/// @brief LogWatch class
+///
+/// Waits for changes of a file with inotify. The directory of the file is watched rather than
+/// the file itself, so editors replacing the file by renaming a new one over it are noticed as well.
+/// A file is reported once it has been closed after writing or moved into place.
+class LogWatch {
+public:
+
+  /// Return values of wait()
+  enum { EStopped = 0, EChanged, EFailed };
+
+  /// @brief Constructor
+  /// @param [in] path the file to watch
+  LogWatch(const char *path);
+
+  /// Destructor
+  ~LogWatch();
+
+  /// @brief Check whether the watch could be set up
+  /// @return true if wait() reports changes
+  bool isOpen(void) { return (m_inotify >= 0) && (m_wake >= 0) && (m_watch >= 0); }
+
+  /// @brief Block until the file changed or stop() was called
+  /// Changes arriving together are reported once.
+  /// @return EChanged, EStopped, or EFailed if the watch broke
+  int wait(void);
+
+  /// @brief Make wait() return EStopped, may be called from any thread
+  void stop(void);
+
+private:
+
+  int  m_inotify;               ///< inotify instance
+  int  m_wake;                  ///< eventfd signalled by stop()
+  int  m_watch;                 ///< watch descriptor of the directory
+  char m_name[NAME_MAX + 1];    ///< name of the file within the directory
+
+};
+
+#endif //_CPP_LOGGER_WATCH_H_
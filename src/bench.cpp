@@ -0,0 +1,775 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file bench.cpp
+/// @brief Logger benchmarks
+
+#include "log.h"
+#include "logSink.h"
+#include <time.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <vector>
+
+static const char *profile_names[] = { "none", "minimal", "default", "verbose", "user", "json" };
+/// the standard profiles, all but the user profile
+static const CfgLog::profile_e std_profiles[] = { CfgLog::ELogProfileNone, CfgLog::ELogProfileMinimal, CfgLog::ELogProfileDefault,
+                                                  CfgLog::ELogProfileVerbose, CfgLog::ELogProfileJson };
+static const char *flush_names[]   = { "record", "severity", "size", "interval" };
+static const char *msync_names[]   = { "never", "interval", "severity" };
+static const char *backend_names[] = { "stdio", "fd", "fdbatch", "mmap", "binary" };
+
+/// Return a monotonic timestamp in nanoseconds
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/// Measure the cost per line of each of the standard profiles
+void bench_profiles(int lines) {
+
+  for (CfgLog::profile_e p : std_profiles) {
+    Logger *log = new Logger("/dev/null", CfgLog::ELogDebug, p);
+
+    // warm up
+    for (int i = 0; i < lines / 10; i++) {
+      log->info("benchmark line %d with a short payload", i);
+    }
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < lines; i++) {
+      log->info("benchmark line %d with a short payload", i);
+    }
+    uint64_t dur = now_ns() - start;
+
+    printf("profile %-8s pattern %-40s %8.1f ns/line\n",
+           profile_names[p], log->getPattern(), (double)dur / lines);
+    delete log;
+  }
+}
+
+/// Return the number of write syscalls issued by this process so far
+static uint64_t write_syscalls() {
+  char line[64];
+  uint64_t cnt = 0;
+  FILE *fd = fopen("/proc/self/io", "r");
+
+  if (fd == NULL) return 0;
+  while (fgets(line, sizeof(line), fd) != NULL) {
+    if (sscanf(line, "syscw: %llu", (unsigned long long*)&cnt) == 1) break;
+  }
+  fclose(fd);
+  return cnt;
+}
+
+/// Measure cost and write syscalls per line of each backend and flush policy
+void bench_flush(int lines) {
+
+  for (int b = CfgLog::EBackendStdio; b <= CfgLog::EBackendMmap; b++)
+  for (int m = CfgLog::EFlushRecord; m <= CfgLog::EFlushInterval; m++) {
+    // the mapping has its msync policies instead
+    if ((b == CfgLog::EBackendMmap) && (m > CfgLog::EMsyncSeverity)) continue;
+
+    CfgLog *cfg = new CfgLog();
+    cfg->backend = (CfgLog::backend_e)b;
+    cfg->logToFile = true;
+    // a mapping needs a real file
+    strncpy(cfg->logfile, (b == CfgLog::EBackendMmap) ? "/tmp/logger-bench.log" : "/dev/null", CfgLog::CMaxPathLen - 1);
+    cfg->profile = CfgLog::ELogProfileDefault;
+    cfg->flushMode = (CfgLog::flush_e)m;
+    cfg->msyncMode = (CfgLog::msync_e)m;
+    cfg->flushInterval = 10;
+
+    Logger *log = new Logger(cfg);
+    uint64_t calls = write_syscalls();
+    uint64_t start = now_ns();
+    for (int i = 0; i < lines; i++) {
+      // every 100th line is an error, which is flushed right away in severity mode
+      if (i % 100 == 0) log->error("benchmark line %d with a short payload", i);
+      else log->info("benchmark line %d with a short payload", i);
+    }
+    log->flush();
+    uint64_t dur = now_ns() - start;
+    calls = write_syscalls() - calls;
+
+    printf("backend %-8s flush %-8s %8.1f ns/line %10.0f syscalls/1M lines\n",
+           backend_names[b], (b == CfgLog::EBackendMmap) ? msync_names[m] : flush_names[m], (double)dur / lines, (double)calls * 1000000.0 / lines);
+    delete log;
+    if (b == CfgLog::EBackendMmap) unlink(cfg->logfile);
+    delete cfg;
+  }
+}
+
+/// Compare text and binary logging of typical mixed-argument lines, in cost and file size
+void bench_binary(int lines) {
+
+  static const CfgLog::backend_e backends[] = { CfgLog::EBackendFdBatch, CfgLog::EBackendBinary };
+
+  for (int async = 0; async <= 1; async++)
+  for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++) {
+    CfgLog *cfg = new CfgLog();
+    cfg->backend = backends[b];
+    cfg->useAsync = (async != 0);
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, "/tmp/logger-bench.log", CfgLog::CMaxPathLen - 1);
+    cfg->profile = CfgLog::ELogProfileUser;
+    strncpy(cfg->pattern, "&iso&sep&tid&sep&lev&sep&msg&end", CfgLog::CMaxPatternLen - 1);
+    cfg->flushMode = CfgLog::EFlushSize;
+
+    Logger *log = new Logger(cfg);
+    uint64_t start = now_ns();
+    for (int i = 0; i < lines; i++) {
+      log->info("request %d from %s took %u us, %.3f%% of the budget", i, "10.0.0.1", i % 977, (i % 977) / 10.0);
+    }
+    log->flush();
+    uint64_t dur = now_ns() - start;
+    delete log;
+
+    struct stat st;
+    if (stat(cfg->logfile, &st) != 0) st.st_size = 0;
+    printf("backend %-8s %-5s %8.1f ns/line %6.1f bytes/line\n",
+           backend_names[backends[b]], async ? "async" : "sync", (double)dur / lines, (double)st.st_size / lines);
+    unlink(cfg->logfile);
+    delete cfg;
+  }
+}
+
+/// Measure throughput with 1 to 64 threads logging concurrently through one Logger
+void bench_threads(int lines) {
+
+  static const int threads[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+  for (int b = CfgLog::EBackendStdio; b <= CfgLog::EBackendMmap; b++)
+  for (int async = 0; async <= 1; async++)
+  for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+    CfgLog *cfg = new CfgLog();
+    cfg->backend = (CfgLog::backend_e)b;
+    cfg->useAsync = (async != 0);
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, (b == CfgLog::EBackendMmap) ? "/tmp/logger-bench.log" : "/dev/null", CfgLog::CMaxPathLen - 1);
+    cfg->profile = CfgLog::ELogProfileUser;
+    strncpy(cfg->pattern, "&tim&sep&tid&sep&lev&sep&msg&end", CfgLog::CMaxPatternLen - 1);
+    cfg->flushMode = CfgLog::EFlushSize;
+
+    Logger *log = new Logger(cfg);
+    int per = lines / threads[t];
+    std::vector<std::thread> workers;
+
+    uint64_t start = now_ns();
+    for (int n = 0; n < threads[t]; n++) {
+      workers.push_back(std::thread([log, per]() {
+        for (int i = 0; i < per; i++) {
+          log->info("benchmark line %d with a short payload", i);
+        }
+      }));
+    }
+    for (size_t n = 0; n < workers.size(); n++) workers[n].join();
+    log->flush();
+    uint64_t dur = now_ns() - start;
+
+    printf("backend %-8s %-5s threads %2d %8.1f ns/line %10.0f lines/s\n",
+           backend_names[b], async ? "async" : "sync", threads[t],
+           (double)dur / (per * threads[t]), (double)per * threads[t] * 1e9 / dur);
+    delete log;
+    if (b == CfgLog::EBackendMmap) unlink(cfg->logfile);
+    delete cfg;
+  }
+}
+
+/// Compare the type-safe API against printf style varargs for lines with mixed arguments
+void bench_format(int lines) {
+
+  for (int async = 0; async <= 1; async++) {
+    CfgLog *cfg = new CfgLog();
+    cfg->backend = CfgLog::EBackendFdBatch;
+    cfg->useAsync = (async != 0);
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, "/dev/null", CfgLog::CMaxPathLen - 1);
+    cfg->profile = CfgLog::ELogProfileUser;
+    strncpy(cfg->pattern, "&tus&sep&lev&sep&msg&end", CfgLog::CMaxPatternLen - 1);
+    cfg->flushMode = CfgLog::EFlushSize;
+    Logger *log = new Logger(cfg);
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < lines; i++) {
+      log->info("user %d took %lu us, ratio %.3f, host %s, flags %x", i, (unsigned long)i * 7, i / 3.0, "db-01", i);
+    }
+    log->flush();
+    uint64_t varargs = now_ns() - start;
+
+    start = now_ns();
+    for (int i = 0; i < lines; i++) {
+      log->info(LOGGER_FMT("user {} took {} us, ratio {:.3}, host {}, flags {:x}"), i, (unsigned long)i * 7, i / 3.0, "db-01", i);
+    }
+    log->flush();
+    uint64_t typed = now_ns() - start;
+
+    printf("format %-5s varargs %8.1f ns/line typed %8.1f ns/line\n",
+           async ? "async" : "sync", (double)varargs / lines, (double)typed / lines);
+    delete log;
+    delete cfg;
+  }
+}
+
+/// Measure the cost of the duplicate filter on distinct lines and the savings on a flood of repeats
+void bench_dedup(int lines) {
+
+  for (int window = 0; window <= 1000; window += 1000) {
+    CfgLog *cfg = new CfgLog();
+    cfg->backend = CfgLog::EBackendFdBatch;
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, "/dev/null", CfgLog::CMaxPathLen - 1);
+    cfg->profile = CfgLog::ELogProfileUser;
+    strncpy(cfg->pattern, "&tus&sep&lev&sep&msg&end", CfgLog::CMaxPatternLen - 1);
+    cfg->flushMode = CfgLog::EFlushSize;
+    cfg->dedupWindow = window;
+    Logger *log = new Logger(cfg);
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < lines; i++) {
+      log->error("request %d failed: connection refused", i);
+    }
+    log->flush();
+    uint64_t distinct = now_ns() - start;
+
+    start = now_ns();
+    for (int i = 0; i < lines; i++) {
+      log->error("request %d failed: connection refused", 42);
+    }
+    log->flush();
+    uint64_t repeated = now_ns() - start;
+
+    printf("dedup %-3s distinct %8.1f ns/line repeated %8.1f ns/line\n",
+           window ? "on" : "off", (double)distinct / lines, (double)repeated / lines);
+    delete log;
+    delete cfg;
+  }
+}
+
+/// Measure the cost of a call rejected by a rate limited or sampled call site
+void bench_limit(int lines) {
+
+  CfgLog *cfg = new CfgLog();
+  cfg->backend = CfgLog::EBackendFdBatch;
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, "/dev/null", CfgLog::CMaxPathLen - 1);
+  cfg->profile = CfgLog::ELogProfileUser;
+  strncpy(cfg->pattern, "&tus&sep&lev&sep&msg&end", CfgLog::CMaxPatternLen - 1);
+  cfg->flushMode = CfgLog::EFlushSize;
+  Logger *log = new Logger(cfg);
+
+  uint64_t start = now_ns();
+  for (int i = 0; i < lines; i++) {
+    LOGGER_DEBUG(log, "iteration %d of the hot loop", i);
+  }
+  log->flush();
+  uint64_t plain = now_ns() - start;
+
+  start = now_ns();
+  for (int i = 0; i < lines; i++) {
+    LOGGER_DEBUG_RATE(log, 10, "iteration %d of the hot loop", i);
+  }
+  log->flush();
+  uint64_t rate = now_ns() - start;
+
+  start = now_ns();
+  for (int i = 0; i < lines; i++) {
+    LOGGER_DEBUG_SAMPLE(log, 1000, "iteration %d of the hot loop", i);
+  }
+  log->flush();
+  uint64_t sample = now_ns() - start;
+
+  printf("limit plain %8.1f ns/call rate 10/s %8.1f ns/call sample 1/1000 %8.1f ns/call\n",
+         (double)plain / lines, (double)rate / lines, (double)sample / lines);
+  delete log;
+  delete cfg;
+}
+
+void bench_recorder(int lines) {
+
+  CfgLog *cfg = new CfgLog();
+  cfg->backend = CfgLog::EBackendFdBatch;
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, "/dev/null", CfgLog::CMaxPathLen - 1);
+  cfg->profile = CfgLog::ELogProfileUser;
+  strncpy(cfg->pattern, "&tus&sep&lev&sep&msg&end", CfgLog::CMaxPatternLen - 1);
+  cfg->flushMode = CfgLog::EFlushSize;
+  cfg->logLevel = CfgLog::ELogInfo;
+  Logger *log = new Logger(cfg);
+
+  uint64_t start = now_ns();
+  for (int i = 0; i < lines; i++) {
+    log->debug("iteration %d of the %s loop", i, "hot");
+  }
+  uint64_t off = now_ns() - start;
+
+  cfg->useRecorder = true;
+  log->init(cfg);
+  start = now_ns();
+  for (int i = 0; i < lines; i++) {
+    log->debug("iteration %d of the %s loop", i, "hot");
+  }
+  uint64_t rec = now_ns() - start;
+
+  start = now_ns();
+  int dumped = log->dumpRecorder();
+  uint64_t dump = now_ns() - start;
+
+  printf("recorder off %8.1f ns/call captured %8.1f ns/call dump %d records %8.1f us\n",
+         (double)off / lines, (double)rec / lines, dumped, dump / 1000.0);
+  delete log;
+  delete cfg;
+}
+
+void bench_stats(int lines) {
+
+  CfgLog *cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, "/dev/null", CfgLog::CMaxPathLen - 1);
+  cfg->logLevel = CfgLog::ELogInfo;
+  Logger *log = new Logger(cfg);
+  const int threads = 8;
+
+  // filtered calls only count, threads must not contend on the counters
+  std::vector<std::thread> workers;
+  uint64_t start = now_ns();
+  for (int t = 0; t < threads; t++) {
+    workers.push_back(std::thread([log, lines] {
+      for (int i = 0; i < lines; i++) LOGGER_DEBUG(log, "iteration %d of the hot loop", i);
+    }));
+  }
+  for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+  uint64_t filtered = now_ns() - start;
+
+  LogStats::stats_t st;
+  start = now_ns();
+  for (int i = 0; i < 1000; i++) log->getStats(&st);
+  uint64_t snap = now_ns() - start;
+
+  printf("stats filtered %d threads %8.1f ns/call snapshot %8.1f ns (%llu filtered)\n", threads,
+         (double)filtered / ((uint64_t)lines * threads), snap / 1000.0, (unsigned long long)st.filtered[CfgLog::ELogDebug]);
+  delete log;
+  delete cfg;
+}
+
+void bench_json(int lines) {
+
+  // escaping throughput, vectorized against the scalar loop, for clean text and text with 5% specials
+  static char src[1024];
+  static char dst[6 * sizeof(src)];
+  const char *names[2] = { "clean", "5% special" };
+  for (int k = 0; k < 2; k++) {
+    for (size_t i = 0; i < sizeof(src); i++) src[i] = ((k == 1) && (i % 20 == 7)) ? '"' : 'a' + (i % 26);
+    uint64_t start = now_ns();
+    for (int i = 0; i < lines; i++) (void)LogJson::escape(dst, dst + sizeof(dst), src, sizeof(src));
+    uint64_t vec = now_ns() - start;
+    start = now_ns();
+    for (int i = 0; i < lines; i++) (void)LogJson::escapeScalar(dst, dst + sizeof(dst), src, sizeof(src));
+    uint64_t scalar = now_ns() - start;
+    printf("json escape %-10s vector %8.1f MB/s scalar %8.1f MB/s\n", names[k],
+           (double)lines * sizeof(src) * 1000.0 / vec, (double)lines * sizeof(src) * 1000.0 / scalar);
+  }
+
+  // whole records, a printf line and a line with fields, against the default text profile
+  const CfgLog::profile_e profiles[2] = { CfgLog::ELogProfileDefault, CfgLog::ELogProfileJson };
+  for (int p = 0; p < 2; p++) {
+    CfgLog *cfg = new CfgLog();
+    cfg->backend = CfgLog::EBackendFdBatch;
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, "/dev/null", CfgLog::CMaxPathLen - 1);
+    cfg->profile = profiles[p];
+    cfg->flushMode = CfgLog::EFlushSize;
+    Logger *log = new Logger(cfg);
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < lines; i++) {
+      log->info("request %d served from %s", i, "cache");
+    }
+    uint64_t plain = now_ns() - start;
+
+    start = now_ns();
+    for (int i = 0; i < lines; i++) {
+      log->info("request served", {{"id", i}, {"from", "cache"}, {"ms", 1.25}, {"hit", true}});
+    }
+    uint64_t kv = now_ns() - start;
+
+    printf("json profile %-8s printf %8.1f ns/line fields %8.1f ns/line\n", profile_names[profiles[p]],
+           (double)plain / lines, (double)kv / lines);
+    delete log;
+    delete cfg;
+  }
+}
+
+void bench_child(int lines) {
+
+  CfgLog *cfg = new CfgLog();
+  cfg->backend = CfgLog::EBackendFdBatch;
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, "/dev/null", CfgLog::CMaxPathLen - 1);
+  cfg->flushMode = CfgLog::EFlushSize;
+  cfg->logLevel = CfgLog::ELogInfo;
+  Logger *log = new Logger(cfg);
+  LogChild *child = log->getChild("net.http.client");
+
+  // a filtered call costs the same single load on a child as on the Logger
+  uint64_t start = now_ns();
+  for (int i = 0; i < lines; i++) LOGGER_DEBUG(log, "iteration %d of the hot loop", i);
+  uint64_t root = now_ns() - start;
+
+  start = now_ns();
+  for (int i = 0; i < lines; i++) LOGGER_DEBUG(child, "iteration %d of the hot loop", i);
+  uint64_t filtered = now_ns() - start;
+
+  log->getChild("net.http")->setLevel(CfgLog::ELogDebug);
+  start = now_ns();
+  for (int i = 0; i < lines; i++) LOGGER_DEBUG(child, "iteration %d of the hot loop", i);
+  log->flush();
+  uint64_t logged = now_ns() - start;
+
+  // resolving the levels of a registry of 2000 modules
+  char name[64];
+  for (int i = 0; i < 2000; i++) {
+    snprintf(name, sizeof(name), "mod%d.sub%d.leaf%d", i % 20, i % 100, i);
+    (void)log->getChild(name);
+  }
+  start = now_ns();
+  for (int i = 0; i < 100; i++) log->setLevel((i % 2) ? CfgLog::ELogDebug : CfgLog::ELogInfo);
+  uint64_t resolve = now_ns() - start;
+
+  printf("child filtered root %8.1f ns/call child %8.1f ns/call logged %8.1f ns/call setLevel 2000 children %8.1f us\n",
+         (double)root / lines, (double)filtered / lines, (double)logged / lines, resolve / 100000.0);
+  delete log;
+  delete cfg;
+}
+
+void bench_reconfig(int lines) {
+
+  // the read side of a configuration snapshot, once per record
+  uint64_t start = now_ns();
+  for (int i = 0; i < lines; i++) {
+    LogEpoch::guard epoch;
+  }
+  uint64_t section = now_ns() - start;
+
+  CfgLog *cfg = new CfgLog();
+  cfg->backend = CfgLog::EBackendFdBatch;
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, "/dev/null", CfgLog::CMaxPathLen - 1);
+  cfg->flushMode = CfgLog::EFlushSize;
+  Logger *log = new Logger(cfg);
+
+  start = now_ns();
+  for (int i = 0; i < lines; i++) {
+    log->info("iteration %d of the %s loop", i, "hot");
+  }
+  uint64_t quiet = now_ns() - start;
+
+  // patterns and levels change underneath the logging thread
+  std::atomic<bool> stop(false);
+  std::atomic<int> changes(0);
+  std::thread admin([log, &stop, &changes] {
+    const char *patterns[2] = { "&tim&sep&lev&sep&msg&end", "&tus [&lev] &msg&end" };
+    for (int i = 0; !stop.load(); i++) {
+      (void)log->setPattern(patterns[i % 2]);
+      log->setLevel(CfgLog::ELogInfo);
+      changes++;
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+  start = now_ns();
+  for (int i = 0; i < lines; i++) {
+    log->info("iteration %d of the %s loop", i, "hot");
+  }
+  uint64_t busy = now_ns() - start;
+  stop = true;
+  admin.join();
+
+  printf("reconfig section %8.1f ns logging %8.1f ns/line while reconfiguring %8.1f ns/line (%d changes, %d pending)\n",
+         (double)section / lines, (double)quiet / lines, (double)busy / lines, changes.load(), LogEpoch::reclaim());
+  delete log;
+  delete cfg;
+}
+
+void bench_syslog(int lines) {
+
+  // a collector draining a local datagram socket
+  const char *path = "/tmp/logger-bench.sock";
+  unlink(path);
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  if ((fd < 0) || (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)) {
+    fprintf(stderr, "Failed to bind %s: %d\n", path, errno);
+    if (fd >= 0) close(fd);
+    return;
+  }
+  struct timeval tv = { 0, 100000 };
+  (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  std::atomic<bool> stop(false);
+  std::thread collector([fd, &stop] {
+    char buf[SyslogSink::CMaxRecordLen];
+    while (!stop.load()) {
+      (void)recv(fd, buf, sizeof(buf), 0);
+    }
+  });
+
+  // one datagram per record against one sendmmsg() per batch
+  const int batches[] = { 1, 8, 32 };
+  for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+    CfgLog *cfg = new CfgLog();
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, "/dev/null", CfgLog::CMaxPathLen - 1);
+    cfg->logLevel = CfgLog::ELogError;
+    Logger *log = new Logger(cfg);
+    SyslogSink *sink = new SyslogSink(path, SyslogSink::CFacilityUser, batches[b], 16 * 1024 * 1024);
+    (void)log->addSink(sink, CfgLog::ELogInfo, "&msg");
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < lines; i++) {
+      log->info("iteration %d of the %s loop", i, "hot");
+    }
+    log->flush();
+    uint64_t dur = now_ns() - start;
+
+    printf("syslog batch %3d %8.1f ns/line dropped %llu\n", batches[b], (double)dur / lines,
+           (unsigned long long)sink->getDropped());
+    delete log;
+    delete cfg;
+  }
+
+  stop = true;
+  collector.join();
+  close(fd);
+  unlink(path);
+}
+
+/// Latency histogram with 16 linear sub-buckets per power of two, about 6% resolution
+typedef struct histogram {
+  static const int CSub = 16;                 ///< sub-buckets per power of two
+  uint64_t cnt[64 * CSub];                    ///< number of samples per bucket
+  uint64_t total;                             ///< number of samples
+  uint64_t max;                               ///< largest sample
+} histogram_t;
+
+/// Return the bucket of a sample of \a ns
+static int hist_bucket(uint64_t ns) {
+  if (ns < (uint64_t)histogram_t::CSub) return (int)ns;
+  int msb = 63 - __builtin_clzll(ns);
+  return (msb - 3) * histogram_t::CSub + (int)((ns >> (msb - 4)) & (histogram_t::CSub - 1));
+}
+
+/// Return the largest value falling into bucket \a b
+static uint64_t hist_upper(int b) {
+  if (b < histogram_t::CSub) return b;
+  int msb = b / histogram_t::CSub + 3;
+  uint64_t sub = b % histogram_t::CSub;
+  return ((histogram_t::CSub + sub + 1) << (msb - 4)) - 1;
+}
+
+static void hist_add(histogram_t *h, uint64_t ns) {
+  h->cnt[hist_bucket(ns)]++;
+  h->total++;
+  if (ns > h->max) h->max = ns;
+}
+
+static void hist_merge(histogram_t *to, const histogram_t *from) {
+  for (int b = 0; b < 64 * histogram_t::CSub; b++) to->cnt[b] += from->cnt[b];
+  to->total += from->total;
+  if (from->max > to->max) to->max = from->max;
+}
+
+/// Return the upper bound of the bucket holding quantile \a q
+static uint64_t hist_quantile(const histogram_t *h, double q) {
+  uint64_t rank = (uint64_t)(q * h->total + 0.5);
+  uint64_t seen = 0;
+  if (rank == 0) rank = 1;
+  for (int b = 0; b < 64 * histogram_t::CSub; b++) {
+    seen += h->cnt[b];
+    if (seen >= rank) return (hist_upper(b) < h->max) ? hist_upper(b) : h->max;
+  }
+  return h->max;
+}
+
+/// A case of the benchmark suite
+typedef struct suiteCase {
+  const char        *axis;        ///< the setting the case varies, the others stay at the baseline
+  const char        *name;        ///< name of the varied value
+  CfgLog::profile_e  profile;     ///< logging profile
+  const char        *pattern;     ///< user pattern, NULL for the profile default
+  bool               color;       ///< render colors
+  const char        *dest;        ///< logfile, NULL for stdout
+  bool               filtered;    ///< log below the loglevel
+  bool               async;       ///< asynchronous logging
+  int                threads;     ///< number of logging threads
+} suiteCase_t;
+
+/// Run a case of the suite and write its result as CSV line to \a out
+static void suite_run(FILE *out, const suiteCase_t *c, int lines) {
+
+  CfgLog *cfg = new CfgLog();
+  cfg->profile = c->profile;
+  if (c->pattern != NULL) {
+    cfg->profile = CfgLog::ELogProfileUser;
+    strncpy(cfg->pattern, c->pattern, CfgLog::CMaxPatternLen - 1);
+  }
+  cfg->useColor = c->color;
+  cfg->colorAlways = c->color;
+  cfg->logToFile = (c->dest != NULL);
+  if (c->dest != NULL) strncpy(cfg->logfile, c->dest, CfgLog::CMaxPathLen - 1);
+  cfg->logLevel = CfgLog::ELogInfo;
+  cfg->useAsync = c->async;
+  Logger *log = new Logger(cfg);
+
+  int per = lines / c->threads;
+  std::vector<histogram_t*> hists;
+  std::vector<std::thread> workers;
+  for (int n = 0; n < c->threads; n++) hists.push_back((histogram_t*)calloc(1, sizeof(histogram_t)));
+
+  std::atomic<int> ready(0);
+  std::atomic<bool> go(false);
+  for (int n = 0; n < c->threads; n++) {
+    workers.push_back(std::thread([log, per, c, n, &hists, &ready, &go]() {
+      histogram_t *h = hists[n];
+      // warm up, then start all threads at once
+      for (int i = 0; i < per / 10; i++) {
+        if (c->filtered) log->debug("benchmark line %d with a short payload", i);
+        else log->info("benchmark line %d with a short payload", i);
+      }
+      ready++;
+      while (!go.load()) std::this_thread::yield();
+
+      for (int i = 0; i < per; i++) {
+        uint64_t t0 = now_ns();
+        if (c->filtered) log->debug("benchmark line %d with a short payload", i);
+        else log->info("benchmark line %d with a short payload", i);
+        hist_add(h, now_ns() - t0);
+      }
+    }));
+  }
+  while (ready.load() < c->threads) std::this_thread::yield();
+  log->flush();
+  uint64_t start = now_ns();
+  go = true;
+  for (size_t n = 0; n < workers.size(); n++) workers[n].join();
+  log->flush();
+  uint64_t dur = now_ns() - start;
+
+  for (int n = 1; n < c->threads; n++) hist_merge(hists[0], hists[n]);
+  const histogram_t *h = hists[0];
+  fprintf(out, "%s,%s,%s,\"%s\",%s,%s,%s,%s,%d,%llu,%.1f,%.0f,%llu,%llu,%llu,%llu\n",
+          c->axis, c->name, profile_names[(c->pattern != NULL) ? CfgLog::ELogProfileUser : c->profile], log->getPattern(),
+          c->color ? "color" : "plain", (c->dest == NULL) ? "stdout" : c->dest,
+          c->filtered ? "filtered" : "enabled", c->async ? "async" : "sync", c->threads,
+          (unsigned long long)h->total, (double)dur / h->total, (double)h->total * 1e9 / dur,
+          (unsigned long long)hist_quantile(h, 0.5), (unsigned long long)hist_quantile(h, 0.99),
+          (unsigned long long)hist_quantile(h, 0.999), (unsigned long long)h->max);
+  fflush(out);
+
+  for (int n = 0; n < c->threads; n++) free(hists[n]);
+  delete log;
+  if ((c->dest != NULL) && (strcmp(c->dest, "/dev/null") != 0)) unlink(c->dest);
+  delete cfg;
+}
+
+/// @brief Run the benchmark suite, one case per setting around a common baseline
+/// Each case writes a CSV line with throughput and per-call latency percentiles to \a out.
+/// Latencies include reading the clock twice, see the timer case.
+/// @param [in] out where to write the results
+/// @param [in] lines number of lines per case
+/// @param [in] maxThreads the thread counts run are the powers of two up to it
+void bench_suite(FILE *out, int lines, int maxThreads) {
+
+  static const char *file = "/tmp/logger-bench.log";
+  static const char *null = "/dev/null";
+  const suiteCase_t base = { "baseline", "default", CfgLog::ELogProfileDefault, NULL, false, null, false, false, 1 };
+  std::vector<suiteCase_t> cases;
+  suiteCase_t c;
+
+  fprintf(out, "axis,case,profile,pattern,color,dest,level,mode,threads,lines,ns_per_line,lines_per_s,p50_ns,p99_ns,p999_ns,max_ns\n");
+
+  // the floor of every latency: two clock reads around nothing
+  histogram_t *h = (histogram_t*)calloc(1, sizeof(histogram_t));
+  for (int i = 0; i < lines; i++) {
+    uint64_t t0 = now_ns();
+    hist_add(h, now_ns() - t0);
+  }
+  fprintf(out, "timer,clock,,,,,,,1,%llu,,,%llu,%llu,%llu,%llu\n", (unsigned long long)h->total,
+          (unsigned long long)hist_quantile(h, 0.5), (unsigned long long)hist_quantile(h, 0.99),
+          (unsigned long long)hist_quantile(h, 0.999), (unsigned long long)h->max);
+  free(h);
+
+  for (CfgLog::profile_e p : std_profiles) {
+    c = base; c.axis = "profile"; c.name = profile_names[p]; c.profile = p;
+    cases.push_back(c);
+  }
+  c = base; c.axis = "pattern"; c.name = "iso-tid"; c.pattern = "&iso&sep&tid&sep&lev&sep&msg&end";
+  cases.push_back(c);
+  c = base; c.axis = "pattern"; c.name = "mono-pid"; c.pattern = "&pre&mon&sep&pid&sep&lev&sep&msg&end";
+  cases.push_back(c);
+  c = base; c.axis = "color"; c.name = "color"; c.color = true;
+  cases.push_back(c);
+  c = base; c.axis = "dest"; c.name = "stdout"; c.dest = NULL;
+  cases.push_back(c);
+  c = base; c.axis = "dest"; c.name = "file"; c.dest = file;
+  cases.push_back(c);
+  c = base; c.axis = "level"; c.name = "filtered"; c.filtered = true;
+  cases.push_back(c);
+  for (int async = 0; async <= 1; async++)
+  for (int t = 1; t <= maxThreads; t *= 2) {
+    c = base; c.axis = "threads"; c.name = async ? "async" : "sync"; c.async = (async != 0); c.threads = t;
+    cases.push_back(c);
+  }
+
+  suite_run(out, &base, lines);
+  for (size_t i = 0; i < cases.size(); i++) suite_run(out, &cases[i], lines);
+}
+
+int main(int argc, char *argv[]) {
+
+  // bench --suite [lines [threads [results.csv]]]
+  if ((argc > 1) && (strcmp(argv[1], "--suite") == 0)) {
+    int lines = (argc > 2) ? atoi(argv[2]) : 200000;
+    int threads = (argc > 3) ? atoi(argv[3]) : 8;
+    FILE *out = (argc > 4) ? fopen(argv[4], "w") : stderr;
+    if (out == NULL) {
+      fprintf(stderr, "Failed to open %s: %d\n", argv[4], errno);
+      return 1;
+    }
+    bench_suite(out, (lines > 0) ? lines : 1, (threads > 0) ? threads : 1);
+    if (out != stderr) fclose(out);
+    return 0;
+  }
+
+  int lines = 1000000;
+  if (argc > 1) lines = atoi(argv[1]);
+
+  bench_profiles(lines);
+  bench_flush(lines);
+  bench_threads(lines);
+  bench_binary(lines);
+  bench_format(lines);
+  bench_dedup(lines);
+  bench_limit(lines);
+  bench_recorder(lines);
+  bench_stats(lines);
+  bench_json(lines);
+  bench_child(lines);
+  bench_reconfig(lines);
+  bench_syslog(lines);
+  return 0;
+}
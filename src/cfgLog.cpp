@@ -10,6 +10,10 @@
 /// @brief Implementation of the CfgLog class
 
 #include "log.h"
+#include <stdlib.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
 
 const char cfgLog::CLogMsgLevel[][cfgLog::CMaxLogLevelStrLen] = {
   "Emerg",
@@ -30,13 +34,46 @@ CfgLog::CfgLog() {
   logToFile     = false;
   useColor      = false;
   useUsrPattern = false;
+  useAsync      = false;
 
   color         = EColorWhite;
+  colorAlways   = false;
+  for (int lev = 0; lev <= ELogAlways; lev++) levelColor[lev] = EColorNone;
   logLevelCase  = ELevelCaseDefault;
   usrPattern    = NULL;
 
+  asyncPolicy   = EAsyncBlock;
+  asyncQueueLen = CAsyncQueueLenDefault;
+
+  backend       = EBackendStdio;
+  mmapChunkSize = CMmapChunkSizeDefault;
+  msyncMode     = EMsyncNever;
+
+  flushMode     = EFlushRecord;
+  flushLevel    = ELogError;
+  flushBufSize  = CFlushBufSizeDefault;
+  flushInterval = CFlushIntervalDefault;
+
+  appendToFile   = false;
+  rotateSize     = 0;
+  rotateInterval = 0;
+  rotateKeep     = CRotateKeepDefault;
+
+  dedupWindow    = 0;
+
+  useRecorder    = false;
+  recorderLevel  = ELogDebug;
+  recorderLen    = CRecorderLenDefault;
+
+  statsInterval  = 0;
+
+  watchConfig    = false;
+  moduleLevel    = NULL;
+
   // init strings
   memset(logfile,     '\0', sizeof(logfile));
+  memset(recorderFile, '\0', sizeof(recorderFile));
+  memset(configFile,  '\0', sizeof(configFile));
   memset(prefix,      '\0', sizeof(prefix));
   memset(postfix,     '\0', sizeof(postfix));
   memset(separator,   '\0', sizeof(separator));
@@ -57,6 +94,12 @@ CfgLog::~CfgLog() {
       tmp = ntmp;
     } while (tmp != NULL);
   }
+  while (moduleLevel != NULL) {
+    ModuleLevel *next = moduleLevel->next;
+    free(moduleLevel->name);
+    delete moduleLevel;
+    moduleLevel = next;
+  }
 }
 
 void CfgLog::addUsrPattern(int nr, const char *pat) {
@@ -82,3 +125,260 @@ char *CfgLog::getUsrPattern(int nr) {
   }
   return NULL;
 }
+
+void CfgLog::addModuleLevel(const char *name, level_e level) {
+
+  ModuleLevel **link = &moduleLevel;
+  while (*link != NULL) {
+    if (strcmp((*link)->name, name) == 0) {
+      (*link)->level = level;
+      return;
+    }
+    link = &(*link)->next;
+  }
+  ModuleLevel *mod = new ModuleLevel;
+  mod->name  = strdup(name);
+  mod->level = level;
+  mod->next  = NULL;
+  *link = mod;
+}
+
+const char *CfgLog::getModuleLevel(int idx, level_e *level) const {
+
+  ModuleLevel *mod = moduleLevel;
+  while ((mod != NULL) && (idx-- > 0)) mod = mod->next;
+  if (mod == NULL) return NULL;
+  *level = mod->level;
+  return mod->name;
+}
+
+void CfgLog::copyLists(const CfgLog *from) {
+
+  if (from == this) return;
+
+  while (usrPattern != NULL) {
+    UsrPattern *next = usrPattern->next;
+    delete usrPattern;
+    usrPattern = next;
+  }
+  for (UsrPattern *p = from->usrPattern; p != NULL; p = p->next) addUsrPattern(p->nr, p->pat);
+
+  while (moduleLevel != NULL) {
+    ModuleLevel *next = moduleLevel->next;
+    free(moduleLevel->name);
+    delete moduleLevel;
+    moduleLevel = next;
+  }
+  for (ModuleLevel *m = from->moduleLevel; m != NULL; m = m->next) addModuleLevel(m->name, m->level);
+}
+
+/// Names of the values of an enumerated setting, in the order of their values
+static const char *profile_names[] = { "none", "minimal", "default", "verbose", "user", "json", NULL };
+static_assert(CfgLog::ELogProfileUser == 4, "the values of the profiles are kept, new ones are appended");
+static const char *case_names[]    = { "default", "lower", "upper", NULL };
+static const char *flush_names[]   = { "record", "severity", "size", "interval", NULL };
+static const char *backend_names[] = { "stdio", "fd", "fdbatch", "mmap", "binary", NULL };
+static const char *msync_names[]   = { "never", "interval", "severity", NULL };
+static const char *policy_names[]  = { "block", "drop", "droplowest", NULL };
+static const char *color_names[]   = { "none", "black", "red", "green", "yellow", "blue", "magenta", "cyan", "white", NULL };
+
+/// Return the index of \a value in \a names, ignoring case, -1 if it is none of them
+static int lookup(const char *const *names, const char *value) {
+  for (int i = 0; names[i] != NULL; i++) {
+    if (strcasecmp(names[i], value) == 0) return i;
+  }
+  return -1;
+}
+
+/// Parse a loglevel, its level string as in CLogMsgLevel or the full name, -1 if invalid
+static int parseLevel(const char *value) {
+
+  for (int i = 0; i <= CfgLog::ELogAlways; i++) {
+    if (strcasecmp(cfgLog::CLogMsgLevel[i], value) == 0) return i;
+  }
+  if (strcasecmp(value, "emergency") == 0) return CfgLog::ELogEmergency;
+  if (strcasecmp(value, "critical") == 0)  return CfgLog::ELogCritical;
+  if (strcasecmp(value, "warn") == 0)      return CfgLog::ELogWarn;
+  return -1;
+}
+
+/// Parse a bool, -1 if invalid
+static int parseBool(const char *value) {
+  if ((strcasecmp(value, "true") == 0) || (strcasecmp(value, "on") == 0) || (strcasecmp(value, "yes") == 0) || (strcmp(value, "1") == 0)) return 1;
+  if ((strcasecmp(value, "false") == 0) || (strcasecmp(value, "off") == 0) || (strcasecmp(value, "no") == 0) || (strcmp(value, "0") == 0)) return 0;
+  return -1;
+}
+
+/// Parse a non-negative number with an optional k, M or G suffix, false if invalid
+static bool parseSize(const char *value, size_t *size) {
+
+  char *end = NULL;
+  errno = 0;
+  unsigned long long n = strtoull(value, &end, 10);
+  if ((end == value) || (errno != 0) || (*value == '-')) return false;
+  switch (*end) {
+    case 'k': case 'K': n <<= 10; end++; break;
+    case 'm': case 'M': n <<= 20; end++; break;
+    case 'g': case 'G': n <<= 30; end++; break;
+    default: break;
+  }
+  if (*end != '\0') return false;
+  *size = (size_t)n;
+  return true;
+}
+
+/// Parse a non-negative int, false if invalid
+static bool parseInt(const char *value, int *n) {
+  size_t size = 0;
+  if (!parseSize(value, &size) || (size > 0x7fffffff)) return false;
+  *n = (int)size;
+  return true;
+}
+
+/// Copy \a value to \a dst of \a len bytes, false if it does not fit
+static bool copyString(char *dst, size_t len, const char *value) {
+  if (strlen(value) >= len) return false;
+  strcpy(dst, value);
+  return true;
+}
+
+int CfgLog::set(const char *key, const char *value) {
+
+  int v = -1;
+  bool ok = true;
+
+  if (strcmp(key, "logLevel") == 0) {
+    if ((ok = ((v = parseLevel(value)) >= 0))) logLevel = (level_e)v;
+  } else if (strncmp(key, "logLevel.", 9) == 0) {
+    if ((ok = ((key[9] != '\0') && ((v = parseLevel(value)) >= 0)))) addModuleLevel(key + 9, (level_e)v);
+  } else if (strcmp(key, "profile") == 0) {
+    if ((ok = ((v = lookup(profile_names, value)) >= 0))) profile = (profile_e)v;
+  } else if (strcmp(key, "pattern") == 0) {
+    if ((ok = copyString(pattern, sizeof(pattern), value))) profile = ELogProfileUser;
+  } else if (strncmp(key, "usrPattern.", 11) == 0) {
+    int nr = 0;
+    if ((ok = (parseInt(key + 11, &nr) && (strlen(value) < CMaxPatternItemLen)))) {
+      char *cur = getUsrPattern(nr);
+      if (cur != NULL) strcpy(cur, value);
+      else addUsrPattern(nr, value);
+      useUsrPattern = true;
+    }
+  } else if (strcmp(key, "logfile") == 0) {
+    if ((ok = copyString(logfile, sizeof(logfile), value))) logToFile = (logfile[0] != '\0');
+  } else if (strcmp(key, "appendToFile") == 0) {
+    if ((ok = ((v = parseBool(value)) >= 0))) appendToFile = v;
+  } else if (strcmp(key, "useColor") == 0) {
+    if ((ok = ((v = parseBool(value)) >= 0))) useColor = v;
+  } else if (strcmp(key, "colorAlways") == 0) {
+    if ((ok = ((v = parseBool(value)) >= 0))) colorAlways = v;
+  } else if (strcmp(key, "color") == 0) {
+    if ((ok = ((v = lookup(color_names, value)) >= 0))) color = (v == 0) ? EColorNone : (color_e)(EColorBlack + v - 1);
+  } else if (strncmp(key, "color.", 6) == 0) {
+    int lev = parseLevel(key + 6);
+    if ((ok = ((lev >= 0) && ((v = lookup(color_names, value)) >= 0)))) {
+      levelColor[lev] = (v == 0) ? EColorNone : (color_e)(EColorBlack + v - 1);
+    }
+  } else if (strcmp(key, "logLevelCase") == 0) {
+    if ((ok = ((v = lookup(case_names, value)) >= 0))) logLevelCase = v;
+  } else if (strcmp(key, "prefix") == 0) {
+    ok = copyString(prefix, sizeof(prefix), value);
+  } else if (strcmp(key, "postfix") == 0) {
+    ok = copyString(postfix, sizeof(postfix), value);
+  } else if (strcmp(key, "separator") == 0) {
+    ok = copyString(separator, sizeof(separator), value);
+  } else if (strcmp(key, "useAsync") == 0) {
+    if ((ok = ((v = parseBool(value)) >= 0))) useAsync = v;
+  } else if (strcmp(key, "asyncPolicy") == 0) {
+    if ((ok = ((v = lookup(policy_names, value)) >= 0))) asyncPolicy = (asyncPolicy_e)v;
+  } else if (strcmp(key, "asyncQueueLen") == 0) {
+    ok = parseInt(value, &asyncQueueLen);
+  } else if (strcmp(key, "backend") == 0) {
+    if ((ok = ((v = lookup(backend_names, value)) >= 0))) backend = (backend_e)v;
+  } else if (strcmp(key, "msyncMode") == 0) {
+    if ((ok = ((v = lookup(msync_names, value)) >= 0))) msyncMode = (msync_e)v;
+  } else if (strcmp(key, "flushMode") == 0) {
+    if ((ok = ((v = lookup(flush_names, value)) >= 0))) flushMode = (flush_e)v;
+  } else if (strcmp(key, "flushLevel") == 0) {
+    if ((ok = ((v = parseLevel(value)) >= 0))) flushLevel = (level_e)v;
+  } else if (strcmp(key, "flushBufSize") == 0) {
+    ok = parseInt(value, &flushBufSize);
+  } else if (strcmp(key, "flushInterval") == 0) {
+    ok = parseInt(value, &flushInterval);
+  } else if (strcmp(key, "rotateSize") == 0) {
+    ok = parseSize(value, &rotateSize);
+  } else if (strcmp(key, "rotateInterval") == 0) {
+    ok = parseInt(value, &rotateInterval);
+  } else if (strcmp(key, "rotateKeep") == 0) {
+    ok = parseInt(value, &rotateKeep);
+  } else if (strcmp(key, "dedupWindow") == 0) {
+    ok = parseInt(value, &dedupWindow);
+  } else if (strcmp(key, "statsInterval") == 0) {
+    ok = parseInt(value, &statsInterval);
+  } else if (strcmp(key, "watchConfig") == 0) {
+    if ((ok = ((v = parseBool(value)) >= 0))) watchConfig = v;
+  } else {
+    ok = false;
+  }
+  return ok ? ENoErr : EErr;
+}
+
+int CfgLog::load(const char *path) {
+
+  FILE *fd = fopen(path, "r");
+  if (fd == NULL) {
+    fprintf(stderr, "Failed to open config file %s: %d\n", path, errno);
+    return EErr;
+  }
+  if (path != configFile) {
+    strncpy(configFile, path, sizeof(configFile) - 1);
+  }
+
+  char line[CMaxPathLen + 64];
+  int  no = 0;
+  int  ret = ENoErr;
+
+  while ((ret == ENoErr) && (fgets(line, sizeof(line), fd) != NULL)) {
+    no++;
+    char *key = line;
+    while (isspace((unsigned char)*key)) key++;
+    if ((*key == '\0') || (*key == '#')) continue;
+
+    char *eq = strchr(key, '=');
+    char *end = key + strlen(key);
+    if ((eq == NULL) || (end[-1] != '\n' && !feof(fd))) {
+      fprintf(stderr, "%s:%d: expected key = value\n", path, no);
+      ret = EErr;
+      break;
+    }
+    // trim the key and the value
+    char *kend = eq;
+    while ((kend > key) && isspace((unsigned char)kend[-1])) kend--;
+    *kend = '\0';
+    char *value = eq + 1;
+    while (isspace((unsigned char)*value)) value++;
+    while ((end > value) && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+
+    // quoted values keep their blanks and take escapes
+    if ((*value == '"') && (end - value >= 2) && (end[-1] == '"')) {
+      char *out = value;
+      for (char *in = value + 1; in < end - 1; in++) {
+        if ((*in == '\\') && (in + 1 < end - 1)) {
+          in++;
+          *out++ = (*in == 'n') ? '\n' : (*in == 't') ? '\t' : *in;
+        } else {
+          *out++ = *in;
+        }
+      }
+      *out = '\0';
+    }
+
+    if (set(key, value) != ENoErr) {
+      fprintf(stderr, "%s:%d: unknown setting or invalid value: %s = %s\n", path, no, key, value);
+      ret = EErr;
+    }
+  }
+
+  fclose(fd);
+  return ret;
+}
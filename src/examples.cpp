@@ -10,6 +10,7 @@
 /// @brief All example code used in the doxygen examples
 
 #include "log.h"
+#include "logSink.h"
 
 void init_example() {
   //! [init default]
@@ -106,7 +107,8 @@ void color_example() {
   CfgLog *cfg = new CfgLog();
 
   cfg->useColor = true;                       // enable colors
-  cfg->color = CfgLog::EColorGreen;           // set color green
+  cfg->color = CfgLog::EColorGreen;           // set color green for levels up to error
+  cfg->levelColor[CfgLog::ELogWarn] = CfgLog::EColorYellow;   // and yellow for warnings
   cfg->profile = CfgLog::ELogProfileDefault;  // set default profile to include log level output
 
   // Create a Logger object from the config
@@ -178,6 +180,337 @@ void basic_usage_example() {
   //! [level example]
 }
 
+void async_example() {
+  //! [async example]
+  // Create a CfgLog object
+  CfgLog *cfg = new CfgLog();
+
+  cfg->useAsync = true;                           // format on the caller, write on a background thread
+  cfg->asyncPolicy = CfgLog::EAsyncDropLowest;    // shed debug, info, ... first when the queue runs full
+  cfg->asyncQueueLen = 1024;                      // number of records the queue can hold
+  cfg->profile = CfgLog::ELogProfileDefault;
+
+  // Create a Logger object from the config
+  Logger *log = new Logger(cfg);
+  log->always("This message is written by the background writer");
+  log->info("So is this one");
+
+  // wait until everything logged so far has been written
+  log->flush();
+  log->always("%llu messages were dropped", (unsigned long long)log->getDropCount());
+
+  delete log;
+  delete cfg;
+  //! [async example]
+}
+
+void flush_example() {
+  //! [flush example]
+  // Create a CfgLog object
+  CfgLog *cfg = new CfgLog();
+
+  cfg->logToFile = true;                                    // enable logging to file
+  strncpy(cfg->logfile, "test2.log", CfgLog::CMaxPathLen);  // set path to logfile
+  cfg->flushMode = CfgLog::EFlushSeverity;                  // buffer records, but flush errors right away
+  cfg->flushLevel = CfgLog::ELogError;                      // flush on error and above
+  cfg->flushBufSize = 256 * 1024;                           // write out at most every 256 KiB
+
+  // Create a Logger object from the config
+  Logger *log = new Logger(cfg);
+  log->info("This info is buffered");
+  log->error("This error is written right away, along with everything before it");
+  log->info("This info is buffered again");
+
+  // write out everything that is buffered
+  log->flush();
+
+  delete log;
+  delete cfg;
+  //! [flush example]
+}
+
+void rotation_example() {
+  //! [rotation example]
+  // Create a CfgLog object
+  CfgLog *cfg = new CfgLog();
+
+  cfg->logToFile = true;                                    // enable logging to file
+  strncpy(cfg->logfile, "test3.log", CfgLog::CMaxPathLen);  // set path to logfile
+  cfg->appendToFile = true;                                 // continue an existing logfile
+  cfg->rotateSize = 4 * 1024;                               // rotate once the logfile reaches 4 KiB
+  cfg->rotateInterval = 24 * 60 * 60;                       // and at midnight (UTC)
+  cfg->rotateKeep = 3;                                      // keep test3.log.1 up to test3.log.3
+
+  // Create a Logger object from the config
+  Logger *log = new Logger(cfg);
+  for (int i = 0; i < 500; i++) {
+    log->info("This is line %d", i);
+  }
+
+  delete log;
+  delete cfg;
+  //! [rotation example]
+}
+
+void binary_example() {
+  //! [binary example]
+  // Create a CfgLog object
+  CfgLog *cfg = new CfgLog();
+
+  cfg->logToFile = true;                                    // enable logging to file
+  strncpy(cfg->logfile, "test4.bin", CfgLog::CMaxPathLen);  // set path to logfile
+  cfg->backend = CfgLog::EBackendBinary;                    // store format ids and raw arguments
+
+  // Create a Logger object from the config
+  Logger *log = new Logger(cfg);
+  for (int i = 0; i < 10; i++) {
+    log->info("request %d took %u us, %.3f%% of the budget", i, i * 100, i / 10.0);
+  }
+
+  delete log;
+  delete cfg;
+
+  // decode with: bin/logdecode -p verbose test4.bin
+  //! [binary example]
+}
+
+/// stands in for an expensive dump that should only run if it is logged
+static const char *dump_state() {
+  printf("dump_state() was called\n");
+  return "state";
+}
+
+void macro_example() {
+  //! [macro example]
+  // Create a new Logger object
+  Logger *log = new Logger();
+  log->setProfile(CfgLog::ELogProfileMinimal);
+  log->setLevel(CfgLog::ELogInfo);
+
+  // the level is checked before the arguments are evaluated
+  LOGGER_INFO(log, "This info is logged with %s", dump_state());
+  LOGGER_DEBUG(log, "This debug msg is skipped, %s is not called", dump_state());
+
+  delete log;
+  //! [macro example]
+}
+
+void limit_example() {
+  //! [limit example]
+  // Create a new Logger object
+  Logger *log = new Logger();
+  log->setProfile(CfgLog::ELogProfileMinimal);
+
+  for (int i = 0; i < 10; i++) {
+    // at most 3 lines per second from this call site
+    LOGGER_INFO_RATE(log, 3, "retry %d of the request", i);
+    // every 4th call from this call site
+    LOGGER_DEBUG_SAMPLE(log, 4, LOGGER_FMT("polled the queue {} times"), i);
+  }
+
+  delete log;
+  //! [limit example]
+}
+
+void format_example() {
+  //! [format example]
+  // Create a new Logger object
+  Logger *log = new Logger();
+  log->setProfile(CfgLog::ELogProfileMinimal);
+
+  int id = 42;
+  double dt = 12.5;
+  std::string host("db-01");
+
+  // the format string is checked against the arguments at compile time
+  log->info(LOGGER_FMT("user {} took {} us on {}"), id, dt, host);
+  log->info(LOGGER_FMT("ratio {:.3}, flags {:x}, {{braces}}"), 2 / 3.0, 255);
+  LOGGER_DEBUG(log, LOGGER_FMT("the macros take formats too, {}"), true);
+
+  delete log;
+  //! [format example]
+}
+
+void sink_example() {
+  //! [sink example]
+  // Create a new Logger object writing infos to the terminal
+  Logger *log = new Logger();
+  log->setProfile(CfgLog::ELogProfileMinimal);
+  log->setLevel(CfgLog::ELogInfo);
+
+  // errors also go to an alert file, everything down to debug into an in-memory ring of the last 4 lines
+  RingSink *ring = new RingSink(4);
+  log->addSink(new FdSink("test5.log", false, 0), CfgLog::ELogError);
+  log->addSink(ring, CfgLog::ELogDebug, "&lev&sep&msg&end");
+
+  for (int i = 0; i < 4; i++) {
+    log->debug("step %d done", i);
+  }
+  log->info("retrying the request");
+  log->error("request failed");
+
+  // show what led to the error
+  ring->dump(stdout);
+
+  delete log;
+  //! [sink example]
+}
+
+void dedup_example() {
+  //! [dedup example]
+  // Create a CfgLog object
+  CfgLog *cfg = new CfgLog();
+  cfg->profile = CfgLog::ELogProfileMinimal;
+  cfg->dedupWindow = 1000;    // suppress repeats within a second
+
+  // Create a Logger object from the config
+  Logger *log = new Logger(cfg);
+  for (int i = 0; i < 5000; i++) {
+    log->error("connection to %s refused", "db-01");
+  }
+  log->info("failing over to %s", "db-02");
+
+  delete log;
+  delete cfg;
+  //! [dedup example]
+}
+
+void recorder_example() {
+  //! [recorder example]
+  // Create a CfgLog object
+  CfgLog *cfg = new CfgLog();
+  cfg->profile = CfgLog::ELogProfileMinimal;
+  cfg->logLevel = CfgLog::ELogNotice;
+  cfg->useRecorder = true;        // keep info and debug msgs in memory
+  cfg->recorderLen = 4;           // the last 4 of each thread
+
+  // Create a Logger object from the config
+  Logger *log = new Logger(cfg);
+  for (int i = 0; i < 10; i++) {
+    log->debug("polling queue %d", i);
+  }
+  log->info("queue %d stalled", 9);
+  log->notice("retrying");
+  // an alert writes out the recorded msgs first
+  log->alert("queue %d lost", 9);
+
+  delete log;
+  delete cfg;
+  //! [recorder example]
+}
+
+void stats_example() {
+  //! [stats example]
+  // Create a CfgLog object
+  CfgLog *cfg = new CfgLog();
+  cfg->profile = CfgLog::ELogProfileMinimal;
+  cfg->logLevel = CfgLog::ELogInfo;
+  cfg->statsInterval = 60;        // log the counters every minute
+
+  // Create a Logger object from the config
+  Logger *log = new Logger(cfg);
+  for (int i = 0; i < 100; i++) {
+    LOGGER_DEBUG(log, "polling queue %d", i);
+  }
+  log->info("queue %d stalled", 9);
+
+  // or read them yourself
+  LogStats::stats_t stats;
+  log->getStats(&stats);
+  log->info("%llu debug msgs filtered, %llu bytes written", (unsigned long long)stats.filtered[CfgLog::ELogDebug],
+            (unsigned long long)stats.bytes);
+
+  delete log;
+  delete cfg;
+  //! [stats example]
+}
+
+void json_example() {
+  //! [json example]
+  // Create a CfgLog object
+  CfgLog *cfg = new CfgLog();
+  cfg->profile = CfgLog::ELogProfileJson;   // one JSON object per line
+
+  // Create a Logger object from the config
+  Logger *log = new Logger(cfg);
+  log->info("request served", {{"path", "/index.html"}, {"status", 200}, {"ms", 1.25}, {"cached", true}});
+  log->warning("disk %s is %d%% full", "/dev/sda1", 91);
+
+  // other profiles append the fields to the msg
+  log->setProfile(CfgLog::ELogProfileMinimal);
+  log->info("request served", {{"path", "/index.html"}, {"status", 200}, {"ms", 1.25}, {"cached", true}});
+
+  delete log;
+  delete cfg;
+  //! [json example]
+}
+
+void child_example() {
+  //! [child example]
+  // Create a CfgLog object
+  CfgLog *cfg = new CfgLog();
+  cfg->profile = CfgLog::ELogProfileMinimal;
+  cfg->logLevel = CfgLog::ELogInfo;
+
+  // Create a Logger object and named children for the modules, they share its output and pattern
+  Logger *log = new Logger(cfg);
+  LogChild *http = log->getChild("net.http");
+  LogChild *client = log->getChild("net.http.client");
+  LogChild *db = log->getChild("db");
+
+  // debug for net.http and below, everything else stays at info
+  http->setLevel(CfgLog::ELogDebug);
+  client->debug("connecting to %s", "example.com");
+  LOGGER_DEBUG(db, "not logged");
+  db->info("pool of %d connections", 8);
+
+  // children without an override follow the Logger
+  log->setLevel(CfgLog::ELogWarn);
+  db->info("not logged either");
+  client->debug(LOGGER_FMT("{} bytes in"), 512);
+
+  delete log;
+  delete cfg;
+  //! [child example]
+}
+
+void config_example() {
+  //! [config example]
+  // A config file as an admin would write it
+  FILE *fd = fopen("test_config.conf", "w");
+  fputs("# levels and layout\n"
+        "logLevel = info\n"
+        "profile = minimal\n"
+        "logLevel.net = debug\n", fd);
+  fclose(fd);
+
+  // Read it into a CfgLog, watchConfig = yes in the file would apply edits as they are saved
+  CfgLog *cfg = new CfgLog();
+  if (cfg->load("test_config.conf") == CfgLog::EErr) return;
+
+  Logger *log = new Logger(cfg);
+  LogChild *net = log->getChild("net");
+  net->debug("handshake done");
+  log->debug("not logged");
+
+  // After an edit, apply the new settings to the running Logger
+  fd = fopen("test_config.conf", "w");
+  fputs("logLevel = debug\n"
+        "pattern = &lev&sep&msg&end\n"
+        "separator = \": \"\n", fd);
+  fclose(fd);
+
+  CfgLog next;
+  if (next.load("test_config.conf") == CfgLog::ENoErr) log->reload(&next);
+  log->debug("logged now");
+  net->warning("net follows the Logger again");
+
+  delete log;
+  delete cfg;
+  remove("test_config.conf");
+  //! [config example]
+}
+
 int main(void) {
 
   Logger *mainLog = new Logger();
@@ -192,6 +525,34 @@ int main(void) {
   userPatternShorthand_example();
   mainLog->always("\nStarting color example...");
   color_example();
+  mainLog->always("\nStarting async example...");
+  async_example();
+  mainLog->always("\nStarting flush example...");
+  flush_example();
+  mainLog->always("\nStarting rotation example...");
+  rotation_example();
+  mainLog->always("\nStarting binary example...");
+  binary_example();
+  mainLog->always("\nStarting macro example...");
+  macro_example();
+  mainLog->always("\nStarting limit example...");
+  limit_example();
+  mainLog->always("\nStarting format example...");
+  format_example();
+  mainLog->always("\nStarting sink example...");
+  sink_example();
+  mainLog->always("\nStarting dedup example...");
+  dedup_example();
+  mainLog->always("\nStarting recorder example...");
+  recorder_example();
+  mainLog->always("\nStarting stats example...");
+  stats_example();
+  mainLog->always("\nStarting json example...");
+  json_example();
+  mainLog->always("\nStarting child example...");
+  child_example();
+  mainLog->always("\nStarting config example...");
+  config_example();
 
   delete mainLog;
   return 0;
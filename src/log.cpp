@@ -10,31 +10,86 @@
 /// @brief Implementation of the Logger class
 
 #include "log.h"
+#include "logQueue.h"
+#include "logSink.h"
+#include "logBinary.h"
+#include "logDedup.h"
+#include "logRecorder.h"
+#include "logWatch.h"
 #include <errno.h>
-#include <time.h>
 #include <unistd.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <algorithm>
+
+/// pattern and level case of a standard profile
+typedef struct stdProfile {
+  CfgLog::profile_e profile;    ///< the profile
+  const char       *pattern;    ///< its pattern
+  int               levelCase;  ///< its level case
+} stdProfile_t;
+
+/// the standard profiles, looked up by their profile since the user profile sits between them
+static const stdProfile_t std_profiles[] = {
+  { CfgLog::ELogProfileNone,    "&msg&end",                             CfgLog::ELevelCaseLower   },
+  { CfgLog::ELogProfileMinimal, "&pre&lev&sep&msg&end",                 CfgLog::ELevelCaseLower   },
+  { CfgLog::ELogProfileDefault, "&pre&tim&sep&lev&sep&msg&end",         CfgLog::ELevelCaseDefault },
+  { CfgLog::ELogProfileVerbose, "&pre&pid&sep&tim&sep&lev&sep&msg&end", CfgLog::ELevelCaseUpper   },
+  { CfgLog::ELogProfileJson,    "&jsn&end",                             CfgLog::ELevelCaseLower   },
+};
+
+/// Return the standard profile \a profile, NULL if it is none
+static const stdProfile_t *findStdProfile(int profile) {
+  for (size_t i = 0; i < sizeof(std_profiles) / sizeof(std_profiles[0]); i++) {
+    if (std_profiles[i].profile == profile) return &std_profiles[i];
+  }
+  return NULL;
+}
+
+/// escape sequence ending a colored record
+static const char CColorReset[]  = "\033[0m";
+static const int  CColorResetLen = sizeof(CColorReset) - 1;
+
+/// number of Loggers created so far, each tags its records in the flight recorder with its number
+static std::atomic<uint32_t> s_recIds(0);
 
-/// default logprofile patterns
-char default_patterns[][CfgLog::CMaxPatternLen] = {
-                     "&msg&end",                              ///< corresponds to CfgLog::ELogProfileNone
-                     "&pre&lev&sep&msg&end",                  ///< corresponds to CfgLog::ELogProfileMinimal
-                     "&pre&tim&sep&lev&sep&msg&end",          ///< corresponds to CfgLog::ELogProfileDefault
-                     "&pre&pid&sep&tim&sep&lev&sep&msg&end",  ///< corresponds to CfgLog::ELogProfileVerbose
-                    };
-/// default level case config for default profiles
-int default_level_cases[] = {
-                              CfgLog::ELevelCaseLower,        ///< corresponds to CfgLog::ELogProfileNone
-                              CfgLog::ELevelCaseLower,        ///< corresponds to CfgLog::ELogProfileMinimal
-                              CfgLog::ELevelCaseDefault,      ///< corresponds to CfgLog::ELogProfileDefault
-                              CfgLog::ELevelCaseUpper         ///< corresponds to CfgLog::ELogProfileVerbose
-                            };
+/// Return the kernel thread id of the caller
+static long currentTid() {
+  static thread_local long tid = 0;
+  if (tid == 0) tid = syscall(SYS_gettid);
+  return tid;
+}
+
+/// Return a coarse monotonic timestamp in milliseconds
+static uint64_t nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
 Logger::Logger() : Logger(NULL, CfgLog::CLogLevelDefault, CfgLog::CLogProfileDefault) {}
 Logger::Logger(const char *logfile, CfgLog::level_e level, CfgLog::profile_e profile) {
 
+  m_queue = NULL;
+  m_fd    = NULL;
+  m_fdBuf = NULL;
+  m_sink  = NULL;
+  m_rotate = false;
+  m_config = NULL;
+  m_binary = NULL;
+  m_dedup = NULL;
+  m_recLevel = -1;
+  m_recId = ++s_recIds;
+  m_recDumped = NULL;
+  m_tty = false;
+  m_sinkLevel = -1;
+  m_suppressed = NULL;
+  m_children = NULL;
+  m_watch = NULL;
+  m_stats = new LogStats();
   m_cfg = new CfgLog();
   m_removeCfg = true;
   m_cfg->logLevel = level;
@@ -48,6 +103,23 @@ Logger::Logger(const char *logfile, CfgLog::level_e level, CfgLog::profile_e pro
 }
 
 Logger::Logger(CfgLog *cfg) {
+  m_queue = NULL;
+  m_fd    = NULL;
+  m_fdBuf = NULL;
+  m_sink  = NULL;
+  m_rotate = false;
+  m_config = NULL;
+  m_binary = NULL;
+  m_dedup = NULL;
+  m_recLevel = -1;
+  m_recId = ++s_recIds;
+  m_recDumped = NULL;
+  m_tty = false;
+  m_sinkLevel = -1;
+  m_suppressed = NULL;
+  m_children = NULL;
+  m_watch = NULL;
+  m_stats = new LogStats();
   if (cfg == NULL) {
     m_cfg = new CfgLog();
     m_removeCfg = true;
@@ -59,22 +131,37 @@ Logger::Logger(CfgLog *cfg) {
 }
 
 Logger::~Logger() {
-  if ((m_removeCfg) && (m_cfg != NULL)) {
-    delete m_cfg;
+  stopWatch();
+  stopTimer();
+  if (m_dedup != NULL) reportRepeats(UINT64_MAX);
+  reportListed();
+  stopWriter();
+  stopRotator();
+  closeOutput();
+  freeConfig();
+  delete m_binary;
+  delete m_dedup;
+  delete m_stats;
+  delete[] m_recDumped;
+
+  while (m_children != NULL) {
+    LogChild *next = m_children->m_next;
+    delete m_children;
+    m_children = next;
   }
 
-  if (m_fd != NULL && m_fd != stdout) {
-    fflush(m_fd);
-    if (fclose(m_fd) != 0) {
-      fprintf(stderr, "Failed to close logfile\n");
-    } else {
-      m_fd = NULL;
-    }
+  if ((m_removeCfg) && (m_cfg != NULL)) {
+    delete m_cfg;
   }
 }
 
 int Logger::init(CfgLog *cfg) {
   if (cfg != NULL) {
+    // the writer, rotator, stats thread and watcher read the config that is about to be replaced
+    stopWatch();
+    stopTimer();
+    stopWriter();
+    stopRotator();
     if (m_removeCfg) delete m_cfg;
     m_cfg = cfg;
     m_removeCfg = false;
@@ -86,22 +173,1060 @@ int Logger::init(CfgLog *cfg) {
 
 void Logger::init() {
 
+  // repeats counted so far go to the previous destination
+  stopWatch();
+  stopTimer();
+  if (m_dedup != NULL) reportRepeats(UINT64_MAX);
+
+  // a running writer still references the previous destination
+  stopWriter();
+  stopRotator();
+  closeOutput();
+
   // set log destination
-  m_fd = NULL;
+  output_t out;
   if (m_cfg->logToFile) {
-    m_fd = fopen(m_cfg->logfile, "w");
-    if (m_fd == NULL) {
+    if (openOutput(&out, m_cfg->appendToFile) != ENoErr) {
       m_cfg->logToFile = false;
-      m_fd = stdout;
-      fprintf(stderr, "Failed to reroute logging to file @ %s: %d", m_cfg->logfile, errno);
       fprintf(stderr, "Routing all logging to stdout");
     }
-  } else {
-    m_fd = stdout;
   }
+  if (!m_cfg->logToFile) {
+    out.fd    = NULL;
+    out.fdBuf = NULL;
+    out.sink  = NULL;
+    if (m_cfg->backend == CfgLog::EBackendStdio) {
+      out.fd = stdout;
+    } else {
+      // a memory mapped stdout is not possible, fall back to plain writes
+      out.sink = new FdSink(fileno(stdout), ((m_cfg->backend == CfgLog::EBackendFdBatch) || (m_cfg->backend == CfgLog::EBackendBinary)), m_cfg->flushBufSize);
+    }
+  }
+  m_fd    = out.fd;
+  m_fdBuf = out.fdBuf;
+  m_sink  = out.sink;
+  m_lastFlush = nowMs();
+
+  // colors are only rendered for terminals, logfiles are never considered one
+  m_tty = !m_cfg->logToFile && isatty(fileno(stdout));
+
+  // binary records start with the header and the format strings known so far
+  delete m_binary;
+  m_binary = NULL;
+  if (m_cfg->backend == CfgLog::EBackendBinary) {
+    m_binary = new LogBinary();
+    (void)m_binary->writeDictionary(m_sink);
+  }
+  delete m_dedup;
+  m_dedup = (m_cfg->dedupWindow > 0) ? new LogDedup(m_cfg->dedupWindow) : NULL;
+
+  // the recorder is shared by all Loggers, its first configuration sticks
+  if (m_cfg->useRecorder) LogRecorder::enable(m_cfg->recorderLen, m_cfg->recorderFile);
+  m_recLevel = m_cfg->useRecorder ? m_cfg->recorderLevel : -1;
+
+  m_level = m_cfg->logLevel;
+  applyModuleLevels(NULL, m_cfg);
 
-  // initialize the profile
+  // initialize the profile, colors depend on the new output
   initProfile(m_cfg->profile);
+
+  startRotator();
+  startWriter();
+  startTimer();
+  startWatch();
+}
+
+int Logger::openOutput(output_t *out, bool append) {
+
+  out->fd    = NULL;
+  out->fdBuf = NULL;
+  out->sink  = NULL;
+
+  if (m_cfg->backend == CfgLog::EBackendMmap) {
+    MmapSink *sink = new MmapSink(m_cfg->logfile, m_cfg->mmapChunkSize, append);
+    if (!sink->isOpen()) {
+      delete sink;
+      return EErr;
+    }
+    out->sink = sink;
+  } else if (m_cfg->backend != CfgLog::EBackendStdio) {
+    FdSink *sink = new FdSink(m_cfg->logfile, ((m_cfg->backend == CfgLog::EBackendFdBatch) || (m_cfg->backend == CfgLog::EBackendBinary)),
+                              m_cfg->flushBufSize, append);
+    if (!sink->isOpen()) {
+      delete sink;
+      return EErr;
+    }
+    out->sink = sink;
+  } else {
+    out->fd = fopen(m_cfg->logfile, append ? "a" : "w");
+    if (out->fd == NULL) {
+      fprintf(stderr, "Failed to reroute logging to file @ %s: %d", m_cfg->logfile, errno);
+      return EErr;
+    }
+    if (m_cfg->flushBufSize > 0) {
+      // the buffer size decides how many bytes go out per write
+      out->fdBuf = new char[m_cfg->flushBufSize];
+      setvbuf(out->fd, out->fdBuf, _IOFBF, m_cfg->flushBufSize);
+    }
+  }
+  return ENoErr;
+}
+
+void Logger::closeOutput() {
+  output_t out = { m_fd, m_fdBuf, m_sink };
+  closeOutput(&out);
+  m_fd    = NULL;
+  m_fdBuf = NULL;
+  m_sink  = NULL;
+}
+
+void Logger::closeOutput(output_t *out) {
+
+  if (out->sink != NULL) {
+    delete out->sink;
+    out->sink = NULL;
+  }
+
+  if (out->fd == NULL) return;
+
+  if (out->fd == stdout) {
+    (void)fflush(out->fd);
+  } else {
+    fflush(out->fd);
+    if (fclose(out->fd) != 0) {
+      fprintf(stderr, "Failed to close logfile\n");
+    }
+  }
+  out->fd = NULL;
+
+  // the buffer must outlive the stream
+  delete[] out->fdBuf;
+  out->fdBuf = NULL;
+}
+
+void Logger::startRotator() {
+
+  m_rotate = m_cfg->logToFile && ((m_cfg->rotateSize > 0) || (m_cfg->rotateInterval > 0));
+  if (!m_rotate) return;
+
+  struct stat st;
+  m_outBytes    = (m_cfg->appendToFile && (stat(m_cfg->logfile, &st) == 0)) ? st.st_size : 0;
+  m_nextReady   = false;
+  m_rotating    = false;
+  m_rotatorStop = false;
+  m_next.fd = m_old.fd = NULL;
+  m_next.fdBuf = m_old.fdBuf = NULL;
+  m_next.sink = m_old.sink = NULL;
+  m_rotator = std::thread(&Logger::rotatorLoop, this);
+}
+
+void Logger::stopRotator() {
+
+  if (!m_rotate) return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_rotateLock);
+    m_rotatorStop = true;
+  }
+  m_wakeRotator.notify_one();
+  m_rotator.join();
+  m_rotate = false;
+}
+
+void Logger::rotateCheck(size_t written) {
+
+  if (!m_rotate) return;
+
+  if (m_nextReady.load(std::memory_order_acquire)) {
+    // swap in the new logfile, the rotator closes the old one
+    std::lock_guard<std::mutex> lock(m_rotateLock);
+    m_old.fd    = m_fd;
+    m_old.fdBuf = m_fdBuf;
+    m_old.sink  = m_sink;
+    m_fd    = m_next.fd;
+    m_fdBuf = m_next.fdBuf;
+    m_sink  = m_next.sink;
+    m_next.fd    = NULL;
+    m_next.fdBuf = NULL;
+    m_next.sink  = NULL;
+    m_outBytes   = 0;
+    m_nextReady  = false;
+    m_wakeRotator.notify_one();
+
+    // each binary file can be decoded on its own
+    if (m_binary != NULL) (void)m_binary->writeDictionary(m_sink);
+    return;
+  }
+
+  m_outBytes += written;
+  if ((m_cfg->rotateSize > 0) && (m_outBytes >= m_cfg->rotateSize) && !m_rotating.exchange(true)) {
+    m_wakeRotator.notify_one();
+  }
+}
+
+void Logger::rotatorLoop() {
+
+  std::unique_lock<std::mutex> lock(m_rotateLock);
+  time_t next = nextRotation();
+
+  for (;;) {
+    if ((m_old.fd != NULL) || (m_old.sink != NULL)) {
+      // the writers have moved on, the old logfile can be closed
+      output_t old = m_old;
+      m_old.fd    = NULL;
+      m_old.fdBuf = NULL;
+      m_old.sink  = NULL;
+      lock.unlock();
+      closeOutput(&old);
+      lock.lock();
+      m_rotating = false;
+      continue;
+    }
+
+    if (m_rotatorStop) break;
+
+    if ((next != 0) && (time(NULL) >= next)) {
+      next = nextRotation();
+      m_rotating = true;
+    }
+
+    if (m_rotating && !m_nextReady) {
+      output_t out;
+      lock.unlock();
+      int ret = rotateFiles(&out);
+      lock.lock();
+
+      if (ret == ENoErr) {
+        m_next = out;
+        m_nextReady = true;
+      } else {
+        // keep writing to the current file, retry later
+        m_wakeRotator.wait_for(lock, std::chrono::seconds(1));
+        m_rotating = false;
+      }
+      continue;
+    }
+
+    if (next != 0) {
+      m_wakeRotator.wait_for(lock, std::chrono::seconds(next - time(NULL)));
+    } else {
+      m_wakeRotator.wait(lock);
+    }
+  }
+
+  // a prepared logfile that was never swapped in
+  if (m_nextReady) {
+    closeOutput(&m_next);
+    m_nextReady = false;
+  }
+}
+
+time_t Logger::nextRotation() {
+  if (m_cfg->rotateInterval <= 0) return 0;
+  time_t now = time(NULL);
+  return (now / m_cfg->rotateInterval + 1) * m_cfg->rotateInterval;
+}
+
+int Logger::rotateFiles(output_t *out) {
+
+  char from[CfgLog::CMaxPathLen + 16];
+  char to[CfgLog::CMaxPathLen + 16];
+  const char *path = m_cfg->logfile;
+  int keep = m_cfg->rotateKeep;
+
+  // shift logfile.N-1 -> logfile.N ... logfile -> logfile.1, dropping the oldest
+  // writers still append to the current file, which keeps its descriptor when renamed
+  if (keep > 0) {
+    snprintf(to, sizeof(to), "%s.%d", path, keep);
+    (void)unlink(to);
+    for (int i = keep - 1; i > 0; i--) {
+      snprintf(from, sizeof(from), "%s.%d", path, i);
+      snprintf(to, sizeof(to), "%s.%d", path, i + 1);
+      (void)rename(from, to);
+    }
+    snprintf(to, sizeof(to), "%s.1", path);
+    if (rename(path, to) != 0) {
+      fprintf(stderr, "Failed to rotate logfile @ %s: %d\n", path, errno);
+      return EErr;
+    }
+  } else if (unlink(path) != 0) {
+    fprintf(stderr, "Failed to rotate logfile @ %s: %d\n", path, errno);
+    return EErr;
+  }
+
+  // the new file starts out empty, regardless of appendToFile
+  return openOutput(out, false);
+}
+
+void Logger::flushOutput() {
+
+  struct timespec start, end;
+  int rc = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (m_sink != NULL) {
+    rc = (m_sink->flush() == ENoErr) ? 0 : EOF;
+  } else if (m_fd != NULL) {
+    rc = fflush(m_fd);
+  } else return;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  if (rc != 0) m_stats->writeError();
+  m_stats->flushed((uint64_t)(end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec);
+}
+
+bool Logger::flushDue(CfgLog::level_e lev) {
+
+  CfgLog::flush_e mode = m_cfg->flushMode;
+
+  // flushing a mapping is a blocking msync, it has a policy of its own
+  if (m_cfg->backend == CfgLog::EBackendMmap) {
+    switch (m_cfg->msyncMode) {
+      case CfgLog::EMsyncInterval: mode = CfgLog::EFlushInterval; break;
+      case CfgLog::EMsyncSeverity: mode = CfgLog::EFlushSeverity; break;
+      default:                     return false;
+    }
+  }
+
+  switch (mode) {
+    case CfgLog::EFlushSeverity:
+      // always msgs are as urgent as the most severe ones
+      return (lev == CfgLog::ELogAlways) || (lev <= m_cfg->flushLevel);
+    case CfgLog::EFlushSize:
+      // stdio writes the buffer out once it is full
+      return false;
+    case CfgLog::EFlushInterval: {
+      uint64_t now  = nowMs();
+      uint64_t last = m_lastFlush.load(std::memory_order_relaxed);
+      if (now - last < (uint64_t)m_cfg->flushInterval) return false;
+      // only one of several racing threads flushes
+      return m_lastFlush.compare_exchange_strong(last, now);
+    }
+    case CfgLog::EFlushRecord: // move to default
+    default:
+      return true;
+  }
+}
+
+void Logger::startWriter() {
+
+  m_dropped = 0;
+  if (!m_cfg->useAsync) return;
+
+  m_queue       = new LogQueue(m_cfg->asyncQueueLen);
+  m_stop        = false;
+  m_writerIdle  = false;
+  m_flushTarget = 0;
+  m_flushedPos  = 0;
+  m_writer      = std::thread(&Logger::writerLoop, this);
+}
+
+void Logger::stopWriter() {
+
+  if (m_queue == NULL) return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_asyncLock);
+    m_stop = true;
+  }
+  m_wakeWriter.notify_one();
+  m_writer.join();
+
+  delete m_queue;
+  m_queue = NULL;
+}
+
+void Logger::writerLoop() {
+
+  LogQueue::record_t *rec = NULL;
+  struct iovec iov[CAsyncBatchLen];
+  bool unflushed = false;
+
+  for (;;) {
+    bool due = false;
+    int n = 0;
+
+    // collect a batch, the flush policy decides whether it goes out right away
+    while ((n < CAsyncBatchLen) && ((rec = m_queue->peek(n)) != NULL)) {
+      iov[n].iov_base = rec->msg;
+      iov[n].iov_len  = rec->len;
+      if (flushDue((CfgLog::level_e)rec->level)) due = true;
+      n++;
+    }
+
+    if (n > 0) {
+      // the whole batch goes out in one writev, straight from the queue slots
+      size_t written = writeOutput(iov, n);
+      m_queue->release(n);
+      unflushed = true;
+      rotateCheck(written);
+    }
+
+    // an idle writer still honours the flush interval, and flush() waits for everything up to its target
+    if (unflushed && (due || flushDue(CfgLog::ELogAlways) || (m_flushTarget > m_flushedPos))) {
+      flushOutput();
+      unflushed = false;
+      {
+        std::lock_guard<std::mutex> lock(m_asyncLock);
+        m_flushedPos = m_queue->tail();
+      }
+      m_flushed.notify_all();
+    }
+    if (n > 0) continue;
+
+    // queue is empty
+    std::unique_lock<std::mutex> lock(m_asyncLock);
+    if (m_stop) break;
+    if (unflushed && (m_flushTarget > m_flushedPos)) continue;
+    m_writerIdle = true;
+    if (m_queue->peek() == NULL) {
+      // producers only wake us if they see the idle flag, so don't sleep forever
+      m_wakeWriter.wait_for(lock, std::chrono::milliseconds(10));
+    }
+    m_writerIdle = false;
+  }
+}
+
+void Logger::flush() {
+
+  if (m_dedup != NULL) {
+    uint64_t now = nowMs();
+    if (m_dedup->expiring(now)) reportRepeats(now);
+  }
+
+  LogEpoch::guard epoch;
+  const config_t *cfg = m_config.load(std::memory_order_acquire);
+  const sinkSet_t *set = (cfg != NULL) ? cfg->sinks : NULL;
+  if (set != NULL) {
+    std::lock_guard<std::mutex> lock(m_sinkLock);
+    for (int i = 0; i < set->cnt; i++) {
+      if (set->sinks[i].sink->flush() != ENoErr) m_stats->writeError();
+    }
+  }
+
+  if (m_queue == NULL) {
+    std::lock_guard<std::mutex> lock(m_emitLock);
+    flushOutput();
+    return;
+  }
+
+  size_t target = m_queue->head();
+  std::unique_lock<std::mutex> lock(m_asyncLock);
+  if (m_flushTarget < target) m_flushTarget = target;
+  m_wakeWriter.notify_one();
+  while (m_flushedPos < target) {
+    m_flushed.wait(lock);
+  }
+}
+
+uint64_t Logger::getDropCount() {
+  return m_dropped;
+}
+
+void Logger::getStats(LogStats::stats_t *stats) {
+
+  m_stats->snapshot(stats);
+  stats->dropped = m_dropped;
+  if (m_queue != NULL) {
+    stats->queueLen   = m_queue->capacity();
+    stats->queueDepth = m_queue->head() - m_queue->tail();
+  }
+}
+
+void Logger::startTimer() {
+
+  m_timerStop = false;
+  m_timer = std::thread(&Logger::timerLoop, this);
+}
+
+void Logger::stopTimer() {
+
+  if (!m_timer.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_timerLock);
+    m_timerStop = true;
+  }
+  m_wakeTimer.notify_one();
+  m_timer.join();
+}
+
+bool Logger::flushByInterval() {
+  if (m_cfg->backend == CfgLog::EBackendMmap) return m_cfg->msyncMode == CfgLog::EMsyncInterval;
+  return m_cfg->flushMode == CfgLog::EFlushInterval;
+}
+
+void Logger::timerLoop() {
+
+  std::unique_lock<std::mutex> lock(m_timerLock);
+  uint64_t statsMs = (uint64_t)m_cfg->statsInterval * 1000;
+  uint64_t nextStats = (statsMs > 0) ? nowMs() + statsMs : UINT64_MAX;
+  // the writer thread of an asynchronous Logger flushes by time itself
+  bool flushing = flushByInterval() && (m_queue == NULL);
+  uint64_t nextTick = 0;
+  uint64_t nextReport = nowMs() + CReportMs;
+
+  while (!m_timerStop) {
+    uint64_t now = nowMs();
+    uint64_t wake = std::min(nextStats, nextReport);
+    bool ticking = m_sinkLevel.load(std::memory_order_relaxed) >= 0;
+    if (ticking) wake = std::min(wake, nextTick);
+    if (flushing) wake = std::min(wake, m_lastFlush.load(std::memory_order_relaxed) + m_cfg->flushInterval);
+    if (wake > now) {
+      m_wakeTimer.wait_for(lock, std::chrono::milliseconds(wake - now));
+      continue;
+    }
+    lock.unlock();
+
+    if (now >= nextStats) {
+      logStats();
+      nextStats = now + statsMs;
+    }
+    if (now >= nextReport) {
+      // call sites which went quiet after suppressing calls are reported here
+      if (m_suppressed.load(std::memory_order_relaxed) != NULL) reportListed();
+      nextReport = now + CReportMs;
+    }
+    if (ticking && (now >= nextTick)) {
+      // sinks batching records send those which have waited too long
+      LogEpoch::guard epoch;
+      const config_t *cfg = m_config.load(std::memory_order_acquire);
+      const sinkSet_t *set = (cfg != NULL) ? cfg->sinks : NULL;
+      if (set != NULL) {
+        std::lock_guard<std::mutex> sinks(m_sinkLock);
+        for (int i = 0; i < set->cnt; i++) set->sinks[i].sink->tick();
+      }
+      nextTick = now + CSinkTickMs;
+    }
+    if (flushing) {
+      // a record logged meanwhile may have flushed already
+      std::lock_guard<std::mutex> emit(m_emitLock);
+      if (flushDue(CfgLog::ELogAlways)) flushOutput();
+    }
+    lock.lock();
+  }
+}
+
+void Logger::startWatch() {
+
+  if (!m_cfg->watchConfig || (m_cfg->configFile[0] == '\0')) return;
+
+  m_watch = new LogWatch(m_cfg->configFile);
+  if (!m_watch->isOpen()) {
+    delete m_watch;
+    m_watch = NULL;
+    return;
+  }
+  m_watchThread = std::thread(&Logger::watchLoop, this);
+}
+
+void Logger::stopWatch() {
+
+  if (!m_watchThread.joinable()) return;
+
+  m_watch->stop();
+  m_watchThread.join();
+  delete m_watch;
+  m_watch = NULL;
+}
+
+void Logger::watchLoop() {
+
+  // init() stops the watcher before touching the config, the path stays as it is
+  const char *path = m_cfg->configFile;
+  int ret;
+
+  while ((ret = m_watch->wait()) == LogWatch::EChanged) {
+    // a config file with errors is reported by load() and leaves the current settings alone
+    CfgLog next;
+    if (next.load(path) != CfgLog::ENoErr) continue;
+    if (reload(&next) == ENoErr) notice("reloaded config %s", path);
+  }
+  if (ret == LogWatch::EFailed) fprintf(stderr, "Stopped watching config %s\n", path);
+}
+
+void Logger::logStats() {
+
+  LogStats::stats_t st;
+  char msg[CfgLog::CMaxLogMsgLen];
+  char *pos = msg;
+  char *end = msg + sizeof(msg);
+  uint64_t total[2] = { 0, 0 };
+
+  getStats(&st);
+  for (int lev = 0; lev < LogStats::CLevels; lev++) {
+    total[0] += st.emitted[lev];
+    total[1] += st.filtered[lev];
+  }
+
+  // per level counts only for the levels that occurred
+  const uint64_t *counts[2] = { st.emitted, st.filtered };
+  const char *names[2] = { "emitted", "filtered" };
+  pos += snprintf(pos, end - pos, "logger stats:");
+  for (int k = 0; (k < 2) && (pos < end); k++) {
+    const char *sep = " (";
+    pos += snprintf(pos, end - pos, " %s %llu", names[k], (unsigned long long)total[k]);
+    for (int lev = 0; (lev < LogStats::CLevels) && (pos < end); lev++) {
+      if (counts[k][lev] == 0) continue;
+      pos += snprintf(pos, end - pos, "%s%s %llu", sep, CfgLog::CLogMsgLevel[lev], (unsigned long long)counts[k][lev]);
+      sep = ", ";
+    }
+    if ((total[k] != 0) && (pos < end)) pos += snprintf(pos, end - pos, ")");
+    if (pos < end) pos += snprintf(pos, end - pos, ",");
+  }
+  if (pos < end) {
+    pos += snprintf(pos, end - pos, " bytes %llu, truncated %llu, write errors %llu, flushes %llu (p50 <%lluus, p99 <%lluus)",
+                    (unsigned long long)st.bytes, (unsigned long long)st.truncated, (unsigned long long)st.writeErrors,
+                    (unsigned long long)st.flushes, (unsigned long long)LogStats::flushQuantile(&st, 0.5),
+                    (unsigned long long)LogStats::flushQuantile(&st, 0.99));
+  }
+  if ((pos < end) && (st.queueLen != 0)) {
+    pos += snprintf(pos, end - pos, ", queue %llu/%llu, dropped %llu",
+                    (unsigned long long)st.queueDepth, (unsigned long long)st.queueLen, (unsigned long long)st.dropped);
+  }
+  int len = (pos < end) ? pos - msg : (int)sizeof(msg) - 1;
+  writeText(CfgLog::ELogAlways, ownLevel(), msg, len);
+}
+
+void Logger::writeParts(CfgLog::level_e lev, const char *fmt, va_list args) {
+
+  char payload[CfgLog::CMaxLogMsgLen];
+  int len = 0;
+  const char *text = formatPayload(payload, sizeof(payload), &len, fmt, args);
+
+  writeRecord(lev, NULL, text, len);
+}
+
+char *Logger::formatPayload(char *buf, int size, int *len, const char *fmt, va_list args) {
+
+  char *text = buf;
+  va_list again;
+
+  va_copy(again, args);
+  int n = vsnprintf(buf, size, fmt, args);
+  if (n < 0) n = 0;
+  else if (n >= size) {
+    // long msg, format it again into the arena
+    if ((text = arena(EArenaRecord, n + 1)) != NULL) {
+      n = vsnprintf(text, n + 1, fmt, again);
+    } else {
+      text = buf;
+      n = size - 1;
+      m_stats->truncated();
+    }
+  }
+  va_end(again);
+
+  *len = n;
+  return text;
+}
+
+void Logger::writeRecord(CfgLog::level_e lev, const recCtx_t *ctx, const char *payload, int len, bool toOutput,
+                         const LogJson::fields_t *fields) {
+
+  char head[CfgLog::CLogColorLen + CMaxHeaderLen];
+  char tail[CMaxHeaderLen + CfgLog::CLogColorLen];
+  struct iovec iov[3];
+  int cnt = 0;
+  const pattern_t *rendered = NULL;
+
+  // one snapshot for the output and the sinks
+  LogEpoch::guard epoch;
+  const config_t *cfg = m_config.load(std::memory_order_acquire);
+  if (cfg == NULL) return;
+  const pattern_t *pat = cfg->pattern;
+
+  if (toOutput) {
+    if ((cnt = renderParts(pat, lev, ctx, payload, len, fields, head, tail, iov)) > 0) emit(lev, iov, cnt);
+    else m_stats->truncated();
+    rendered = pat;
+  }
+
+  const sinkSet_t *set = cfg->sinks;
+  if (set == NULL) return;
+
+  // sinks sharing a pattern are adjacent, each pattern is rendered once
+  std::lock_guard<std::mutex> lock(m_sinkLock);
+  for (int i = 0; i < set->cnt; i++) {
+    const sinkRef_t *ref = &set->sinks[i];
+    if ((lev != CfgLog::ELogAlways) && (ref->level < lev)) continue;
+
+    const pattern_t *sp = (ref->pattern != NULL) ? ref->pattern : pat;
+    if (sp != rendered) {
+      cnt = renderParts(sp, lev, ctx, payload, len, fields, head, tail, iov);
+      rendered = sp;
+    }
+    if (cnt <= 0) continue;
+
+    size_t n = 0;
+    for (int k = 0; k < cnt; k++) n += iov[k].iov_len;
+    if (ref->sink->writeRecord(lev, iov, cnt) != ENoErr) m_stats->writeError();
+    m_stats->written(n);
+  }
+}
+
+int Logger::renderParts(const pattern_t *pat, CfgLog::level_e lev, const recCtx_t *ctx, const char *payload, int len,
+                        const LogJson::fields_t *fields, char *head, char *tail, struct iovec *iov) {
+
+  int cnt = 0;
+  bool colored = isColored(pat, lev);
+  char *hend = head;
+
+  if (colored) {
+    memcpy(hend, pat->color[lev], pat->colorLen[lev]);
+    hend += pat->colorLen[lev];
+  }
+  hend = renderItems(pat, hend, head + CfgLog::CLogColorLen + CMaxHeaderLen, 0, pat->msgItem, NULL, lev, ctx);
+  char *tend = renderItems(pat, tail, tail + CMaxHeaderLen, pat->msgItem + 1, pat->len, NULL, lev, ctx);
+  if ((hend == NULL) || (tend == NULL)) return 0;
+
+  iov[cnt].iov_base = head;
+  iov[cnt++].iov_len = hend - head;
+
+  if ((pat->msgItem < pat->len) && !pat->json && (fields == NULL)) {
+    iov[cnt].iov_base = (void*)payload;
+    iov[cnt++].iov_len = len;
+  } else if (pat->msgItem < pat->len) {
+    // escaped or extended by fields, the msg is rendered in the arena
+    size_t size = LogJson::maxLen(len, fields);
+    char *msg = arena(EArenaFields, size);
+    char *mend = (msg != NULL) ? addMsg(pat, msg, msg + size, payload, len, fields) : NULL;
+    if (mend == NULL) return 0;
+    iov[cnt].iov_base = msg;
+    iov[cnt++].iov_len = mend - msg;
+  }
+
+  if (colored) {
+    memcpy(tend, CColorReset, CColorResetLen);
+    tend += CColorResetLen;
+  }
+  iov[cnt].iov_base = tail;
+  iov[cnt++].iov_len = tend - tail;
+  return cnt;
+}
+
+bool Logger::suppress(CfgLog::level_e lev, const void *key, const char *payload, int len) {
+
+  LogDedup::summary_t sums[LogDedup::CMaxSummaries];
+  int cnt = 0;
+  uint64_t now = nowMs();
+  bool drop = m_dedup->check(key, lev, payload, len, now, sums, &cnt);
+
+  // summaries go out before the msg that triggered them
+  for (int i = 0; i < cnt; i++) writeText((CfgLog::level_e)sums[i].level, ownLevel(), sums[i].text, sums[i].len);
+  if (m_dedup->expiring(now)) reportRepeats(now);
+  if (drop) m_stats->filtered(lev);
+  return drop;
+}
+
+void Logger::reportRepeats(uint64_t now) {
+
+  LogDedup::summary_t sum;
+  int cursor = 0;
+  while (m_dedup->expire(now, &cursor, &sum)) writeText((CfgLog::level_e)sum.level, ownLevel(), sum.text, sum.len);
+}
+
+void Logger::writeText(CfgLog::level_e lev, int outLevel, const char *payload, int len, const LogJson::fields_t *fields) {
+
+  bool toOutput = outputAccepts(lev, outLevel);
+
+  if ((m_binary == NULL) && (m_queue == NULL)) {
+    writeRecord(lev, NULL, payload, len, toOutput, fields);
+    return;
+  }
+
+  // the output is encoded or queued, the attached sinks are written right away
+  writeRecord(lev, NULL, payload, len, false, fields);
+  if (!toOutput) return;
+
+  if (m_binary != NULL) {
+    writeBinaryf(lev, NULL, "%s", payload);
+    return;
+  }
+
+  LogEpoch::guard epoch;
+  const config_t *cfg = m_config.load(std::memory_order_acquire);
+  if (cfg == NULL) return;
+  const pattern_t *pat = cfg->pattern;
+
+  size_t msgLen = (pat->json || (fields != NULL)) ? LogJson::maxLen(len, fields) : len;
+  size_t size = msgLen + CMaxHeaderLen + 2 * CfgLog::CLogColorLen;
+  if (size > (size_t)LogQueue::CMaxRecordLen) {
+    // too long for a queue slot, render it in the arena and split it over several
+    char *line = arena(EArenaMsg, size);
+    int n = (line != NULL) ? renderLine(pat, line, size, payload, len, fields, lev) : -1;
+    if (n >= 0) enqueueRaw(lev, line, n, true);
+    else m_stats->truncated();
+    return;
+  }
+
+  // render the line straight into the queue slot
+  size_t qpos = 0;
+  LogQueue::record_t *rec = reserveSlot(lev, &qpos, true);
+  if (rec == NULL) return;
+
+  int n = renderLine(pat, rec->msg, sizeof(rec->msg), payload, len, fields, lev);
+  if (n < 0) m_stats->truncated();
+  commitSlot(rec, qpos, lev, (n < 0) ? 0 : n);
+}
+
+int Logger::renderLine(const pattern_t *pat, char *buf, size_t size, const char *payload, int len,
+                       const LogJson::fields_t *fields, CfgLog::level_e lev, const recCtx_t *ctx) {
+
+  bool colored = isColored(pat, lev);
+  char *pos = buf;
+  const char *end = buf + size - (colored ? CColorResetLen : 0);
+
+  if (colored) {
+    if (pat->colorLen[lev] > end - pos) return -1;
+    memcpy(pos, pat->color[lev], pat->colorLen[lev]);
+    pos += pat->colorLen[lev];
+  }
+  pos = renderItems(pat, pos, end, 0, pat->msgItem, NULL, lev, ctx);
+  if ((pos != NULL) && (pat->msgItem < pat->len)) pos = addMsg(pat, pos, end, payload, len, fields);
+  if (pos != NULL) pos = renderItems(pat, pos, end, pat->msgItem + 1, pat->len, NULL, lev, ctx);
+  if (pos == NULL) return -1;
+  if (colored) {
+    memcpy(pos, CColorReset, CColorResetLen);
+    pos += CColorResetLen;
+  }
+  return pos - buf;
+}
+
+char *Logger::addMsg(const pattern_t *pat, char *pos, const char *end, const char *payload, int len,
+                     const LogJson::fields_t *fields) {
+
+  if (pat->json) return LogJson::json(pos, end, payload, len, fields);
+  if (fields != NULL) return LogJson::text(pos, end, payload, len, fields);
+  return addLiteral(pos, end, payload, len);
+}
+
+thread_local Logger::arena_t Logger::s_arena = { { NULL }, { 0 } };
+
+Logger::arenaBuffers::~arenaBuffers() {
+  for (int i = 0; i < EArenaCnt; i++) free(buf[i]);
+}
+
+char *Logger::arena(int which, size_t len) {
+
+  arena_t *a = &s_arena;
+
+  if (len > a->size[which]) {
+    size_t size = (a->size[which] > 0) ? a->size[which] : CfgLog::CMaxLogMsgLen;
+    while (size < len) size *= 2;
+    char *buf = (char*)realloc(a->buf[which], size);
+    if (buf == NULL) return NULL;
+    a->buf[which]  = buf;
+    a->size[which] = size;
+  }
+  return a->buf[which];
+}
+
+void Logger::writeBinaryf(CfgLog::level_e lev, const recCtx_t *ctx, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  writeBinary(lev, ctx, fmt, args);
+  va_end(args);
+}
+
+void Logger::writeBinary(CfgLog::level_e lev, const recCtx_t *ctx, const char *fmt, va_list args) {
+
+  char stack[LogQueue::CMaxRecordLen];
+  char dict[LogBinary::CMaxFormatRecLen];
+  int  dictLen = sizeof(dict);
+  struct timespec ts;
+  bool cut = false;
+  long tid = (ctx == NULL) ? currentTid() : ctx->tid;
+
+  if (ctx == NULL) LogTime::now(LogTime::ETimeEpochNs, &ts);
+  else ts = ctx->real;
+
+  va_list again;
+  va_copy(again, args);
+  char *rec = stack;
+  char *buf;
+  int size = sizeof(stack);
+  int len = m_binary->encode(rec, size, dict, &dictLen, lev, tid, &ts, fmt, args, &cut);
+
+  // arguments may have been cut, retry in the arena until they fit, the format is registered by now
+  while (cut && (size < LogBinary::CMaxLogRecLen) && ((buf = arena(EArenaMsg, size * 2)) != NULL)) {
+    int none = 0;
+    va_list retry;
+    va_copy(retry, again);
+    rec = buf;
+    size *= 2;
+    len = m_binary->encode(rec, size, NULL, &none, lev, tid, &ts, fmt, retry, &cut);
+    va_end(retry);
+  }
+  va_end(again);
+  if (cut) m_stats->truncated();
+
+  // a new format string goes out before its first record and is never dropped
+  if (m_queue != NULL) {
+    if (dictLen > 0) enqueueRaw(CfgLog::ELogAlways, dict, dictLen, false);
+    enqueueRaw(lev, rec, len, true);
+    return;
+  }
+
+  struct iovec iov;
+  if (dictLen > 0) {
+    iov.iov_base = dict;
+    iov.iov_len  = dictLen;
+    emit(CfgLog::ELogAlways, &iov, 1);
+  }
+  iov.iov_base = rec;
+  iov.iov_len  = len;
+  emit(lev, &iov, 1);
+}
+
+void Logger::emit(CfgLog::level_e lev, const struct iovec *iov, int cnt) {
+
+  // the memory mapped sink takes concurrent writers itself, unless rotation may swap it
+  if ((m_cfg->backend == CfgLog::EBackendMmap) && !m_rotate) {
+    (void)writeOutput(iov, cnt);
+    if (flushDue(lev)) flushOutput();
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(m_emitLock);
+  size_t written = writeOutput(iov, cnt);
+  if (flushDue(lev)) flushOutput();
+  rotateCheck(written);
+}
+
+size_t Logger::writeOutput(const struct iovec *iov, int cnt) {
+
+  size_t len = 0;
+  for (int i = 0; i < cnt; i++) len += iov[i].iov_len;
+
+  if (m_sink != NULL) {
+    if (m_sink->write(iov, cnt) != ENoErr) m_stats->writeError();
+  } else {
+    size_t n = 0;
+    for (int i = 0; i < cnt; i++) {
+      n += fwrite(iov[i].iov_base, 1, iov[i].iov_len, m_fd);
+    }
+    if (n < len) m_stats->writeError();
+  }
+  m_stats->written(len);
+  return len;
+}
+
+void Logger::enqueueParts(CfgLog::level_e lev, const char *fmt, va_list args) {
+
+  LogEpoch::guard epoch;
+  const config_t *cfg = m_config.load(std::memory_order_acquire);
+  if (cfg == NULL) return;
+  const pattern_t *pat = cfg->pattern;
+
+  if (pat->json) {
+    // the payload is escaped, it cannot be formatted into the slot
+    char payload[CfgLog::CMaxLogMsgLen];
+    int len = 0;
+    const char *text = formatPayload(payload, sizeof(payload), &len, fmt, args);
+    // only records taken by the output get here
+    writeText(lev, lev, text, len);
+    return;
+  }
+
+  size_t qpos = 0;
+  LogQueue::record_t *rec = reserveSlot(lev, &qpos, true);
+  if (rec == NULL) return;
+
+  va_list again;
+  va_copy(again, args);
+
+  // pattern items, payload and escapes are each written once, straight into the slot
+  bool colored = isColored(pat, lev);
+  char *pos = rec->msg;
+  char *end = rec->msg + sizeof(rec->msg) - (colored ? CColorResetLen : 0);
+
+  if (colored) {
+    memcpy(pos, pat->color[lev], pat->colorLen[lev]);
+    pos += pat->colorLen[lev];
+  }
+  pos = renderItems(pat, pos, end, 0, pat->msgItem, NULL, lev, NULL);
+  if ((pos != NULL) && (pat->msgItem < pat->len)) {
+    int n = vsnprintf(pos, end - pos, fmt, args);
+    pos = ((n >= 0) && (n < end - pos)) ? pos + n : NULL;
+  }
+  if (pos != NULL) pos = renderItems(pat, pos, end, pat->msgItem + 1, pat->len, NULL, lev, NULL);
+
+  if (pos != NULL) {
+    if (colored) {
+      memcpy(pos, CColorReset, CColorResetLen);
+      pos += CColorResetLen;
+    }
+    commitSlot(rec, qpos, lev, pos - rec->msg);
+  } else {
+    // too long for the slot: hand it back empty and queue the record in as many slots as it needs
+    char payload[CfgLog::CMaxLogMsgLen];
+    int len = 0;
+    commitSlot(rec, qpos, lev, 0);
+    const char *text = formatPayload(payload, sizeof(payload), &len, fmt, again);
+    writeText(lev, lev, text, len);
+  }
+  va_end(again);
+}
+
+void Logger::enqueueRaw(CfgLog::level_e lev, const char *buf, int len, bool mayDrop) {
+
+  size_t pos = 0;
+  size_t cnt = (len + LogQueue::CMaxRecordLen - 1) / LogQueue::CMaxRecordLen;
+  size_t maxCnt = m_queue->capacity() / 2;
+
+  if (cnt == 0) cnt = 1;
+  if (cnt > maxCnt) {
+    cnt = maxCnt;
+    len = cnt * LogQueue::CMaxRecordLen;
+    m_stats->truncated();
+  }
+
+  if (reserveSlot(lev, &pos, mayDrop, cnt) == NULL) return;
+
+  for (size_t i = 0; i < cnt; i++) {
+    LogQueue::record_t *rec = m_queue->at(pos + i);
+    int n = (len > LogQueue::CMaxRecordLen) ? LogQueue::CMaxRecordLen : len;
+    memcpy(rec->msg, buf, n);
+    commitSlot(rec, pos + i, lev, n);
+    buf += n;
+    len -= n;
+  }
+}
+
+LogQueue::record_t *Logger::reserveSlot(CfgLog::level_e lev, size_t *pos, bool mayDrop, size_t cnt) {
+
+  LogQueue::record_t *rec = NULL;
+
+  if (mayDrop && m_cfg->asyncPolicy == CfgLog::EAsyncDropLowest &&
+      lev > CfgLog::ELogError && lev != CfgLog::ELogAlways) {
+    // warnings need 1/8 of the queue free, notices 2/8, infos 3/8 and debug msgs 4/8
+    if (m_queue->space() * 8 < m_queue->capacity() * (lev - CfgLog::ELogError)) {
+      m_dropped++;
+      return NULL;
+    }
+  }
+
+  while ((rec = m_queue->reserve(pos, cnt)) == NULL) {
+    if (mayDrop && m_cfg->asyncPolicy == CfgLog::EAsyncDrop) {
+      m_dropped++;
+      return NULL;
+    }
+    if (m_writerIdle.exchange(false)) m_wakeWriter.notify_one();
+    std::this_thread::yield();
+  }
+  return rec;
+}
+
+void Logger::commitSlot(LogQueue::record_t *rec, size_t pos, CfgLog::level_e lev, int len) {
+
+  rec->len = len;
+  rec->level = lev;
+  m_queue->commit(rec, pos);
+
+  if (m_writerIdle.load(std::memory_order_relaxed) && m_writerIdle.exchange(false)) {
+    m_wakeWriter.notify_one();
+  }
 }
 
 int Logger::initProfile(CfgLog::profile_e profile) {
@@ -125,176 +1250,238 @@ int Logger::initProfile(CfgLog::profile_e profile) {
 
 int Logger::initStandardProfile(CfgLog::profile_e profile) {
 
-  if (!initPattern(default_patterns[(int)m_cfg->profile])) {
+  const stdProfile_t *std = findStdProfile(m_cfg->profile);
+  if (std == NULL) {
+    fprintf(stderr, "Unknown profile %d, reverting to default\n", (int)m_cfg->profile);
+    m_cfg->profile = CfgLog::CLogProfileDefault;
+    std = findStdProfile(m_cfg->profile);
+  }
+
+  // the level case is compiled into the pattern
+  m_cfg->logLevelCase = std->levelCase;
+
+  if (initPattern(std->pattern) != ENoErr) {
     fprintf(stderr, "Failed to initialize standard profile.\n");
     return EErr;
   } else {
-    PRINT_DEBUG("Setting pattern: %s\n", default_patterns[(int)m_cfg->profile]);
-    strncpy(m_cfg->pattern, default_patterns[(int)m_cfg->profile], sizeof(m_cfg->pattern));
-    m_cfg->logLevelCase = default_level_cases[(int)m_cfg->profile];
+    PRINT_DEBUG("Setting pattern: %s\n", std->pattern);
+    strncpy(m_cfg->pattern, std->pattern, sizeof(m_cfg->pattern));
   }
   return ENoErr;
 }
 
 void Logger::emergency(const char *fmt, ...) {
-
-  char msg[CfgLog::CMaxLogMsgLen + CfgLog::CLogColorLen] = {0};
   va_list args;
-
-  if (m_fd == NULL) return;
-  // emergencies are always logged, regardless of log level
-
-  constructMsg(msg, fmt, CfgLog::ELogEmergency);
-
-  if (m_cfg->useColor) {
-    char buf[CfgLog::CMaxLogMsgLen];
-    strcpy(buf, msg);
-    sprintf(msg, "\033[%dm%s\033[0m", m_cfg->color, buf);
-  }
-
   va_start(args, fmt);
-  LOG(msg, args);
+  logv(CfgLog::ELogEmergency, fmt, args);
   va_end(args);
 }
 
 void Logger::alert(const char *fmt, ...) {
-
-  char msg[CfgLog::CMaxLogMsgLen + CfgLog::CLogColorLen] = {0};
   va_list args;
-
-  if (m_fd == NULL) return;
-  if (m_cfg->logLevel < CfgLog::ELogAlert) return;
-
-  constructMsg(msg, fmt, CfgLog::ELogAlert);
-
-  if (m_cfg->useColor) {
-    char buf[CfgLog::CMaxLogMsgLen];
-    strcpy(buf, msg);
-    sprintf(msg, "\033[%dm%s\033[0m", m_cfg->color, buf);
-  }
-
   va_start(args, fmt);
-  LOG(msg, args);
+  logv(CfgLog::ELogAlert, fmt, args);
   va_end(args);
 }
 
 void Logger::critical(const char *fmt, ...) {
-
-  char msg[CfgLog::CMaxLogMsgLen + CfgLog::CLogColorLen] = {0};
   va_list args;
-
-  if (m_fd == NULL) return;
-  if (m_cfg->logLevel < CfgLog::ELogCritical) return;
-
-  constructMsg(msg, fmt, CfgLog::ELogCritical);
-
-  if (m_cfg->useColor) {
-    char buf[CfgLog::CMaxLogMsgLen];
-    strcpy(buf, msg);
-    sprintf(msg, "\033[%dm%s\033[0m", m_cfg->color, buf);
-  }
-
   va_start(args, fmt);
-  LOG(msg, args);
+  logv(CfgLog::ELogCritical, fmt, args);
   va_end(args);
 }
 
 void Logger::error(const char *fmt, ...) {
-
-  char msg[CfgLog::CMaxLogMsgLen + CfgLog::CLogColorLen] = {0};
   va_list args;
-
-  if (m_fd == NULL) return;
-  if (m_cfg->logLevel < CfgLog::ELogError) return;
-
-  constructMsg(msg, fmt, CfgLog::ELogError);
-
-  if (m_cfg->useColor) {
-    char buf[CfgLog::CMaxLogMsgLen];
-    strcpy(buf, msg);
-    sprintf(msg, "\033[%dm%s\033[0m", m_cfg->color, buf);
-  }
-
   va_start(args, fmt);
-  LOG(msg, args);
+  logv(CfgLog::ELogError, fmt, args);
   va_end(args);
 }
 
 void Logger::warning(const char *fmt, ...) {
-
-  char msg[CfgLog::CMaxLogMsgLen]       = {0};
   va_list args;
-
-  if (m_fd == NULL) return;
-  if (m_cfg->logLevel < CfgLog::ELogWarn) return;
-
-  constructMsg(msg, fmt, CfgLog::ELogWarn);
   va_start(args, fmt);
-  LOG(msg, args);
+  logv(CfgLog::ELogWarn, fmt, args);
   va_end(args);
 }
 
 void Logger::notice(const char *fmt, ...) {
-
-  char msg[CfgLog::CMaxLogMsgLen]       = {0};
   va_list args;
-
-  if (m_fd == NULL) return;
-  if (m_cfg->logLevel < CfgLog::ELogNotice) return;
-
-  constructMsg(msg, fmt, CfgLog::ELogNotice);
   va_start(args, fmt);
-  LOG(msg, args);
+  logv(CfgLog::ELogNotice, fmt, args);
   va_end(args);
 }
 
 void Logger::info(const char *fmt, ...) {
-
-  char msg[CfgLog::CMaxLogMsgLen]       = {0};
   va_list args;
-
-  if (m_fd == NULL) return;
-  if (m_cfg->logLevel < CfgLog::ELogInfo) return;
-
-  constructMsg(msg, fmt, CfgLog::ELogInfo);
   va_start(args, fmt);
-  LOG(msg, args);
+  logv(CfgLog::ELogInfo, fmt, args);
   va_end(args);
 }
 
 void Logger::debug(const char *fmt, ...) {
-
-  char msg[CfgLog::CMaxLogMsgLen]       = {0};
   va_list args;
-
-  if (m_fd == NULL) return;
-  if (m_cfg->logLevel < CfgLog::ELogDebug) return;
-
-  constructMsg(msg, fmt, CfgLog::ELogDebug);
   va_start(args, fmt);
-  LOG(msg, args);
+  logv(CfgLog::ELogDebug, fmt, args);
   va_end(args);
 }
 
 void Logger::always(const char *fmt, ...) {
-
-  char msg[CfgLog::CMaxLogMsgLen]       = {0};
   va_list args;
-
-  if (m_fd == NULL) return;
-
-  constructMsg(msg, fmt, CfgLog::ELogAlways);
   va_start(args, fmt);
-  LOG(msg, args);
+  logv(CfgLog::ELogAlways, fmt, args);
   va_end(args);
 }
 
+void Logger::logv(CfgLog::level_e lev, const char *fmt, va_list args) {
+
+  // emergency and always msgs are logged regardless of log level
+  if (!isEnabled(lev)) {
+    m_stats->filtered(lev);
+    return;
+  }
+  logvAs(lev, ownLevel(), fmt, args);
+}
+
+void Logger::logvAs(CfgLog::level_e lev, int outLevel, const char *fmt, va_list args) {
+
+  if ((m_recLevel.load(std::memory_order_relaxed) >= 0) && recorderCheck(lev, outLevel)) {
+    LogRecorder::record(this, lev, fmt, args);
+    return;
+  }
+
+  if ((m_dedup != NULL) || sinksAccept(lev)) {
+    // the payload is formatted once, for the duplicate filter and all outputs
+    char payload[CfgLog::CMaxLogMsgLen];
+    int len = 0;
+    va_list copy;
+
+    va_copy(copy, args);
+    const char *text = formatPayload(payload, sizeof(payload), &len, fmt, copy);
+    va_end(copy);
+    if ((m_dedup != NULL) && suppress(lev, fmt, text, len)) return;
+    m_stats->emitted(lev);
+
+    if ((m_binary != NULL) && outputAccepts(lev, outLevel)) {
+      writeBinary(lev, NULL, fmt, args);
+      writeRecord(lev, NULL, text, len, false);
+      return;
+    }
+    writeText(lev, outLevel, text, len);
+    return;
+  }
+
+  m_stats->emitted(lev);
+  if (m_binary != NULL) {
+    writeBinary(lev, NULL, fmt, args);
+    return;
+  }
+
+  if (m_queue == NULL) {
+    writeParts(lev, fmt, args);
+    return;
+  }
+
+  enqueueParts(lev, fmt, args);
+}
+
+void Logger::logKv(CfgLog::level_e lev, const char *msg, std::initializer_list<LogJson::field_t> list) {
+
+  if (!isEnabled(lev)) {
+    m_stats->filtered(lev);
+    return;
+  }
+  logKvAs(lev, ownLevel(), msg, list);
+}
+
+void Logger::logKvAs(CfgLog::level_e lev, int outLevel, const char *msg, std::initializer_list<LogJson::field_t> list) {
+
+  LogJson::fields_t fields = { list.begin(), (int)list.size() };
+  int len = strlen(msg);
+  bool recordOnly = (m_recLevel.load(std::memory_order_relaxed) >= 0) && recorderCheck(lev, outLevel);
+
+  if (recordOnly || (m_dedup != NULL) || (m_binary != NULL)) {
+    // the recorder, the duplicate filter and binary logfiles take the fields as key=value text
+    char payload[CfgLog::CMaxLogMsgLen];
+    char *text = payload;
+    size_t size = sizeof(payload);
+    char *end = LogJson::text(text, text + size - 1, msg, len, &fields);
+    if (end == NULL) {
+      size = LogJson::maxLen(len, &fields) + 1;
+      text = arena(EArenaRecord, size);
+      end = (text != NULL) ? LogJson::text(text, text + size - 1, msg, len, &fields) : NULL;
+    }
+    if (end == NULL) {
+      // keep what fits of the msg alone
+      int cut = (len < (int)sizeof(payload)) ? len : (int)sizeof(payload) - 1;
+      text = payload;
+      end = LogJson::text(text, text + cut, msg, cut, NULL);
+      m_stats->truncated();
+    }
+    *end = '\0';
+
+    if (recordOnly) {
+      recordText(lev, text);
+      return;
+    }
+    if ((m_dedup != NULL) && suppress(lev, msg, text, end - text)) return;
+    m_stats->emitted(lev);
+
+    if ((m_binary != NULL) && outputAccepts(lev, outLevel)) {
+      writeBinaryf(lev, NULL, "%s", text);
+      writeRecord(lev, NULL, msg, len, false, &fields);
+      return;
+    }
+    writeText(lev, outLevel, msg, len, &fields);
+    return;
+  }
+
+  m_stats->emitted(lev);
+  writeText(lev, outLevel, msg, len, &fields);
+}
+
+int Logger::reload(const CfgLog *cfg) {
+
+  if (cfg == NULL) return EErr;
+
+  std::lock_guard<std::mutex> lock(m_cfgLock);
+  if (cfg != m_cfg) {
+    m_cfg->logLevel      = cfg->logLevel;
+    m_cfg->profile       = cfg->profile;
+    m_cfg->useUsrPattern = cfg->useUsrPattern;
+    m_cfg->useColor      = cfg->useColor;
+    m_cfg->color         = cfg->color;
+    m_cfg->colorAlways   = cfg->colorAlways;
+    m_cfg->logLevelCase  = cfg->logLevelCase;
+    memcpy(m_cfg->levelColor, cfg->levelColor, sizeof(m_cfg->levelColor));
+    strncpy(m_cfg->pattern, cfg->pattern, sizeof(m_cfg->pattern));
+    strncpy(m_cfg->prefix, cfg->prefix, sizeof(m_cfg->prefix));
+    strncpy(m_cfg->postfix, cfg->postfix, sizeof(m_cfg->postfix));
+    strncpy(m_cfg->separator, cfg->separator, sizeof(m_cfg->separator));
+    // the children are told before the old module levels are gone
+    m_level = m_cfg->logLevel;
+    applyModuleLevels(m_cfg, cfg);
+    m_cfg->copyLists(cfg);
+  } else {
+    m_level = m_cfg->logLevel;
+    applyModuleLevels(NULL, m_cfg);
+  }
+
+  // logging threads switch over with the next snapshot
+  CfgLog::profile_e profile = m_cfg->profile;
+  initProfile(profile);
+  return (m_cfg->profile == profile) ? ENoErr : EErr;
+}
+
 CfgLog::level_e Logger::getLevel() {
-  return m_cfg->logLevel;
+  return (CfgLog::level_e)m_level.load();
 }
 
 void Logger::setLevel(CfgLog::level_e level) {
+  std::lock_guard<std::mutex> lock(m_cfgLock);
   m_cfg->logLevel = level;
+  m_level = level;
+  updateEnabled();
 }
 
 CfgLog::profile_e Logger::getProfile() {
@@ -302,6 +1489,7 @@ CfgLog::profile_e Logger::getProfile() {
 }
 
 void Logger::setProfile(CfgLog::profile_e profile) {
+  std::lock_guard<std::mutex> lock(m_cfgLock);
   m_cfg->profile = profile;
   initProfile(m_cfg->profile);
 }
@@ -311,6 +1499,7 @@ char *Logger::getPattern(void) {
 }
 
 int Logger::setPattern(const char *pattern) {
+  std::lock_guard<std::mutex> lock(m_cfgLock);
   if (initPattern(pattern) == ENoErr) {
   	strncpy(m_cfg->pattern, pattern, sizeof(m_cfg->pattern));
     return ENoErr;
@@ -320,55 +1509,325 @@ int Logger::setPattern(const char *pattern) {
   }
 }
 
+void Logger::reportSuppressed(CfgLog::level_e lev, const char *file, int line, uint32_t cnt) {
+
+  if (isEnabled(lev)) writeSuppressed(lev, ownLevel(), file, line, cnt);
+}
+
+void Logger::listSuppressed(LogLimit::site_t *site, CfgLog::level_e lev, const char *file, int line, LogChild *child) {
+
+  // only the thread setting the flag fills in the site, the report clears it again
+  if (site->listed.exchange(true, std::memory_order_acquire)) return;
+  site->file  = file;
+  site->line  = line;
+  site->level = lev;
+  site->child = child;
+
+  LogLimit::site_t *top = m_suppressed.load(std::memory_order_relaxed);
+  do {
+    site->next = top;
+  } while (!m_suppressed.compare_exchange_weak(top, site, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void Logger::reportListed(void) {
+
+  LogLimit::site_t *site = m_suppressed.exchange(NULL, std::memory_order_acquire);
+  while (site != NULL) {
+    LogLimit::site_t *next  = site->next;
+    const char       *file  = site->file;
+    int               line  = site->line;
+    CfgLog::level_e   lev   = (CfgLog::level_e)site->level;
+    LogChild         *child = site->child;
+
+    // calls suppressed from now on list the site again
+    site->listed.store(false, std::memory_order_release);
+    uint32_t cnt = site->dropped.exchange(0, std::memory_order_relaxed);
+    if (cnt != 0) {
+      if (child != NULL) child->reportSuppressed(lev, file, line, cnt);
+      else reportSuppressed(lev, file, line, cnt);
+    }
+    site = next;
+  }
+}
+
+void Logger::writeSuppressed(CfgLog::level_e lev, int outLevel, const char *file, int line, uint32_t cnt) {
+
+  const char *base = strrchr(file, '/');
+  char msg[CfgLog::CMaxLogMsgLen];
+  int len = snprintf(msg, sizeof(msg), "suppressed %u lines at %s:%d", cnt, (base != NULL) ? base + 1 : file, line);
+  if (len >= (int)sizeof(msg)) len = sizeof(msg) - 1;
+  writeText(lev, outLevel, msg, len);
+}
+
+int Logger::addSink(LogSink *sink, CfgLog::level_e level, const char *pattern) {
+
+  std::lock_guard<std::mutex> lock(m_cfgLock);
+  config_t *cfg = m_config.load(std::memory_order_acquire);
+  sinkSet_t *cur = (cfg != NULL) ? cfg->sinks : NULL;
+
+  if ((sink == NULL) || ((cur != NULL) && (cur->cnt >= CMaxSinks))) return EErr;
+
+  sinkRef_t ref;
+  ref.sink    = sink;
+  ref.level   = level;
+  ref.pattern = NULL;
+  memset(ref.patStr, 0, sizeof(ref.patStr));
+
+  // sinks with the same pattern share the compiled pattern and sit next to each other
+  int at = (cur != NULL) ? cur->cnt : 0;
+  if (pattern != NULL) {
+    strncpy(ref.patStr, pattern, sizeof(ref.patStr) - 1);
+    for (int i = 0; (cur != NULL) && (i < cur->cnt); i++) {
+      if ((cur->sinks[i].pattern != NULL) && (strcmp(cur->sinks[i].patStr, ref.patStr) == 0)) {
+        ref.pattern = cur->sinks[i].pattern;
+        at = i + 1;
+      }
+    }
+    if ((ref.pattern == NULL) && ((ref.pattern = compilePattern(ref.patStr, false)) == NULL)) {
+      fprintf(stderr, "Failed to apply sink pattern: %s\n", pattern);
+      return EErr;
+    }
+  } else {
+    for (at = 0; (cur != NULL) && (at < cur->cnt) && (cur->sinks[at].pattern == NULL); at++);
+  }
+
+  // publish a new set, logging threads may still walk the current one
+  sinkSet_t *set = new sinkSet_t;
+  set->cnt = 0;
+  set->level = CfgLog::ELogEmergency;
+  for (int i = 0; i <= ((cur != NULL) ? cur->cnt : 0); i++) {
+    const sinkRef_t *r = (i == at) ? &ref : &cur->sinks[(i < at) ? i : i - 1];
+    set->sinks[set->cnt++] = *r;
+    if (r->level > set->level) set->level = r->level;
+  }
+  publish((cfg != NULL) ? cfg->pattern : NULL, set);
+
+  updateEnabled();
+
+  // a timer without duties sleeps until it is woken, from now on it ticks the sinks
+  {
+    std::lock_guard<std::mutex> timer(m_timerLock);
+    m_wakeTimer.notify_one();
+  }
+  return ENoErr;
+}
+
+void Logger::updateEnabled(void) {
+  int floor = extraLevel();
+  m_enabled = (m_level > floor) ? m_level.load() : floor;
+
+  // children follow the output level unless they have an override
+  for (LogChild *c = m_children; c != NULL; c = c->m_next) c->resolve(m_level, floor);
+}
+
+int Logger::extraLevel(void) {
+  int level = m_recLevel;
+  if (m_sinkLevel > level) level = m_sinkLevel;
+  return level;
+}
+
+LogChild *Logger::getChild(const char *name) {
+
+  if ((name == NULL) || (*name == '\0')) return NULL;
+
+  std::lock_guard<std::mutex> lock(m_cfgLock);
+  return addChild(name);
+}
+
+LogChild *Logger::addChild(const char *name) {
+
+  if ((name == NULL) || (*name == '\0')) return NULL;
+
+  LogChild *parent = NULL;
+  LogChild *child = NULL;
+  const char *part = name;
+
+  while (true) {
+    const char *dot = strchr(part, '.');
+    size_t len = (dot != NULL) ? (size_t)(dot - part) : strlen(part);
+    if (len == 0) return NULL;
+
+    LogChild **head = (parent != NULL) ? &parent->m_first : &m_children;
+    if ((child = LogChild::find(*head, part, len)) == NULL) {
+      // a new child inherits everything, it is complete before it is linked
+      child = new LogChild(this, parent, name, part + len - name);
+      child->m_next = *head;
+      *head = child;
+    }
+    if (dot == NULL) return child;
+    parent = child;
+    part = dot + 1;
+  }
+}
+
+void Logger::applyModuleLevels(const CfgLog *prev, const CfgLog *next) {
+
+  CfgLog::level_e level;
+  LogChild *child;
+  const char *name;
+
+  // only the resolved levels are read by logging threads, they change once in updateEnabled()
+  for (int i = 0; (prev != NULL) && ((name = prev->getModuleLevel(i, &level)) != NULL); i++) {
+    if ((child = addChild(name)) != NULL) child->m_level = -1;
+  }
+  for (int i = 0; (name = next->getModuleLevel(i, &level)) != NULL; i++) {
+    if ((child = addChild(name)) != NULL) child->m_level = level;
+  }
+  updateEnabled();
+}
+
+int Logger::dumpRecorder(void) {
+  return (m_recLevel >= 0) ? LogRecorder::dump(this) : 0;
+}
+
+bool Logger::recorderCheck(CfgLog::level_e lev, int outLevel) {
+
+  // the lines leading up to the emergency go out first
+  if (lev <= CfgLog::ELogAlert) (void)dumpRecorder();
+  bool recordOnly = !outputAccepts(lev, outLevel) && !sinksAccept(lev) && (m_recLevel.load(std::memory_order_relaxed) >= lev);
+  if (recordOnly) m_stats->filtered(lev);
+  return recordOnly;
+}
+
+void Logger::recordText(CfgLog::level_e lev, const char *text) {
+  LogRecorder::recordf(this, lev, "%s", text);
+}
+
+void Logger::replayRecord(CfgLog::level_e lev, const recCtx_t *ctx, const char *payload, int len) {
+
+  if ((m_binary == NULL) && (m_queue == NULL)) {
+    writeRecord(lev, ctx, payload, len);
+    return;
+  }
+  writeRecord(lev, ctx, payload, len, false);
+
+  // binary logfiles keep the record as text with its original time and thread
+  if (m_binary != NULL) {
+    writeBinaryf(lev, ctx, "%s", payload);
+    return;
+  }
+
+  // the writer thread owns the output, the record is queued behind the ones before it
+  LogEpoch::guard epoch;
+  const config_t *cfg = m_config.load(std::memory_order_acquire);
+  if (cfg == NULL) return;
+  const pattern_t *pat = cfg->pattern;
+
+  size_t size = (pat->json ? LogJson::maxLen(len, NULL) : len) + CMaxHeaderLen + 2 * CfgLog::CLogColorLen;
+  char *line = arena(EArenaMsg, size);
+  int n = (line != NULL) ? renderLine(pat, line, size, payload, len, NULL, lev, ctx) : -1;
+  if (n >= 0) enqueueRaw(lev, line, n, false);
+  else m_stats->truncated();
+}
+
+void Logger::publish(pattern_t *pat, sinkSet_t *set) {
+
+  config_t *cfg = new config_t;
+  cfg->pattern = pat;
+  cfg->sinks = set;
+  config_t *old = m_config.exchange(cfg, std::memory_order_acq_rel);
+  m_sinkLevel = (set != NULL) ? set->level : -1;
+  if (old == NULL) return;
+
+  // other threads may still render with the replaced parts, the compiled sink patterns stay with the sinks
+  if (old->pattern != pat) LogEpoch::retire(old->pattern, [](void *p) { delete (pattern_t*)p; });
+  if (old->sinks != set) LogEpoch::retire(old->sinks, [](void *p) { delete (sinkSet_t*)p; });
+  LogEpoch::retire(old, [](void *p) { delete (config_t*)p; });
+  (void)LogEpoch::reclaim();
+}
+
+void Logger::freeConfig(void) {
+
+  config_t *cfg = m_config.exchange(NULL);
+  if (cfg == NULL) return;
+
+  // the newest set holds every sink and every compiled pattern, sharing ones adjacently
+  sinkSet_t *set = cfg->sinks;
+  for (int i = 0; (set != NULL) && (i < set->cnt); i++) {
+    (void)set->sinks[i].sink->flush();
+    delete set->sinks[i].sink;
+    if ((set->sinks[i].pattern != NULL) && ((i == 0) || (set->sinks[i - 1].pattern != set->sinks[i].pattern))) {
+      delete set->sinks[i].pattern;
+    }
+  }
+  delete set;
+  delete cfg->pattern;
+  delete cfg;
+  m_sinkLevel = -1;
+  (void)LogEpoch::reclaim();
+}
+
 /// @todo change to accept aribitraty length patterns (e.g. us42)
-int Logger::initPattern(const char *pattern) {
+Logger::pattern_t *Logger::compilePattern(const char *pattern, bool tty) {
 
   char tmp[5] = {0};
   int  patLen = strlen(pattern);
 
   if (strstr(pattern, "&") == NULL) {
     PRINT_DEBUG("Invalid pattern string\n");
-    return EErr;
+    return NULL;
   }
 
-  // reset pattern array
-  for (int i = 0; i < CfgLog::CMaxPatternItems; i++) {
-    m_pattern[i] = EPatInvalid;
-  }
+  // compile into a fresh pattern, the current one may be in use
+  pattern_t *pat = new pattern_t;
+  pat->len = 0;
+  pat->msgItem = CfgLog::CMaxPatternItems;
+  pat->json = false;
+  initLevelStrings(pat);
+  initColors(pat, tty);
 
   PRINT_DEBUG("Using pattern: %s\n", pattern);
-  for (int i = 0, j = 0; i < patLen; i++, j++) {
+  for (int i = 0; i < patLen; i++) {
 
     if (pattern[i] == '&' && (i < (patLen - 2))) {
 
+      int ret = ENoErr;
       sprintf(tmp, "%3.3s", &pattern[++i]);
       PRINT_DEBUG("got pattern identifier: %s\n", tmp);
 
       if (strncmp(tmp, "tim", 3) == 0) {
-        m_pattern[j] = EPatTime;
+        ret = compileItem(pat, EPatTime, NULL);
+      } else if (strncmp(tmp, "tus", 3) == 0) {
+        ret = compileItem(pat, EPatTimeUs, NULL);
+      } else if (strncmp(tmp, "iso", 3) == 0) {
+        ret = compileItem(pat, EPatTimeIso, NULL);
+      } else if (strncmp(tmp, "ens", 3) == 0) {
+        ret = compileItem(pat, EPatTimeEpoch, NULL);
+      } else if (strncmp(tmp, "mon", 3) == 0) {
+        ret = compileItem(pat, EPatTimeMono, NULL);
       } else if (strncmp(tmp, "lev", 3) == 0) {
-        m_pattern[j] = EPatLevel;
+        ret = compileItem(pat, EPatLevel, NULL);
       } else if (strncmp(tmp, "sep", 3) == 0) {
-        m_pattern[j] = EPatSeparator;
+        ret = compileItem(pat, EPatLiteral, m_cfg->separator);
       } else if (strncmp(tmp, "pid", 3) == 0) {
-        m_pattern[j] = EPatPID;
+        ret = compileItem(pat, EPatPID, NULL);
+      } else if (strncmp(tmp, "tid", 3) == 0) {
+        ret = compileItem(pat, EPatTID, NULL);
       } else if (strncmp(tmp, "msg", 3) == 0) {
-        m_pattern[j] = EPatMsg;
+        if (pat->msgItem > pat->len) pat->msgItem = pat->len;
+        ret = compileItem(pat, EPatMsg, NULL);
+      } else if (strncmp(tmp, "jsn", 3) == 0) {
+        ret = compileJson(pat);
       } else if (strncmp(tmp, "pre", 3) == 0) {
-        m_pattern[j] = EPatPrefix;
+        ret = compileItem(pat, EPatLiteral, m_cfg->prefix);
       } else if (strncmp(tmp, "end", 3) == 0) {
-        m_pattern[j] = EPatEnd;
+        ret = compileItem(pat, EPatLiteral, m_cfg->postfix);
       } else if (strncmp(tmp, "us", 2) == 0) {
         // get number from string, add user pattern of number
         int no = findNextNumeric(tmp, NULL);
         PRINT_DEBUG("Got user pattern %d\n", no);
-        /// @todo
-        /// maybe set EUsrBase + userPatternNo && calc back to no @ construct ?
-        /// m_pattern must be non-typed for this to work
-        m_pattern[j] = EPatUsr + no;
+        char *usr = m_cfg->getUsrPattern(no);
+        if (usr) ret = compileItem(pat, EPatLiteral, usr);
       } else {
         PRINT_DEBUG("got invalid pattern identifier: %s\n", tmp);
-        return EErr;
+        delete pat;
+        return NULL;
+      }
+
+      if (ret != ENoErr) {
+        PRINT_DEBUG("Pattern too long\n");
+        delete pat;
+        return NULL;
       }
 
       if ((i + 2) > patLen) {
@@ -378,99 +1837,171 @@ int Logger::initPattern(const char *pattern) {
       }
     } else {
       PRINT_DEBUG("Invalid pattern string\n");
-      return EErr;
+      delete pat;
+      return NULL;
     }
   }
+
+  if (pat->msgItem > pat->len) pat->msgItem = pat->len;
+
+  // JSON values carry neither padding nor color escapes
+  if (pat->json) {
+    for (int lev = 0; lev <= CfgLog::ELogAlways; lev++) {
+      while ((pat->levelLen[lev] > 0) && (pat->levelStr[lev][pat->levelLen[lev] - 1] == ' ')) pat->levelLen[lev]--;
+      pat->colorLen[lev] = 0;
+    }
+  }
+  return pat;
+}
+
+int Logger::compileJson(pattern_t *pat) {
+
+  // one object per record, the msg item renders the msg string and the fields
+  int ret = compileItem(pat, EPatLiteral, "{\"time\":\"");
+  if (ret == ENoErr) ret = compileItem(pat, EPatTimeIso, NULL);
+  if (ret == ENoErr) ret = compileItem(pat, EPatLiteral, "\",\"level\":\"");
+  if (ret == ENoErr) ret = compileItem(pat, EPatLevel, NULL);
+  if (ret == ENoErr) ret = compileItem(pat, EPatLiteral, "\",\"pid\":");
+  if (ret == ENoErr) ret = compileItem(pat, EPatPID, NULL);
+  if (ret == ENoErr) ret = compileItem(pat, EPatLiteral, ",\"tid\":");
+  if (ret == ENoErr) ret = compileItem(pat, EPatTID, NULL);
+  if (ret == ENoErr) ret = compileItem(pat, EPatLiteral, ",\"msg\":");
+  if ((ret == ENoErr) && (pat->msgItem > pat->len)) pat->msgItem = pat->len;
+  if (ret == ENoErr) ret = compileItem(pat, EPatMsg, NULL);
+  if (ret == ENoErr) ret = compileItem(pat, EPatLiteral, "}");
+  pat->json = true;
+  return ret;
+}
+
+int Logger::initPattern(const char *pattern) {
+
+  pattern_t *pat = compilePattern(pattern, m_tty);
+  if (pat == NULL) return EErr;
+
+  // the replaced pattern may still be rendered by other threads
+  const config_t *cfg = m_config.load(std::memory_order_acquire);
+  publish(pat, (cfg != NULL) ? cfg->sinks : NULL);
   return ENoErr;
 }
 
-void Logger::constructMsg(char *msg, const char *fmt, CfgLog::level_e lev) {
-  char buf[CfgLog::CMaxLogMsgLen] = {0};
+int Logger::compileItem(pattern_t *pat, int type, const char *lit) {
 
-  for (int i = 0; i < CfgLog::CMaxPatternItems; i++) {
-    PRINT_DEBUG("item %d: %d\n", i, m_pattern[i]);
+  patItem_t *last = (pat->len > 0) ? &pat->items[pat->len - 1] : NULL;
 
-    if (m_pattern[i] >= EPatUsr) {
-      int no = m_pattern[i] - EPatUsr;
-      addUsr(buf, no); // user defined pattern
-    } else {
-      switch (m_pattern[i]) {
-        case EPatSeparator:  addSeparator(buf); break;
-        case EPatPrefix:     addPrefix(buf); break;
-        case EPatEnd:        addPostfix(buf); break;
-        case EPatPID:        addPID(buf); break;
-        case EPatLevel:      addLevel(buf, lev); break;
-        case EPatMsg:        addMsg(buf, fmt); break;
-        case EPatTime:       addTime(buf); break;
-        case EPatInvalid:    if (i == 0) return; else break;
-        default:             return;
-      }
-    }
-  }
+  if (type == EPatLiteral) {
+    int len = strlen(lit);
+    if (len == 0) return ENoErr;
 
-  if (strlen(buf) >= strlen(fmt)) {
-    PRINT_DEBUG("Constructed message: %s\n", buf);
-    memcpy(msg, buf, CfgLog::CMaxLogMsgLen);
+    // join with a preceding literal run
+    if (last == NULL || last->type != EPatLiteral) {
+      int off = (last == NULL) ? 0 : last->off + last->len;
+      if (pat->len >= CfgLog::CMaxPatternItems) return EErr;
+      last = &pat->items[pat->len++];
+      last->type = EPatLiteral;
+      last->off  = off;
+      last->len  = 0;
+    }
+    if (last->off + last->len + len > (int)sizeof(pat->lit)) return EErr;
+    memcpy(&pat->lit[last->off + last->len], lit, len);
+    last->len += len;
+  } else {
+    if (pat->len >= CfgLog::CMaxPatternItems) return EErr;
+    // dynamic items don't use the literal pool, but keep offsets increasing
+    int off = (last == NULL) ? 0 : last->off + last->len;
+    pat->items[pat->len].type = type;
+    pat->items[pat->len].off  = off;
+    pat->items[pat->len].len  = 0;
+    pat->len++;
   }
+  return ENoErr;
 }
 
-int Logger::addUsr(char *msg, int no) {
-  char *pat = m_cfg->getUsrPattern(no);
-  if (pat) {
-    strcat(msg, pat);
-    return ENoErr;
+void Logger::initLevelStrings(pattern_t *pat) {
+
+  for (int lev = 0; lev <= CfgLog::ELogAlways; lev++) {
+    char lbuf[CfgLog::CMaxLogLevelStrLen] = {0};
+
+    strcpy(lbuf, CfgLog::CLogMsgLevel[lev]);
+    switch(m_cfg->logLevelCase) {
+      case CfgLog::ELevelCaseLower: to_lower(lbuf, strlen(lbuf)); break;
+      case CfgLog::ELevelCaseUpper: to_upper(lbuf, strlen(lbuf)); break;
+      case CfgLog::ELevelCaseDefault: // move to default
+      default: break;
+    }
+
+    pat->levelLen[lev] = snprintf(pat->levelStr[lev], sizeof(pat->levelStr[lev]), "%-7s", lbuf);
   }
-  return EErr;
 }
 
-void Logger::addSeparator(char *msg) {
-  strcat(msg, m_cfg->separator);
-}
+void Logger::initColors(pattern_t *pat, bool tty) {
 
-void Logger::addPrefix(char *msg) {
-  strcat(msg, m_cfg->prefix);
-}
+  bool enabled = m_cfg->useColor && (tty || m_cfg->colorAlways);
 
-void Logger::addPostfix(char *msg) {
-  strcat(msg, m_cfg->postfix);
+  for (int lev = 0; lev <= CfgLog::ELogAlways; lev++) {
+    int color = m_cfg->levelColor[lev];
+    if ((color == CfgLog::EColorNone) && (lev <= CfgLog::ELogError)) color = m_cfg->color;
+
+    pat->colorLen[lev] = 0;
+    if (enabled && (color != CfgLog::EColorNone)) {
+      pat->colorLen[lev] = snprintf(pat->color[lev], sizeof(pat->color[lev]), "\033[%dm", color);
+    }
+  }
 }
 
-void Logger::addLevel(char *msg, CfgLog::level_e lev) {
-  char levelbuf[CfgLog::CMaxLogLevelStrLen] = {0};
-  char lbuf[CfgLog::CMaxLogLevelStrLen] = {0};
 
-  strcpy(lbuf, CfgLog::CLogMsgLevel[lev]);
-  switch(m_cfg->logLevelCase) {
-    case CfgLog::ELevelCaseLower: to_lower(lbuf, strlen(lbuf)); break;
-    case CfgLog::ELevelCaseUpper: to_upper(lbuf, strlen(lbuf)); break;
-    case CfgLog::ELevelCaseDefault: // move to default
-    default: break;
+char *Logger::renderItems(const pattern_t *pat, char *pos, const char *end, int from, int to, const char *fmt,
+                          CfgLog::level_e lev, const recCtx_t *ctx) {
+
+  for (int i = from; (i < to) && (pos != NULL); i++) {
+    const patItem_t *item = &pat->items[i];
+
+    switch (item->type) {
+      case EPatLiteral:   pos = addLiteral(pos, end, &pat->lit[item->off], item->len); break;
+      case EPatLevel:     pos = addLiteral(pos, end, pat->levelStr[lev], pat->levelLen[lev]); break;
+      case EPatMsg:       if (fmt) pos = addLiteral(pos, end, fmt, strlen(fmt)); break;
+      case EPatPID:       pos = addPID(pos, end, ctx); break;
+      case EPatTID:       pos = addTID(pos, end, ctx); break;
+      case EPatTime:      pos = addTime(pos, end, LogTime::ETimeClock, ctx); break;
+      case EPatTimeUs:    pos = addTime(pos, end, LogTime::ETimeClockUs, ctx); break;
+      case EPatTimeIso:   pos = addTime(pos, end, LogTime::ETimeIso, ctx); break;
+      case EPatTimeEpoch: pos = addTime(pos, end, LogTime::ETimeEpochNs, ctx); break;
+      case EPatTimeMono:  pos = addTime(pos, end, LogTime::ETimeMono, ctx); break;
+      default:            break;
+    }
   }
+  return pos;
+}
 
-  sprintf(levelbuf, "%-7s", lbuf);
-  strcat(msg, levelbuf);
+char *Logger::addLiteral(char *pos, const char *end, const char *str, int len) {
+  if (len > end - pos) return NULL;
+  memcpy(pos, str, len);
+  return pos + len;
 }
 
-void Logger::addPID(char *msg) {
-  char buf[10] = {0};
-  sprintf(buf, "%d", getpid());
-  strcat(msg, buf);
+char *Logger::addPID(char *pos, const char *end, const recCtx_t *ctx) {
+  char buf[16];
+  return addLiteral(pos, end, buf, snprintf(buf, sizeof(buf), "%d", (ctx != NULL) ? ctx->pid : getpid()));
 }
 
-void Logger::addTime(char *msg) {
-  char timebuf[20] = {0};
-  time_t t;
-  struct tm *tm;
-  time(&t);
-  tm = localtime(&t);
+char *Logger::addTID(char *pos, const char *end, const recCtx_t *ctx) {
+
+  // the kernel thread id never changes, render it once per thread
+  static thread_local char tid[16];
+  static thread_local int  len = 0;
 
-  sprintf(timebuf, "%02d:%02d:%02d",
-              tm->tm_hour, tm->tm_min, tm->tm_sec);
-  strcat(msg, timebuf);
+  if (ctx != NULL) {
+    char buf[16];
+    return addLiteral(pos, end, buf, snprintf(buf, sizeof(buf), "%ld", ctx->tid));
+  }
+  if (len == 0) len = snprintf(tid, sizeof(tid), "%ld", currentTid());
+  return addLiteral(pos, end, tid, len);
 }
 
-void Logger::addMsg(char *msg, const char *fmt) {
-  strcat(msg, fmt);
+char *Logger::addTime(char *pos, const char *end, LogTime::format_e fmt, const recCtx_t *ctx) {
+  int len = (ctx == NULL) ? LogTime::render(pos, end - pos, fmt)
+                          : LogTime::format(pos, end - pos, fmt, (fmt == LogTime::ETimeMono) ? &ctx->mono : &ctx->real);
+  if (len < 0) return NULL;
+  return pos + len;
 }
 
 // helper functions
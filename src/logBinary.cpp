@@ -0,0 +1,612 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logBinary.cpp
+/// @brief Implementation of the LogBinary class
+
+#include "logBinary.h"
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <thread>
+
+/// size of the fixed part of a log record
+static const int CLogRecLen = 1 + 4 + 1 + 4 + 8 + 2;
+
+/// size of an encoded argument of the given kind, strings count their length field only
+static int argSize(uint8_t kind) {
+  switch (kind) {
+    case LogBinary::EArgInt:        return sizeof(int);
+    case LogBinary::EArgLong:       return sizeof(long long);
+    case LogBinary::EArgDouble:     return sizeof(double);
+    case LogBinary::EArgLongDouble: return sizeof(long double);
+    case LogBinary::EArgPtr:        return sizeof(void*);
+    case LogBinary::EArgStr:        return sizeof(uint16_t);
+    default:                        return 0;
+  }
+}
+
+/// append \a n bytes at \a pos
+static inline char *put(char *pos, const void *val, size_t n) {
+  memcpy(pos, val, n);
+  return pos + n;
+}
+
+/// read \a n bytes from \a pos, NULL if they are not there
+static inline const char *get(const char *pos, const char *end, void *val, size_t n) {
+  if ((pos == NULL) || ((size_t)(end - pos) < n)) return NULL;
+  memcpy(val, pos, n);
+  return pos + n;
+}
+
+std::atomic<uint32_t> LogBinary::s_sessions(0);
+
+LogBinary::LogBinary() {
+  m_formats = new format_t[CMaxFormats];
+  for (int i = 0; i < CMaxFormats; i++) {
+    m_formats[i].key   = NULL;
+    m_formats[i].ready = false;
+    m_formats[i].text  = NULL;
+  }
+  m_nextId = CTextId + 1;
+
+  // unique across restarts by the time, within the process by the counter
+  struct timespec real;
+  clock_gettime(CLOCK_REALTIME, &real);
+  m_session = (uint64_t)real.tv_sec * 1000000000ULL + real.tv_nsec + s_sessions++;
+}
+
+LogBinary::~LogBinary() {
+  for (int i = 0; i < CMaxFormats; i++) {
+    free(m_formats[i].text);
+  }
+  delete[] m_formats;
+}
+
+LogBinary::format_t *LogBinary::lookup(const char *fmt, bool *added) {
+
+  uint64_t h = ((uint64_t)(uintptr_t)fmt >> 3) * 0x9E3779B97F4A7C15ULL;
+  *added = false;
+
+  for (int i = 0; i < CMaxFormats; i++) {
+    format_t *f = &m_formats[(h + i) & (CMaxFormats - 1)];
+    const char *key = f->key.load(std::memory_order_acquire);
+
+    if (key == NULL) {
+      if (f->key.compare_exchange_strong(key, fmt)) {
+        // the slot is ours, register the format
+        f->text  = strdup(fmt);
+        f->nargs = parse(fmt, NULL, CMaxArgs, f->kinds);
+        // the dictionary record must fit into a single record
+        if ((f->text == NULL) || (1 + 4 + 1 + f->nargs + 2 + strlen(fmt) > (size_t)CMaxFormatRecLen)) f->nargs = -1;
+
+        int fixed = 0;
+        for (int a = f->nargs - 1; a >= 0; a--) {
+          f->fixed[a] = fixed;
+          fixed += argSize(f->kinds[a]);
+        }
+        f->id = (f->nargs < 0) ? CTextId : m_nextId++;
+        *added = (f->id != CTextId);
+        f->ready.store(true, std::memory_order_release);
+        return f;
+      }
+      // somebody else took the slot, check whose format it is
+    }
+    if (key != fmt) continue;
+
+    while (!f->ready.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+    return f;
+  }
+  return NULL;
+}
+
+int LogBinary::encode(char *buf, int len, char *dict, int *dictLen, CfgLog::level_e lev, long tid,
+                      const struct timespec *ts, const char *fmt, va_list args, bool *cut) {
+
+  bool added = false;
+  bool whole = true;
+  format_t *f = lookup(fmt, &added);
+  uint32_t id = (f == NULL) ? CTextId : f->id;
+
+  // the same buffer may be reused for another format string
+  if ((id != CTextId) && (strcmp(f->text, fmt) != 0)) id = CTextId;
+
+  *dictLen = added ? encodeFormat(dict, *dictLen, f) : 0;
+  if (len < CLogRecLen) {
+    if (cut != NULL) *cut = true;
+    return 0;
+  }
+
+  char *pos = buf;
+  const char *end = buf + len;
+  uint8_t  type  = ERecLog;
+  uint8_t  level = lev;
+  uint32_t thread = tid;
+  uint64_t ns = (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec;
+
+  pos = put(pos, &type, 1);
+  pos = put(pos, &id, 4);
+  pos = put(pos, &level, 1);
+  pos = put(pos, &thread, 4);
+  pos = put(pos, &ns, 8);
+  char *lenPos = pos;
+  pos += 2;
+
+  if (id == CTextId) {
+    // store the formatted text as a single string argument
+    int room = end - pos - 2;
+    if (room > UINT16_MAX) room = UINT16_MAX;
+    int n = (room > 0) ? vsnprintf(pos + 2, room, fmt, args) : 0;
+    if (n < 0) n = 0;
+    else if (n >= room) {
+      n = (room > 0) ? room - 1 : 0;
+      whole = false;
+    }
+    uint16_t slen = n;
+    pos = put(pos, &slen, 2) + n;
+  } else {
+    for (int a = 0; a < f->nargs; a++) {
+      // cut the record if not even the next argument fits
+      if (end - pos < argSize(f->kinds[a])) {
+        whole = false;
+        break;
+      }
+
+      switch (f->kinds[a]) {
+        case EArgInt: {
+          int v = va_arg(args, int);
+          pos = put(pos, &v, sizeof(v));
+          break;
+        }
+        case EArgLong: {
+          long long v = va_arg(args, long long);
+          pos = put(pos, &v, sizeof(v));
+          break;
+        }
+        case EArgDouble: {
+          double v = va_arg(args, double);
+          pos = put(pos, &v, sizeof(v));
+          break;
+        }
+        case EArgLongDouble: {
+          long double v = va_arg(args, long double);
+          pos = put(pos, &v, sizeof(v));
+          break;
+        }
+        case EArgPtr: {
+          void *v = va_arg(args, void*);
+          pos = put(pos, &v, sizeof(v));
+          break;
+        }
+        case EArgStr: {
+          const char *s = va_arg(args, const char*);
+          if (s == NULL) s = "(null)";
+          // cut the string so that the remaining arguments still fit
+          long room = end - pos - 2 - f->fixed[a];
+          size_t n = (room > 0) ? strnlen(s, (room < UINT16_MAX) ? room : UINT16_MAX) : 0;
+          if (s[n] != '\0') whole = false;
+          uint16_t slen = n;
+          pos = put(put(pos, &slen, 2), s, n);
+          break;
+        }
+        default:
+          break;
+      }
+    }
+  }
+
+  uint16_t argLen = pos - lenPos - 2;
+  memcpy(lenPos, &argLen, 2);
+  if (cut != NULL) *cut = !whole;
+  return pos - buf;
+}
+
+int LogBinary::encodeHeader(char *buf, int len) {
+
+  struct timespec real, mono;
+  const struct timespec *start = LogTime::start();
+  clock_gettime(CLOCK_REALTIME, &real);
+  clock_gettime(CLOCK_MONOTONIC, &mono);
+
+  // wall clock time of the monotonic start, so that &mon can be rendered from record times
+  uint64_t up = (uint64_t)(mono.tv_sec - start->tv_sec) * 1000000000ULL + mono.tv_nsec - start->tv_nsec;
+  uint64_t ns = (uint64_t)real.tv_sec * 1000000000ULL + real.tv_nsec - up;
+  uint32_t pid = getpid();
+  uint8_t type = ERecHeader;
+
+  if (len < 1 + 4 + 8 + 8) return 0;
+  char *pos = put(buf, &type, 1);
+  pos = put(pos, &pid, 4);
+  pos = put(pos, &ns, 8);
+  pos = put(pos, &m_session, 8);
+  return pos - buf;
+}
+
+int LogBinary::encodeFormat(char *buf, int len, const format_t *f) {
+
+  uint16_t flen = strlen(f->text);
+  uint8_t type = ERecFormat;
+  uint8_t nargs = f->nargs;
+
+  if (len < 1 + 4 + 1 + nargs + 2 + flen) return 0;
+  char *pos = put(buf, &type, 1);
+  pos = put(pos, &f->id, 4);
+  pos = put(pos, &nargs, 1);
+  pos = put(pos, f->kinds, nargs);
+  pos = put(pos, &flen, 2);
+  pos = put(pos, f->text, flen);
+  return pos - buf;
+}
+
+int LogBinary::writeDictionary(LogSink *sink) {
+
+  char buf[CMaxFormatRecLen];
+  struct iovec iov;
+
+  iov.iov_base = buf;
+  iov.iov_len  = encodeHeader(buf, sizeof(buf));
+  if (sink->write(&iov, 1) != LogSink::ENoErr) return EErr;
+
+  for (int i = 0; i < CMaxFormats; i++) {
+    format_t *f = &m_formats[i];
+    if (!f->ready.load(std::memory_order_acquire) || (f->id == CTextId)) continue;
+
+    iov.iov_len = encodeFormat(buf, sizeof(buf), f);
+    if (sink->write(&iov, 1) != LogSink::ENoErr) return EErr;
+  }
+  return ENoErr;
+}
+
+int LogBinary::writeDictionary(int fd) {
+
+  char buf[CMaxFormatRecLen];
+  int len = encodeHeader(buf, sizeof(buf));
+  if (write(fd, buf, len) != len) return EErr;
+
+  for (int i = 0; i < CMaxFormats; i++) {
+    format_t *f = &m_formats[i];
+    if (!f->ready.load(std::memory_order_acquire) || (f->id == CTextId)) continue;
+
+    len = encodeFormat(buf, sizeof(buf), f);
+    if (write(fd, buf, len) != len) return EErr;
+  }
+  return ENoErr;
+}
+
+int LogBinary::parse(const char *fmt, spec_t *specs, int maxSpecs, uint8_t *kinds) {
+
+  int nargs = 0;
+  int nspecs = 0;
+
+  for (const char *p = fmt; *p != '\0'; p++) {
+    if (*p != '%') continue;
+    if (p[1] == '%') {
+      p++;
+      continue;
+    }
+
+    spec_t spec;
+    spec.start = p - fmt;
+    spec.stars = 0;
+    p++;
+
+    // flags, width and precision
+    while (strchr("-+ #0'I", *p) != NULL && *p != '\0') p++;
+    if (*p == '*') {
+      spec.stars++;
+      p++;
+    }
+    while (*p >= '0' && *p <= '9') p++;
+    // positional arguments are not supported
+    if (*p == '$') return -1;
+    if (*p == '.') {
+      p++;
+      if (*p == '*') {
+        spec.stars++;
+        p++;
+      }
+      while (*p >= '0' && *p <= '9') p++;
+    }
+
+    // length modifier
+    bool wide = false;
+    bool ldbl = false;
+    switch (*p) {
+      case 'h': p++; if (*p == 'h') p++; break;
+      case 'l': p++; wide = true; if (*p == 'l') p++; break;
+      case 'q': case 'j': case 'z': case 'Z': case 't': p++; wide = true; break;
+      case 'L': p++; ldbl = true; break;
+      default: break;
+    }
+
+    switch (*p) {
+      case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+        spec.kind = (wide || ldbl) ? EArgLong : EArgInt;
+        break;
+      case 'c':
+        if (wide) return -1;
+        spec.kind = EArgInt;
+        break;
+      case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+        spec.kind = ldbl ? EArgLongDouble : EArgDouble;
+        break;
+      case 's':
+        if (wide) return -1;
+        spec.kind = EArgStr;
+        break;
+      case 'p':
+        spec.kind = EArgPtr;
+        break;
+      default:
+        // %n, %m, wide characters, ...
+        return -1;
+    }
+    spec.end = p + 1 - fmt;
+
+    if ((nargs + spec.stars + 1 > CMaxArgs) || (nspecs >= maxSpecs)) return -1;
+    for (int i = 0; i < spec.stars; i++) {
+      if (kinds != NULL) kinds[nargs] = EArgInt;
+      nargs++;
+    }
+    if (kinds != NULL) kinds[nargs] = spec.kind;
+    nargs++;
+    if (specs != NULL) specs[nspecs] = spec;
+    nspecs++;
+  }
+  return nargs;
+}
+
+/// format one conversion with its '*' arguments
+template<typename T>
+static int putArg(char *buf, size_t len, const char *spec, int stars, const int *star, T val) {
+  switch (stars) {
+    case 0:  return snprintf(buf, len, spec, val);
+    case 1:  return snprintf(buf, len, spec, star[0], val);
+    default: return snprintf(buf, len, spec, star[0], star[1], val);
+  }
+}
+
+/// copy literal text of a format string, collapsing "%%"
+static char *putText(char *pos, const char *end, const char *from, const char *to) {
+  while ((from < to) && (pos < end)) {
+    if ((from[0] == '%') && (from + 1 < to) && (from[1] == '%')) from++;
+    *pos++ = *from++;
+  }
+  return pos;
+}
+
+int LogBinary::format(char *buf, int len, const char *fmt, const char *arg, int argLen) {
+
+  static char str[UINT16_MAX + 1];
+  spec_t specs[CMaxArgs];
+  uint8_t kinds[CMaxArgs];
+  int nspecs = 0;
+
+  int nargs = parse(fmt, specs, CMaxArgs, kinds);
+  if (nargs < 0) return 0;
+  for (int a = 0; a < nargs; nspecs++) a += specs[nspecs].stars + 1;
+
+  char *pos = buf;
+  const char *end = buf + len - 1;
+  const char *aend = arg + argLen;
+  const char *lit = fmt;
+
+  for (int i = 0; (i < nspecs) && (pos < end); i++) {
+    const spec_t *s = &specs[i];
+    char spec[64];
+    int star[2] = { 0, 0 };
+    int n = 0;
+
+    pos = putText(pos, end, lit, fmt + s->start);
+    lit = fmt + s->end;
+    if (s->end - s->start >= (int)sizeof(spec)) return pos - buf;
+    memcpy(spec, fmt + s->start, s->end - s->start);
+    spec[s->end - s->start] = '\0';
+
+    for (int k = 0; k < s->stars; k++) {
+      arg = get(arg, aend, &star[k], sizeof(int));
+    }
+
+    switch (s->kind) {
+      case EArgInt: {
+        int v = 0;
+        if ((arg = get(arg, aend, &v, sizeof(v))) != NULL) n = putArg(pos, end - pos + 1, spec, s->stars, star, v);
+        break;
+      }
+      case EArgLong: {
+        long long v = 0;
+        if ((arg = get(arg, aend, &v, sizeof(v))) != NULL) n = putArg(pos, end - pos + 1, spec, s->stars, star, v);
+        break;
+      }
+      case EArgDouble: {
+        double v = 0;
+        if ((arg = get(arg, aend, &v, sizeof(v))) != NULL) n = putArg(pos, end - pos + 1, spec, s->stars, star, v);
+        break;
+      }
+      case EArgLongDouble: {
+        long double v = 0;
+        if ((arg = get(arg, aend, &v, sizeof(v))) != NULL) n = putArg(pos, end - pos + 1, spec, s->stars, star, v);
+        break;
+      }
+      case EArgPtr: {
+        void *v = NULL;
+        if ((arg = get(arg, aend, &v, sizeof(v))) != NULL) n = putArg(pos, end - pos + 1, spec, s->stars, star, v);
+        break;
+      }
+      case EArgStr: {
+        uint16_t slen = 0;
+        if (((arg = get(arg, aend, &slen, sizeof(slen))) != NULL) &&
+            ((arg = get(arg, aend, str, slen)) != NULL)) {
+          str[slen] = '\0';
+          n = putArg(pos, end - pos + 1, spec, s->stars, star, (const char*)str);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+
+    // a truncated record ends the text
+    if (arg == NULL) return pos - buf;
+    if (n > end - pos) n = end - pos;
+    if (n > 0) pos += n;
+  }
+
+  pos = putText(pos, end, lit, fmt + strlen(fmt));
+  return pos - buf;
+}
+
+LogBinary::session_t *LogBinary::findSession(session_t **list, uint64_t key, bool add) {
+
+  for (session_t *s = *list; s != NULL; s = s->next) {
+    if (s->key == key) return s;
+  }
+  if (!add) return NULL;
+
+  session_t *s = new session_t;
+  s->key  = key;
+  s->dict = new const char*[CMaxFormats + 1];
+  for (int i = 0; i <= CMaxFormats; i++) s->dict[i] = NULL;
+  s->dict[CTextId] = "%s";
+  s->next = *list;
+  *list = s;
+  return s;
+}
+
+int LogBinary::decode(const char * const *files, int cnt, Logger *out) {
+
+  char **data = new char*[cnt];
+  long  *size = new long[cnt];
+  session_t *sessions = NULL;
+  static char text[UINT16_MAX + 1];
+  int ret = ENoErr;
+
+  // read all files
+  for (int i = 0; i < cnt; i++) {
+    data[i] = NULL;
+    size[i] = 0;
+    FILE *fd = fopen(files[i], "r");
+    if (fd == NULL) {
+      fprintf(stderr, "Failed to open %s\n", files[i]);
+      ret = EErr;
+      continue;
+    }
+    if ((fseek(fd, 0, SEEK_END) == 0) && ((size[i] = ftell(fd)) > 0) && (fseek(fd, 0, SEEK_SET) == 0)) {
+      data[i] = new char[size[i]];
+      if (fread(data[i], 1, size[i], fd) != (size_t)size[i]) {
+        fprintf(stderr, "Failed to read %s\n", files[i]);
+        size[i] = 0;
+        ret = EErr;
+      }
+    }
+    fclose(fd);
+  }
+
+  // two passes: collect the dictionaries of all files, then render the records
+  for (int pass = 0; pass < 2; pass++)
+  for (int i = 0; i < cnt; i++) {
+    const char *pos = data[i];
+    const char *end = data[i] + size[i];
+    uint32_t pid = 0;
+    uint64_t start = 0;
+    uint64_t key = 0;
+    // records before the first header, if any, form a session of their own
+    session_t *session = findSession(&sessions, key, true);
+
+    while ((pos != NULL) && (pos < end)) {
+      uint8_t type = 0;
+      uint32_t id = 0;
+      uint16_t len = 0;
+      pos = get(pos, end, &type, 1);
+
+      if (type == ERecHeader) {
+        pos = get(pos, end, &pid, 4);
+        pos = get(pos, end, &start, 8);
+        pos = get(pos, end, &key, 8);
+        // the format ids of a restarted Logger begin anew
+        session = findSession(&sessions, key, true);
+      } else if (type == ERecFormat) {
+        uint8_t nargs = 0;
+        pos = get(pos, end, &id, 4);
+        pos = get(pos, end, &nargs, 1);
+        // the argument kinds are not needed to decode, the format string has them
+        pos = ((pos != NULL) && (end - pos >= nargs)) ? pos + nargs : NULL;
+        pos = get(pos, end, &len, 2);
+        if ((pos == NULL) || (end - pos < len)) {
+          pos = NULL;
+          break;
+        }
+        // the string is not terminated in the file, keep a terminated copy
+        if ((pass == 0) && (id <= (uint32_t)CMaxFormats) && (session->dict[id] == NULL)) {
+          char *fmt = new char[len + 1];
+          memcpy(fmt, pos, len);
+          fmt[len] = '\0';
+          session->dict[id] = fmt;
+        }
+        pos += len;
+      } else if (type == ERecLog) {
+        uint8_t level = 0;
+        uint32_t tid = 0;
+        uint64_t ns = 0;
+        pos = get(pos, end, &id, 4);
+        pos = get(pos, end, &level, 1);
+        pos = get(pos, end, &tid, 4);
+        pos = get(pos, end, &ns, 8);
+        pos = get(pos, end, &len, 2);
+        if ((pos == NULL) || (end - pos < len)) {
+          pos = NULL;
+          break;
+        }
+
+        if (pass == 1) {
+          if ((id > (uint32_t)CMaxFormats) || (session->dict[id] == NULL)) {
+            fprintf(stderr, "%s: unknown format id %u\n", files[i], id);
+            ret = EErr;
+          } else {
+            Logger::recCtx_t ctx;
+            const struct timespec *base = LogTime::start();
+            // &mon is rendered relative to the monotonic start of this process
+            uint64_t mono = (uint64_t)base->tv_sec * 1000000000ULL + base->tv_nsec + (ns - start);
+            ctx.real.tv_sec  = ns / 1000000000ULL;
+            ctx.real.tv_nsec = ns % 1000000000ULL;
+            ctx.mono.tv_sec  = mono / 1000000000ULL;
+            ctx.mono.tv_nsec = mono % 1000000000ULL;
+            ctx.pid = pid;
+            ctx.tid = tid;
+
+            int n = format(text, sizeof(text), session->dict[id], pos, len);
+            if (level > CfgLog::ELogAlways) level = CfgLog::ELogAlways;
+            out->writeRecord((CfgLog::level_e)level, &ctx, text, n);
+          }
+        }
+        pos += len;
+      } else {
+        pos = NULL;
+      }
+    }
+
+    if ((pos == NULL) && (pass == 0)) {
+      fprintf(stderr, "%s: truncated or corrupt record\n", files[i]);
+      ret = EErr;
+    }
+  }
+
+  while (sessions != NULL) {
+    session_t *next = sessions->next;
+    for (int i = 1; i <= CMaxFormats; i++) delete[] sessions->dict[i];
+    delete[] sessions->dict;
+    delete sessions;
+    sessions = next;
+  }
+  for (int i = 0; i < cnt; i++) delete[] data[i];
+  delete[] data;
+  delete[] size;
+  return ret;
+}
@@ -0,0 +1,161 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logChild.cpp
+/// @brief Implementation of the LogChild class
+
+#include "logChild.h"
+#include <stdlib.h>
+
+LogChild::LogChild(Logger *root, LogChild *parent, const char *name, size_t len) {
+
+  m_root   = root;
+  m_parent = parent;
+  m_first  = NULL;
+  m_next   = NULL;
+  m_level  = -1;
+
+  m_name = (char*)malloc(len + 1);
+  memcpy(m_name, name, len);
+  m_name[len] = '\0';
+  const char *dot = strrchr(m_name, '.');
+  m_base = (dot != NULL) ? dot + 1 : m_name;
+
+  // without an override the child logs exactly what its parent logs
+  if (parent != NULL) {
+    m_outLevel.store(parent->m_outLevel.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_enabled.store(parent->m_enabled.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  } else {
+    m_outLevel.store(root->m_level.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    m_enabled.store(root->m_enabled.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+}
+
+LogChild::~LogChild() {
+
+  while (m_first != NULL) {
+    LogChild *next = m_first->m_next;
+    delete m_first;
+    m_first = next;
+  }
+  free(m_name);
+}
+
+LogChild *LogChild::find(LogChild *first, const char *name, size_t len) {
+
+  for (LogChild *c = first; c != NULL; c = c->m_next) {
+    if ((strncmp(c->m_base, name, len) == 0) && (c->m_base[len] == '\0')) return c;
+  }
+  return NULL;
+}
+
+void LogChild::resolve(int inherited, int floor) {
+
+  int level = (m_level >= 0) ? m_level : inherited;
+  m_outLevel.store(level, std::memory_order_relaxed);
+  m_enabled.store((level > floor) ? level : floor, std::memory_order_relaxed);
+
+  for (LogChild *c = m_first; c != NULL; c = c->m_next) c->resolve(level, floor);
+}
+
+void LogChild::setLevel(CfgLog::level_e level) {
+
+  std::lock_guard<std::mutex> lock(m_root->m_cfgLock);
+  m_level = level;
+  int inherited = (m_parent != NULL) ? m_parent->m_outLevel.load() : m_root->m_level.load();
+  resolve(inherited, m_root->extraLevel());
+}
+
+void LogChild::clearLevel(void) {
+
+  std::lock_guard<std::mutex> lock(m_root->m_cfgLock);
+  m_level = -1;
+  int inherited = (m_parent != NULL) ? m_parent->m_outLevel.load() : m_root->m_level.load();
+  resolve(inherited, m_root->extraLevel());
+}
+
+bool LogChild::hasLevel(void) {
+  std::lock_guard<std::mutex> lock(m_root->m_cfgLock);
+  return m_level >= 0;
+}
+
+void LogChild::reportSuppressed(CfgLog::level_e lev, const char *file, int line, uint32_t cnt) {
+  if (isEnabled(lev)) m_root->writeSuppressed(lev, m_outLevel.load(std::memory_order_relaxed), file, line, cnt);
+}
+
+void LogChild::logv(CfgLog::level_e lev, const char *fmt, va_list args) {
+
+  if (!isEnabled(lev)) {
+    m_root->countFiltered(lev);
+    return;
+  }
+  m_root->logvAs(lev, m_outLevel.load(std::memory_order_relaxed), fmt, args);
+}
+
+void LogChild::emergency(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logv(CfgLog::ELogEmergency, fmt, args);
+  va_end(args);
+}
+
+void LogChild::alert(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logv(CfgLog::ELogAlert, fmt, args);
+  va_end(args);
+}
+
+void LogChild::critical(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logv(CfgLog::ELogCritical, fmt, args);
+  va_end(args);
+}
+
+void LogChild::error(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logv(CfgLog::ELogError, fmt, args);
+  va_end(args);
+}
+
+void LogChild::warning(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logv(CfgLog::ELogWarn, fmt, args);
+  va_end(args);
+}
+
+void LogChild::notice(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logv(CfgLog::ELogNotice, fmt, args);
+  va_end(args);
+}
+
+void LogChild::info(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logv(CfgLog::ELogInfo, fmt, args);
+  va_end(args);
+}
+
+void LogChild::debug(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logv(CfgLog::ELogDebug, fmt, args);
+  va_end(args);
+}
+
+void LogChild::always(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  logv(CfgLog::ELogAlways, fmt, args);
+  va_end(args);
+}
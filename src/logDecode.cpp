@@ -0,0 +1,83 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logDecode.cpp
+/// @brief Decoder turning binary logfiles back into text
+
+#include "log.h"
+#include "logBinary.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+/// names of the standard profiles
+static const struct {
+  const char       *name;
+  CfgLog::profile_e profile;
+} profiles[] = {
+  { "none",    CfgLog::ELogProfileNone },
+  { "minimal", CfgLog::ELogProfileMinimal },
+  { "default", CfgLog::ELogProfileDefault },
+  { "verbose", CfgLog::ELogProfileVerbose },
+  { "json",    CfgLog::ELogProfileJson },
+};
+static const int profileCnt = sizeof(profiles) / sizeof(profiles[0]);
+
+static void usage(const char *name) {
+  fprintf(stderr, "Usage: %s [-p profile] [-P pattern] [-o outfile] file...\n", name);
+  fprintf(stderr, "  -p profile  one of none, minimal, default (default), verbose, json\n");
+  fprintf(stderr, "  -P pattern  a custom pattern, e.g. \"&iso&sep&tid&sep&lev&sep&msg&end\"\n");
+  fprintf(stderr, "  -o outfile  write to a file instead of stdout\n");
+  fprintf(stderr, "  file        binary logfiles, oldest first (e.g. log.2 log.1 log)\n");
+}
+
+int main(int argc, char *argv[]) {
+
+  CfgLog *cfg = new CfgLog();
+  int opt;
+
+  cfg->profile = CfgLog::ELogProfileDefault;
+  cfg->flushMode = CfgLog::EFlushSize;
+
+  while ((opt = getopt(argc, argv, "p:P:o:h")) != -1) {
+    switch (opt) {
+      case 'p': {
+        int p = 0;
+        while ((p < profileCnt) && (strcmp(optarg, profiles[p].name) != 0)) p++;
+        if (p == profileCnt) {
+          usage(argv[0]);
+          return 1;
+        }
+        cfg->profile = profiles[p].profile;
+        break;
+      }
+      case 'P':
+        cfg->profile = CfgLog::ELogProfileUser;
+        strncpy(cfg->pattern, optarg, CfgLog::CMaxPatternLen - 1);
+        break;
+      case 'o':
+        cfg->logToFile = true;
+        strncpy(cfg->logfile, optarg, CfgLog::CMaxPathLen - 1);
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+
+  if (optind >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  Logger *log = new Logger(cfg);
+  int ret = LogBinary::decode(&argv[optind], argc - optind, log);
+
+  delete log;
+  delete cfg;
+  return (ret == LogBinary::ENoErr) ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logDedup.cpp
+/// @brief Implementation of the LogDedup class
+
+#include "logDedup.h"
+#include <stdio.h>
+#include <string.h>
+
+/// Hash \a msg eight bytes at a time, mixed with the format string address
+static uint64_t hashMsg(const void *key, const char *msg, int len) {
+
+  const uint64_t mul = 0x9e3779b97f4a7c15ULL;
+  uint64_t h = (uint64_t)(uintptr_t)key ^ ((uint64_t)len * mul);
+  uint64_t w;
+
+  for (; len >= 8; msg += 8, len -= 8) {
+    memcpy(&w, msg, 8);
+    h = (h ^ w) * mul;
+    h ^= h >> 29;
+  }
+  w = 0;
+  memcpy(&w, msg, len);
+  h = (h ^ w) * mul;
+  return h ^ (h >> 32);
+}
+
+/// Copy a short msg eight bytes at a time, gcc turns a memcpy into a fixed-size array into a slow rep movs
+static void copyMsg(char *dst, const char *src, int len) {
+
+  uint64_t w;
+  int i = 0;
+
+  for (; i + 8 <= len; i += 8) {
+    memcpy(&w, src + i, 8);
+    memcpy(dst + i, &w, 8);
+  }
+  for (; i < len; i++) dst[i] = src[i];
+}
+
+LogDedup::LogDedup(int windowMs) {
+
+  m_slots = new entry_t[CSlots];
+  for (int i = 0; i < CSlots; i++) {
+    m_slots[i].key = NULL;
+    m_slots[i].count.store(0, std::memory_order_relaxed);
+  }
+  m_window = (windowMs > 0) ? windowMs : 0;
+  m_last.store(-1, std::memory_order_relaxed);
+  m_nextExpiry.store(UINT64_MAX, std::memory_order_relaxed);
+}
+
+LogDedup::~LogDedup() {
+  delete[] m_slots;
+}
+
+bool LogDedup::check(const void *key, int level, const char *msg, int len, uint64_t now, summary_t *sums, int *cnt) {
+
+  *cnt = 0;
+  if (len >= CMaxTextLen) {
+    reportLast(-1, sums, cnt);
+    return false;
+  }
+
+  uint64_t hash = hashMsg(key, msg, len);
+  int slot = (int)(hash & (CSlots - 1));
+  entry_t *e = &m_slots[slot];
+
+  {
+    std::lock_guard<std::mutex> lock(e->lock);
+
+    if ((e->key == key) && (e->hash == hash) && (e->level == level) && (e->len == len) && (memcmp(e->text, msg, len) == 0)) {
+      if (now - e->start < m_window) {
+        if (e->count.fetch_add(1, std::memory_order_relaxed) == 0) armExpiry(e->start + m_window);
+        return true;
+      }
+      // the window has closed, report it and open a new one with this msg
+      if (e->count > 0) summarize(e, &sums[(*cnt)++]);
+    } else {
+      // a different msg takes the slot
+      if ((e->key != NULL) && (e->count > 0)) summarize(e, &sums[(*cnt)++]);
+      e->key   = key;
+      e->hash  = hash;
+      e->level = level;
+      e->len   = len;
+      copyMsg(e->text, msg, len);
+    }
+    e->start = now;
+    e->count.store(0, std::memory_order_relaxed);
+  }
+
+  reportLast(slot, sums, cnt);
+  return false;
+}
+
+bool LogDedup::expire(uint64_t now, int *cursor, summary_t *sum) {
+
+  // windows with repeats left unreported lower it again below
+  if (*cursor == 0) m_nextExpiry.store(UINT64_MAX, std::memory_order_relaxed);
+
+  while (*cursor < CSlots) {
+    entry_t *e = &m_slots[(*cursor)++];
+    std::lock_guard<std::mutex> lock(e->lock);
+
+    if ((e->key == NULL) || (e->count == 0)) continue;
+    if (now - e->start < m_window) {
+      armExpiry(e->start + m_window);
+      continue;
+    }
+    summarize(e, sum);
+    // the next occurrence is logged and opens a new window
+    e->key = NULL;
+    return true;
+  }
+  return false;
+}
+
+void LogDedup::summarize(entry_t *e, summary_t *sum) {
+
+  int count = e->count;
+  int n = snprintf(sum->text, sizeof(sum->text), "last message repeated %d time%s: %.*s",
+                   count, (count == 1) ? "" : "s", e->len, e->text);
+  sum->len   = (n < (int)sizeof(sum->text)) ? n : (int)sizeof(sum->text) - 1;
+  sum->level = e->level;
+  e->count.store(0, std::memory_order_relaxed);
+}
+
+void LogDedup::reportLast(int slot, summary_t *sums, int *cnt) {
+
+  int last = m_last.exchange(slot, std::memory_order_relaxed);
+  if ((last < 0) || (last == slot)) return;
+
+  // the common case of nothing to report does not take the lock
+  entry_t *e = &m_slots[last];
+  if (e->count.load(std::memory_order_relaxed) == 0) return;
+  std::lock_guard<std::mutex> lock(e->lock);
+  if ((e->key != NULL) && (e->count > 0)) summarize(e, &sums[(*cnt)++]);
+}
+
+void LogDedup::armExpiry(uint64_t at) {
+
+  uint64_t cur = m_nextExpiry.load(std::memory_order_relaxed);
+  while ((at < cur) && !m_nextExpiry.compare_exchange_weak(cur, at, std::memory_order_relaxed));
+}
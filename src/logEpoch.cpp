@@ -0,0 +1,109 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logEpoch.cpp
+/// @brief Implementation of the LogEpoch class
+
+#include "logEpoch.h"
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/membarrier.h>
+
+LogEpoch::slot_t          LogEpoch::s_slots[CSlots];
+std::atomic<uint64_t>     LogEpoch::s_owned(0);
+std::atomic<uint64_t>     LogEpoch::s_shared(0);
+std::atomic<uint64_t>     LogEpoch::s_epoch(1);
+std::atomic<bool>         LogEpoch::s_membarrier(false);
+std::mutex                LogEpoch::s_lock;
+LogEpoch::retired_t      *LogEpoch::s_retired = NULL;
+
+thread_local int               LogEpoch::s_slot = -1;
+thread_local int               LogEpoch::s_depth = 0;
+thread_local LogEpoch::owner_t LogEpoch::s_owner = { -1 };
+
+LogEpoch::owner::~owner() {
+  if (slot >= 0) s_owned.fetch_and(~(1ULL << slot), std::memory_order_release);
+}
+
+int LogEpoch::claim(void) {
+
+  // readers only rely on s_membarrier once registered, until then they fence
+  static std::once_flag registered;
+  std::call_once(registered, [] {
+    if (syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0) {
+      s_membarrier.store(true, std::memory_order_seq_cst);
+    }
+  });
+
+  uint64_t owned = s_owned.load(std::memory_order_relaxed);
+  int i = CSlots;
+
+  while (~owned != 0) {
+    i = __builtin_ctzll(~owned);
+    if (s_owned.compare_exchange_weak(owned, owned | (1ULL << i), std::memory_order_acquire)) break;
+    i = CSlots;
+  }
+  s_slot = i;
+  if (i < CSlots) s_owner.slot = i;
+  return i;
+}
+
+void LogEpoch::barrier(void) {
+
+  // readers skipping their fence are fenced by the membarrier, wherever they are
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (s_membarrier.load(std::memory_order_relaxed)) (void)syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+}
+
+void LogEpoch::retire(void *ptr, void (*release)(void*)) {
+
+  if (ptr == NULL) return;
+
+  std::lock_guard<std::mutex> lock(s_lock);
+  retired_t *r = new retired_t;
+  r->ptr = ptr;
+  r->release = release;
+  // readers of older epochs may hold ptr, those entering from now on cannot
+  r->epoch = s_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+  r->next = s_retired;
+  s_retired = r;
+}
+
+int LogEpoch::reclaim(void) {
+  std::lock_guard<std::mutex> lock(s_lock);
+  return reclaimLocked();
+}
+
+int LogEpoch::reclaimLocked(void) {
+
+  if (s_retired == NULL) return 0;
+  barrier();
+
+  // the oldest epoch a reader is in, threads without a slot hold back everything
+  uint64_t oldest = UINT64_MAX;
+  if (s_shared.load(std::memory_order_seq_cst) != 0) oldest = 0;
+  for (int i = 0; (i < CSlots) && (oldest > 0); i++) {
+    uint64_t e = s_slots[i].epoch.load(std::memory_order_seq_cst);
+    if ((e != 0) && (e < oldest)) oldest = e;
+  }
+
+  int left = 0;
+  retired_t **link = &s_retired;
+  while (*link != NULL) {
+    retired_t *r = *link;
+    if (r->epoch <= oldest) {
+      *link = r->next;
+      r->release(r->ptr);
+      delete r;
+    } else {
+      link = &r->next;
+      left++;
+    }
+  }
+  return left;
+}
@@ -0,0 +1,181 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logFormat.cpp
+/// @brief Implementation of the LogFormat type-safe message formatter
+
+#include "logFormat.h"
+#include <string.h>
+#include <math.h>
+
+static const char s_digits[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+static const char s_hex[] = "0123456789abcdef";
+
+static const uint64_t s_pow10[] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL
+};
+
+static const int CDefaultPrecision = 6;   ///< max decimals of a float without precision
+
+/// write the digits of \a val right aligned ending at \a end, return the first digit
+static inline char *digitsBackward(char *end, uint64_t val) {
+  while (val >= 100) {
+    int i = (int)(val % 100) * 2;
+    val /= 100;
+    *--end = s_digits[i + 1];
+    *--end = s_digits[i];
+  }
+  if (val >= 10) {
+    int i = (int)val * 2;
+    *--end = s_digits[i + 1];
+    *--end = s_digits[i];
+  } else {
+    *--end = (char)('0' + val);
+  }
+  return end;
+}
+
+char *LogFormat::literal(char *pos, char *end, const char **fmt) {
+
+  const char *f = *fmt;
+
+  while (*f != '\0') {
+    if ((f[0] == '{') || (f[0] == '}')) {
+      if (f[1] != f[0]) break;  // a placeholder
+      f++;                      // an escaped brace
+    }
+    if (pos < end) *pos++ = *f;
+    f++;
+  }
+  *fmt = f;
+  return pos;
+}
+
+char *LogFormat::putStr(char *pos, char *end, const char *str, size_t len) {
+
+  if (len == SIZE_MAX) {
+    // null terminated, copy what fits
+    while ((pos < end) && (*str != '\0')) *pos++ = *str++;
+    return pos;
+  }
+  if (len > (size_t)(end - pos)) len = end - pos;
+  memcpy(pos, str, len);
+  return pos + len;
+}
+
+char *LogFormat::putUint(char *pos, char *end, uint64_t val, bool hex) {
+
+  char buf[24];
+  char *first = buf + sizeof(buf);
+
+  if (hex) {
+    do {
+      *--first = s_hex[val & 0xf];
+      val >>= 4;
+    } while (val != 0);
+  } else {
+    first = digitsBackward(first, val);
+  }
+  return putStr(pos, end, first, buf + sizeof(buf) - first);
+}
+
+char *LogFormat::putInt(char *pos, char *end, int64_t val, bool hex) {
+
+  if (val >= 0) return putUint(pos, end, (uint64_t)val, hex);
+  if (pos < end) *pos++ = '-';
+  return putUint(pos, end, 0 - (uint64_t)val, hex);
+}
+
+char *LogFormat::putPtr(char *pos, char *end, const void *ptr) {
+
+  if (ptr == NULL) return putStr(pos, end, "(nil)", 5);
+  pos = putStr(pos, end, "0x", 2);
+  return putUint(pos, end, (uint64_t)(uintptr_t)ptr, true);
+}
+
+char *LogFormat::putFloat(char *pos, char *end, double val, int prec) {
+
+  char buf[48];
+  char *p = buf;
+  int  exp = 0;
+  int  digits = (prec < 0) ? CDefaultPrecision : prec;
+  bool sci = false;
+
+  if (isnan(val)) return putStr(pos, end, "nan", 3);
+  if (signbit(val) && (val != 0.0)) {
+    *p++ = '-';
+    val = -val;
+  }
+  if (isinf(val)) {
+    p = (char*)memcpy(p, "inf", 3) + 3;
+    return putStr(pos, end, buf, p - buf);
+  }
+
+  // too large for the integer part or too small for the default decimals, switch to scientific notation
+  if ((val >= 1e18) || ((prec < 0) && (val != 0.0) && (val < 1e-4))) {
+    sci = true;
+    exp = (int)floor(log10(val));
+    val /= pow(10.0, exp);
+    if (val >= 10.0) {
+      val /= 10.0;
+      exp++;
+    } else if (val < 1.0) {
+      val *= 10.0;
+      exp--;
+    }
+  }
+
+  uint64_t scale = s_pow10[digits];
+  uint64_t ip = (uint64_t)val;
+  uint64_t fp = (uint64_t)((val - (double)ip) * (double)scale + 0.5);
+  if (fp >= scale) {
+    ip++;
+    fp -= scale;
+    // rounding 9.99.. up gives a mantissa of 10, which is 1 with the next exponent
+    if (sci && (ip == 10)) {
+      ip = 1;
+      fp /= 10;
+      exp++;
+    }
+  }
+
+  char num[24];
+  char *first = digitsBackward(num + sizeof(num), ip);
+  size_t len = num + sizeof(num) - first;
+  memcpy(p, first, len);
+  p += len;
+
+  // without precision trailing zeros are dropped
+  if (prec < 0) {
+    while ((digits > 0) && (fp % 10 == 0)) {
+      fp /= 10;
+      digits--;
+    }
+  }
+  if (digits > 0) {
+    *p++ = '.';
+    char *fend = p + digits;
+    char *ffirst = digitsBackward(fend, fp);
+    while (ffirst > p) *--ffirst = '0';
+    p = fend;
+  }
+
+  if (sci) {
+    *p++ = 'e';
+    *p++ = (exp < 0) ? '-' : '+';
+    first = digitsBackward(num + sizeof(num), (exp < 0) ? -exp : exp);
+    len = num + sizeof(num) - first;
+    memcpy(p, first, len);
+    p += len;
+  }
+  return putStr(pos, end, buf, p - buf);
+}
@@ -0,0 +1,256 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logJson.cpp
+/// @brief Implementation of the LogJson class
+
+#include "logJson.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+static const char CHexDigits[] = "0123456789abcdef";
+
+/// Return true if \a c must be escaped in a JSON string
+static inline bool special(unsigned char c) {
+  return (c < 0x20) || (c == '"') || (c == '\\');
+}
+
+/// Write the escape sequence of \a c
+static char *putEscape(char *pos, const char *end, unsigned char c) {
+
+  char esc = 0;
+  switch (c) {
+    case '"':  esc = '"';  break;
+    case '\\': esc = '\\'; break;
+    case '\b': esc = 'b';  break;
+    case '\f': esc = 'f';  break;
+    case '\n': esc = 'n';  break;
+    case '\r': esc = 'r';  break;
+    case '\t': esc = 't';  break;
+    default:   break;
+  }
+  if (esc != 0) {
+    if (end - pos < 2) return NULL;
+    pos[0] = '\\';
+    pos[1] = esc;
+    return pos + 2;
+  }
+  if (end - pos < 6) return NULL;
+  memcpy(pos, "\\u00", 4);
+  pos[4] = CHexDigits[c >> 4];
+  pos[5] = CHexDigits[c & 0xf];
+  return pos + 6;
+}
+
+static char *putRaw(char *pos, const char *end, const char *str, size_t len) {
+  if (len > (size_t)(end - pos)) return NULL;
+  memcpy(pos, str, len);
+  return pos + len;
+}
+
+char *LogJson::escapeScalar(char *pos, const char *end, const char *str, size_t len) {
+
+  const unsigned char *s = (const unsigned char*)str;
+  const unsigned char *e = s + len;
+
+  while (s < e) {
+    if (!special(*s)) {
+      if (pos >= end) return NULL;
+      *pos++ = *s++;
+      continue;
+    }
+    if ((pos = putEscape(pos, end, *s++)) == NULL) return NULL;
+  }
+  return pos;
+}
+
+char *LogJson::escape(char *pos, const char *end, const char *str, size_t len) {
+
+  const char *s = str;
+  const char *e = str + len;
+
+  // whole blocks are stored right away, the bytes from the first special one on are overwritten
+#if defined(__AVX2__)
+  const __m256i quote32  = _mm256_set1_epi8('"');
+  const __m256i bslash32 = _mm256_set1_epi8('\\');
+  const __m256i ctl32    = _mm256_set1_epi8(0x1f);
+  while ((e - s >= 32) && (end - pos >= 32)) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)s);
+    __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, bslash32)),
+                                _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctl32), ctl32));
+    uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+    _mm256_storeu_si256((__m256i*)pos, v);
+    if (mask == 0) {
+      s += 32;
+      pos += 32;
+      continue;
+    }
+    int n = __builtin_ctz(mask);
+    s += n;
+    if ((pos = putEscape(pos + n, end, (unsigned char)*s++)) == NULL) return NULL;
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i quote  = _mm_set1_epi8('"');
+  const __m128i bslash = _mm_set1_epi8('\\');
+  const __m128i ctl    = _mm_set1_epi8(0x1f);
+  while ((e - s >= 16) && (end - pos >= 16)) {
+    __m128i v = _mm_loadu_si128((const __m128i*)s);
+    // bytes up to 0x1f are those unchanged by an unsigned max with 0x1f
+    __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                             _mm_cmpeq_epi8(_mm_max_epu8(v, ctl), ctl));
+    uint32_t mask = (uint32_t)_mm_movemask_epi8(m);
+    _mm_storeu_si128((__m128i*)pos, v);
+    if (mask == 0) {
+      s += 16;
+      pos += 16;
+      continue;
+    }
+    int n = __builtin_ctz(mask);
+    s += n;
+    if ((pos = putEscape(pos + n, end, (unsigned char)*s++)) == NULL) return NULL;
+  }
+#endif
+  return escapeScalar(pos, end, s, e - s);
+}
+
+char *LogJson::json(char *pos, const char *end, const char *msg, size_t len, const fields_t *fields) {
+
+  if (pos >= end) return NULL;
+  *pos++ = '"';
+  if ((pos = escape(pos, end, msg, len)) == NULL) return NULL;
+  if (pos >= end) return NULL;
+  *pos++ = '"';
+
+  for (int i = 0; (fields != NULL) && (i < fields->cnt); i++) {
+    const field_t *f = &fields->list[i];
+    if (end - pos < 2) return NULL;
+    *pos++ = ',';
+    *pos++ = '"';
+    if ((pos = escape(pos, end, f->key, strlen(f->key))) == NULL) return NULL;
+    if ((pos = putRaw(pos, end, "\":", 2)) == NULL) return NULL;
+    if ((pos = jsonValue(pos, end, f)) == NULL) return NULL;
+  }
+  return pos;
+}
+
+char *LogJson::text(char *pos, const char *end, const char *msg, size_t len, const fields_t *fields) {
+
+  if ((pos = putRaw(pos, end, msg, len)) == NULL) return NULL;
+
+  for (int i = 0; (fields != NULL) && (i < fields->cnt); i++) {
+    const field_t *f = &fields->list[i];
+    if (pos >= end) return NULL;
+    *pos++ = ' ';
+    if ((pos = putRaw(pos, end, f->key, strlen(f->key))) == NULL) return NULL;
+    if (pos >= end) return NULL;
+    *pos++ = '=';
+
+    if (f->type != EFieldString) {
+      pos = jsonValue(pos, end, f);
+    } else {
+      // plain words go out as they are
+      bool quote = (f->val.s.len == 0);
+      for (size_t k = 0; (k < f->val.s.len) && !quote; k++) {
+        unsigned char c = f->val.s.ptr[k];
+        quote = special(c) || (c == ' ') || (c == '=');
+      }
+      pos = quote ? jsonValue(pos, end, f) : putRaw(pos, end, f->val.s.ptr, f->val.s.len);
+    }
+    if (pos == NULL) return NULL;
+  }
+  return pos;
+}
+
+size_t LogJson::maxLen(size_t len, const fields_t *fields) {
+
+  // every byte may become a \u00XX escape, numbers take at most 24 characters
+  size_t max = 2 + 6 * len;
+  for (int i = 0; (fields != NULL) && (i < fields->cnt); i++) {
+    const field_t *f = &fields->list[i];
+    max += 4 + 6 * strlen(f->key) + ((f->type == EFieldString) ? 2 + 6 * f->val.s.len : 32);
+  }
+  return max;
+}
+
+char *LogJson::jsonValue(char *pos, const char *end, const field_t *f) {
+
+  switch (f->type) {
+    case EFieldString:
+      if (pos >= end) return NULL;
+      *pos++ = '"';
+      if ((pos = escape(pos, end, f->val.s.ptr, f->val.s.len)) == NULL) return NULL;
+      if (pos >= end) return NULL;
+      *pos++ = '"';
+      return pos;
+    case EFieldInt:    return putInt(pos, end, f->val.i);
+    case EFieldUint:   return putUint(pos, end, f->val.u);
+    case EFieldDouble: return putDouble(pos, end, f->val.d);
+    case EFieldBool:   return f->val.b ? putRaw(pos, end, "true", 4) : putRaw(pos, end, "false", 5);
+    default:           return putRaw(pos, end, "null", 4);
+  }
+}
+
+char *LogJson::putUint(char *pos, const char *end, uint64_t v) {
+
+  char tmp[20];
+  int n = 0;
+  do {
+    tmp[n++] = '0' + (v % 10);
+    v /= 10;
+  } while (v != 0);
+
+  if (n > end - pos) return NULL;
+  while (n > 0) *pos++ = tmp[--n];
+  return pos;
+}
+
+char *LogJson::putInt(char *pos, const char *end, int64_t v) {
+
+  if (v >= 0) return putUint(pos, end, (uint64_t)v);
+  if (pos >= end) return NULL;
+  *pos++ = '-';
+  return putUint(pos, end, (uint64_t)0 - (uint64_t)v);
+}
+
+char *LogJson::putDouble(char *pos, const char *end, double v) {
+
+  if (!isfinite(v)) return putRaw(pos, end, "null", 4);
+
+  // up to 6 decimals without printf: the decimal k/10^6 reads back as the correctly rounded k / 1e6,
+  // so it is exact if that division gives v
+  if (fabs(v) < 1e9) {
+    double scaled = v * 1e6;
+    int64_t k = (int64_t)scaled;
+    if (((double)k == scaled) && ((double)k / 1e6 == v)) {
+      uint64_t a = (k < 0) ? (uint64_t)-k : (uint64_t)k;
+      uint64_t frac = a % 1000000;
+      if ((k < 0) && ((pos = putRaw(pos, end, "-", 1)) == NULL)) return NULL;
+      if ((pos = putUint(pos, end, a / 1000000)) == NULL) return NULL;
+      if (frac == 0) return pos;
+
+      char digits[7] = { '.' };
+      int n = 6;
+      while (frac % 10 == 0) {
+        frac /= 10;
+        n--;
+      }
+      for (int i = n; i > 0; i--, frac /= 10) digits[i] = '0' + (frac % 10);
+      return putRaw(pos, end, digits, n + 1);
+    }
+  }
+
+  char tmp[32];
+  int n = snprintf(tmp, sizeof(tmp), "%.15g", v);
+  if (strtod(tmp, NULL) != v) n = snprintf(tmp, sizeof(tmp), "%.17g", v);
+  return putRaw(pos, end, tmp, n);
+}
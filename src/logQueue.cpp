@@ -0,0 +1,89 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logQueue.cpp
+/// @brief Implementation of the LogQueue class
+
+#include "logQueue.h"
+#include <stdint.h>
+
+LogQueue::LogQueue(int len) {
+
+  size_t cap = 2;
+  while ((int)cap < len) cap <<= 1;
+
+  m_mask = cap - 1;
+  m_ring = new record_t[cap];
+  for (size_t i = 0; i < cap; i++) {
+    m_ring[i].seq.store(i, std::memory_order_relaxed);
+    m_ring[i].len = 0;
+  }
+  m_head.store(0, std::memory_order_relaxed);
+  m_tail.store(0, std::memory_order_relaxed);
+}
+
+LogQueue::~LogQueue() {
+  delete[] m_ring;
+}
+
+LogQueue::record_t *LogQueue::reserve(size_t *pos, size_t cnt) {
+
+  size_t p = m_head.load(std::memory_order_relaxed);
+
+  if ((cnt == 0) || (cnt > m_mask + 1)) return NULL;
+
+  for (;;) {
+    record_t *rec = &m_ring[p & m_mask];
+    intptr_t dif = (intptr_t)rec->seq.load(std::memory_order_acquire) - (intptr_t)p;
+
+    if (dif == 0) {
+      // the consumer frees slots in order, so if the last one is free all of them are
+      if (cnt > 1) {
+        size_t last = p + cnt - 1;
+        if ((intptr_t)m_ring[last & m_mask].seq.load(std::memory_order_acquire) - (intptr_t)last < 0) return NULL;
+      }
+      // slots are free, try to claim them
+      if (m_head.compare_exchange_weak(p, p + cnt, std::memory_order_relaxed)) {
+        *pos = p;
+        return rec;
+      }
+    } else if (dif < 0) {
+      // slot still holds a record from the previous lap
+      return NULL;
+    } else {
+      // another producer claimed it first
+      p = m_head.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void LogQueue::commit(record_t *rec, size_t pos) {
+  rec->seq.store(pos + 1, std::memory_order_release);
+}
+
+LogQueue::record_t *LogQueue::peek(size_t ahead) {
+  size_t t = m_tail.load(std::memory_order_relaxed) + ahead;
+  record_t *rec = &m_ring[t & m_mask];
+
+  if ((ahead > m_mask) || (rec->seq.load(std::memory_order_acquire) != t + 1)) return NULL;
+  return rec;
+}
+
+void LogQueue::release(size_t cnt) {
+  size_t t = m_tail.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < cnt; i++, t++) {
+    m_ring[t & m_mask].seq.store(t + m_mask + 1, std::memory_order_release);
+  }
+  m_tail.store(t, std::memory_order_release);
+}
+
+size_t LogQueue::space(void) {
+  size_t h = m_head.load(std::memory_order_relaxed);
+  size_t t = m_tail.load(std::memory_order_relaxed);
+  return (h - t > m_mask) ? 0 : (m_mask + 1) - (h - t);
+}
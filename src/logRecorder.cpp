@@ -0,0 +1,296 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logRecorder.cpp
+/// @brief Implementation of the LogRecorder class
+
+#include "logRecorder.h"
+#include "logBinary.h"
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// offsets into an encoded log record, see LogBinary
+static const int COffId    = 1;
+static const int COffLevel = 1 + 4;
+static const int COffTime  = 1 + 4 + 1 + 4;
+static const int COffArgs  = 1 + 4 + 1 + 4 + 8 + 2;
+
+LogBinary            *LogRecorder::s_binary = NULL;
+std::atomic<LogRecorder::ring_t*> LogRecorder::s_rings[CMaxRings];
+std::atomic<int>      LogRecorder::s_ringCnt(0);
+int                   LogRecorder::s_len = 0;
+std::mutex            LogRecorder::s_lock;
+char                  LogRecorder::s_crashFile[CfgLog::CMaxPathLen];
+std::atomic<bool>     LogRecorder::s_crashed(false);
+
+/// Releases the ring of a thread when it exits
+typedef struct ringOwner {
+  std::atomic<long> *owner;   ///< owner field of the ring, NULL if the thread has none
+  ~ringOwner() { if (owner != NULL) owner->store(0, std::memory_order_release); }
+} ringOwner_t;
+
+static thread_local ringOwner_t s_owner = { NULL };
+
+/// State of a text dump
+typedef struct textDump {
+  Logger      *out;                                 ///< where to render to
+  const char **dict;                                ///< format strings by id
+  int64_t      offset;                              ///< monotonic minus wall clock time in ns
+} textDump_t;
+
+void LogRecorder::enable(int records, const char *crashFile) {
+
+  std::lock_guard<std::mutex> lock(s_lock);
+
+  if (s_binary == NULL) {
+    int len = 2;
+    while (len < records) len <<= 1;
+    s_len = len;
+    s_binary = new LogBinary();
+  }
+
+  if ((crashFile != NULL) && (crashFile[0] != '\0') && (s_crashFile[0] == '\0')) {
+    strncpy(s_crashFile, crashFile, sizeof(s_crashFile) - 1);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sa.sa_flags = SA_RESETHAND | SA_NODEFER;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, NULL);
+    sigaction(SIGABRT, &sa, NULL);
+  }
+}
+
+LogRecorder::ring_t *LogRecorder::ring(void) {
+
+  static thread_local ring_t *mine = NULL;
+  if (mine != NULL) return mine;
+
+  long tid = syscall(SYS_gettid);
+
+  // take over the ring of a thread that has exited
+  int cnt = s_ringCnt.load(std::memory_order_acquire);
+  for (int i = 0; i < cnt; i++) {
+    ring_t *r = s_rings[i].load(std::memory_order_acquire);
+    long free = 0;
+    if ((r != NULL) && r->owner.compare_exchange_strong(free, tid)) {
+      mine = r;
+      break;
+    }
+  }
+
+  if (mine == NULL) {
+    int i = s_ringCnt.load(std::memory_order_relaxed);
+    do {
+      if (i >= CMaxRings) return NULL;
+    } while (!s_ringCnt.compare_exchange_weak(i, i + 1));
+
+    ring_t *r = new ring_t;
+    r->owner.store(tid, std::memory_order_relaxed);
+    r->head.store(0, std::memory_order_relaxed);
+    r->slots = new slot_t[s_len];
+    for (int k = 0; k < s_len; k++) r->slots[k].seq.store(0, std::memory_order_relaxed);
+    // a dump between the claim and here sees no ring yet
+    s_rings[i].store(r, std::memory_order_release);
+    mine = r;
+  }
+
+  s_owner.owner = &mine->owner;
+  return mine;
+}
+
+void LogRecorder::record(const Logger *owner, CfgLog::level_e lev, const char *fmt, va_list args) {
+
+  ring_t *r = ring();
+  if (r == NULL) return;
+
+  uint64_t pos = r->head.load(std::memory_order_relaxed);
+  slot_t *s = &r->slots[pos & (s_len - 1)];
+  struct timespec ts;
+  char dict[LogBinary::CMaxFormatRecLen];
+  int  dictLen = sizeof(dict);
+
+  // readers drop the slot while the sequence number is odd
+  s->seq.store(2 * pos + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  s->owner = owner->m_recId;
+  s->len = s_binary->encode(s->rec, sizeof(s->rec), dict, &dictLen, lev, r->owner.load(std::memory_order_relaxed), &ts, fmt, args);
+
+  s->seq.store(2 * pos + 2, std::memory_order_release);
+  r->head.store(pos + 1, std::memory_order_release);
+}
+
+void LogRecorder::recordf(const Logger *owner, CfgLog::level_e lev, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  record(owner, lev, fmt, args);
+  va_end(args);
+}
+
+int LogRecorder::merge(cursor_t *cur, uint32_t owner, emit_t emit, void *arg) {
+
+  int cnt = s_ringCnt.load(std::memory_order_acquire);
+  if (cnt > CMaxRings) cnt = CMaxRings;
+  int total = 0;
+
+  for (;;) {
+    int best = -1;
+    uint64_t bestNs = 0;
+
+    // the oldest next record of all rings, slots being rewritten and records of other Loggers are skipped
+    for (int i = 0; i < cnt; i++) {
+      ring_t *r = s_rings[i].load(std::memory_order_acquire);
+      while ((r != NULL) && (cur[i].pos < cur[i].end)) {
+        slot_t *s = &r->slots[cur[i].pos & (s_len - 1)];
+        uint64_t seq = s->seq.load(std::memory_order_acquire);
+        uint64_t ns;
+        uint32_t id = s->owner;
+        memcpy(&ns, s->rec + COffTime, sizeof(ns));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((seq == 2 * cur[i].pos + 2) && (s->seq.load(std::memory_order_relaxed) == seq) && (s->len >= COffArgs) &&
+            ((owner == 0) || (id == owner))) {
+          if ((best < 0) || (ns < bestNs)) {
+            best = i;
+            bestNs = ns;
+          }
+          break;
+        }
+        cur[i].pos++;
+      }
+    }
+    if (best < 0) return total;
+
+    // copy the record out, the owner may overwrite it meanwhile
+    ring_t *r = s_rings[best].load(std::memory_order_relaxed);
+    slot_t *s = &r->slots[cur[best].pos & (s_len - 1)];
+    char rec[CSlotLen];
+    uint64_t seq = s->seq.load(std::memory_order_acquire);
+    int len = s->len;
+    if (len > CSlotLen) len = CSlotLen;
+    memcpy(rec, s->rec, len);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((seq == 2 * cur[best].pos + 2) && (s->seq.load(std::memory_order_relaxed) == seq)) {
+      emit(arg, rec, len);
+      total++;
+    }
+    cur[best].pos++;
+  }
+}
+
+int LogRecorder::dump(Logger *out) {
+
+  std::lock_guard<std::mutex> lock(s_lock);
+  if (s_binary == NULL) return 0;
+
+  static cursor_t cur[CMaxRings];
+  const char **dict = new const char*[LogBinary::CMaxFormats + 1];
+  int cnt = s_ringCnt.load(std::memory_order_acquire);
+  if (cnt > CMaxRings) cnt = CMaxRings;
+
+  // format strings by id, records only refer to registered ones
+  for (int i = 0; i <= LogBinary::CMaxFormats; i++) dict[i] = NULL;
+  dict[LogBinary::CTextId] = "%s";
+  for (int i = 0; i < LogBinary::CMaxFormats; i++) {
+    const LogBinary::format_t *f = &s_binary->m_formats[i];
+    if (f->ready.load(std::memory_order_acquire) && (f->id != LogBinary::CTextId) && (f->id <= (uint32_t)LogBinary::CMaxFormats)) {
+      dict[f->id] = f->text;
+    }
+  }
+
+  // each Logger remembers how far it has dumped each ring
+  if (out->m_recDumped == NULL) out->m_recDumped = new uint64_t[CMaxRings]();
+  for (int i = 0; i < cnt; i++) {
+    ring_t *r = s_rings[i].load(std::memory_order_acquire);
+    cur[i].end = (r != NULL) ? r->head.load(std::memory_order_acquire) : 0;
+    cur[i].pos = (cur[i].end > (uint64_t)s_len) ? cur[i].end - s_len : 0;
+    if (cur[i].pos < out->m_recDumped[i]) cur[i].pos = out->m_recDumped[i];
+  }
+
+  struct timespec real, mono;
+  clock_gettime(CLOCK_REALTIME, &real);
+  clock_gettime(CLOCK_MONOTONIC, &mono);
+  textDump_t td;
+  td.out  = out;
+  td.dict = dict;
+  td.offset = ((int64_t)mono.tv_sec - real.tv_sec) * 1000000000LL + (mono.tv_nsec - real.tv_nsec);
+
+  int total = merge(cur, out->m_recId, emitText, &td);
+
+  for (int i = 0; i < cnt; i++) out->m_recDumped[i] = cur[i].end;
+  delete[] dict;
+  return total;
+}
+
+void LogRecorder::emitText(void *arg, const char *rec, int len) {
+
+  const textDump_t *td = (const textDump_t*)arg;
+  static char text[CfgLog::CMaxLogMsgLen];
+  uint32_t id, tid;
+  uint8_t  level;
+  uint64_t ns;
+
+  memcpy(&id, rec + COffId, sizeof(id));
+  memcpy(&level, rec + COffLevel, sizeof(level));
+  memcpy(&tid, rec + COffLevel + 1, sizeof(tid));
+  memcpy(&ns, rec + COffTime, sizeof(ns));
+  if ((id > (uint32_t)LogBinary::CMaxFormats) || (td->dict[id] == NULL)) return;
+
+  Logger::recCtx_t ctx;
+  uint64_t mono = ns + td->offset;
+  ctx.real.tv_sec  = ns / 1000000000ULL;
+  ctx.real.tv_nsec = ns % 1000000000ULL;
+  ctx.mono.tv_sec  = mono / 1000000000ULL;
+  ctx.mono.tv_nsec = mono % 1000000000ULL;
+  ctx.pid = getpid();
+  ctx.tid = tid;
+
+  int n = LogBinary::format(text, sizeof(text), td->dict[id], rec + COffArgs, len - COffArgs);
+  if (level > CfgLog::ELogAlways) level = CfgLog::ELogAlways;
+  td->out->replayRecord((CfgLog::level_e)level, &ctx, text, n);
+}
+
+void LogRecorder::dumpBinary(int fd) {
+
+  static cursor_t cur[CMaxRings];
+  if (s_binary == NULL) return;
+
+  int cnt = s_ringCnt.load(std::memory_order_acquire);
+  if (cnt > CMaxRings) cnt = CMaxRings;
+  for (int i = 0; i < cnt; i++) {
+    ring_t *r = s_rings[i].load(std::memory_order_acquire);
+    cur[i].end = (r != NULL) ? r->head.load(std::memory_order_acquire) : 0;
+    cur[i].pos = (cur[i].end > (uint64_t)s_len) ? cur[i].end - s_len : 0;
+  }
+
+  (void)s_binary->writeDictionary(fd);
+  (void)merge(cur, 0, emitRaw, &fd);
+}
+
+void LogRecorder::emitRaw(void *arg, const char *rec, int len) {
+  if (write(*(int*)arg, rec, len) < 0) return;
+}
+
+void LogRecorder::onSignal(int sig) {
+
+  // a crash while dumping must not dump again
+  if (!s_crashed.exchange(true)) {
+    int fd = open(s_crashFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+      dumpBinary(fd);
+      close(fd);
+    }
+  }
+  // the default action is restored, let it terminate the process
+  raise(sig);
+}
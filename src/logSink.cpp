@@ -0,0 +1,590 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logSink.cpp
+/// @brief Implementation of the LogSink output backends
+
+#include "logSink.h"
+#include "logTime.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <thread>
+
+#ifndef IOV_MAX
+  #define IOV_MAX 1024
+#endif
+
+FdSink::FdSink(const char *path, bool batch, int bufSize, bool append) {
+  m_fd = open(path, O_WRONLY | O_CREAT | (append ? 0 : O_TRUNC) | O_APPEND | O_CLOEXEC, 0644);
+  m_ownFd = true;
+  if (m_fd < 0) {
+    fprintf(stderr, "Failed to open logfile @ %s: %d\n", path, errno);
+  }
+  initBuffer(batch, bufSize);
+}
+
+FdSink::FdSink(int fd, bool batch, int bufSize) {
+  m_fd = fd;
+  m_ownFd = false;
+  initBuffer(batch, bufSize);
+}
+
+FdSink::~FdSink() {
+  flush();
+  if (m_ownFd && (m_fd >= 0)) {
+    if (close(m_fd) != 0) {
+      fprintf(stderr, "Failed to close logfile\n");
+    }
+  }
+  delete[] m_buf;
+}
+
+void FdSink::initBuffer(bool batch, int bufSize) {
+  m_buf = NULL;
+  m_bufSize = 0;
+  m_bufLen = 0;
+  if (batch && (bufSize > 0)) {
+    m_buf = new char[bufSize];
+    m_bufSize = bufSize;
+  }
+}
+
+int FdSink::write(const struct iovec *iov, int cnt) {
+
+  if (m_fd < 0) return EErr;
+  if (m_buf == NULL) return writeAll(iov, cnt);
+
+  size_t len = 0;
+  for (int i = 0; i < cnt; i++) len += iov[i].iov_len;
+
+  // keep records whole: write out what we have if this one doesn't fit anymore
+  if (m_bufLen + len > (size_t)m_bufSize) {
+    if (flush() != ENoErr) return EErr;
+    if (len > (size_t)m_bufSize) return writeAll(iov, cnt);
+  }
+
+  for (int i = 0; i < cnt; i++) {
+    memcpy(&m_buf[m_bufLen], iov[i].iov_base, iov[i].iov_len);
+    m_bufLen += iov[i].iov_len;
+  }
+  return ENoErr;
+}
+
+int FdSink::flush(void) {
+
+  if ((m_buf == NULL) || (m_bufLen == 0)) return ENoErr;
+
+  struct iovec iov;
+  iov.iov_base = m_buf;
+  iov.iov_len  = m_bufLen;
+  m_bufLen = 0;
+  return writeAll(&iov, 1);
+}
+
+int FdSink::writeAll(const struct iovec *iov, int cnt) {
+
+  struct iovec vec[IOV_MAX];
+  int done = 0;
+
+  while (done < cnt) {
+    int n = (cnt - done > IOV_MAX) ? IOV_MAX : cnt - done;
+    memcpy(vec, &iov[done], n * sizeof(struct iovec));
+
+    struct iovec *cur = vec;
+    while (n > 0) {
+      ssize_t ret = writev(m_fd, cur, n);
+      if (ret < 0) {
+        if (errno == EINTR) continue;
+        return EErr;
+      }
+
+      // skip what was written, continue with the rest after a partial write
+      while ((n > 0) && ((size_t)ret >= cur->iov_len)) {
+        ret -= cur->iov_len;
+        cur++;
+        n--;
+        done++;
+      }
+      if (n > 0) {
+        cur->iov_base = (char*)cur->iov_base + ret;
+        cur->iov_len -= ret;
+      }
+    }
+  }
+  return ENoErr;
+}
+
+MmapSink::MmapSink(const char *path, size_t chunkSize, bool append) {
+
+  size_t page = sysconf(_SC_PAGESIZE);
+
+  m_chunk = ((chunkSize + page - 1) / page) * page;
+  if (m_chunk == 0) m_chunk = page;
+  m_windows[0].base = NULL;
+  m_windows[1].base = NULL;
+  m_win    = &m_windows[0];
+  m_cursor = 0;
+  m_users  = 0;
+
+  m_fd = open(path, O_RDWR | O_CREAT | (append ? 0 : O_TRUNC) | O_CLOEXEC, 0644);
+  if (m_fd < 0) {
+    fprintf(stderr, "Failed to open logfile @ %s: %d\n", path, errno);
+    return;
+  }
+
+  // continue behind the existing content
+  struct stat st;
+  if (append && (fstat(m_fd, &st) == 0)) m_cursor = st.st_size;
+  m_synced = m_cursor;
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (mapWindow(m_cursor) == NULL) {
+    close(m_fd);
+    m_fd = -1;
+  }
+}
+
+MmapSink::~MmapSink() {
+
+  if (m_fd < 0) return;
+
+  flush();
+  for (int i = 0; i < 2; i++) {
+    if (m_windows[i].base != NULL) munmap(m_windows[i].base, m_chunk);
+  }
+
+  // drop the preallocated but unused tail
+  if (ftruncate(m_fd, m_cursor) != 0) {
+    fprintf(stderr, "Failed to truncate logfile: %d\n", errno);
+  }
+  if (close(m_fd) != 0) {
+    fprintf(stderr, "Failed to close logfile\n");
+  }
+}
+
+int MmapSink::write(const struct iovec *iov, int cnt) {
+
+  size_t len = 0;
+  for (int i = 0; i < cnt; i++) len += iov[i].iov_len;
+
+  if (m_fd < 0) return EErr;
+
+  uint64_t off = m_cursor.fetch_add(len);
+
+  // fast path: the record lies within the current window
+  m_users.fetch_add(1);
+  window_t *win = m_win.load();
+  if ((off >= win->start) && (off + len <= win->start + m_chunk)) {
+    char *pos = win->base + (off - win->start);
+    for (int i = 0; i < cnt; i++) {
+      memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+      pos += iov[i].iov_len;
+    }
+    m_users.fetch_sub(1);
+    return ENoErr;
+  }
+  m_users.fetch_sub(1);
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  return copyLocked(off, iov, cnt);
+}
+
+int MmapSink::copyLocked(uint64_t off, const struct iovec *iov, int cnt) {
+
+  window_t *win = m_win.load();
+
+  for (int i = 0; i < cnt; i++) {
+    const char *src = (const char*)iov[i].iov_base;
+    size_t rem = iov[i].iov_len;
+
+    while (rem > 0) {
+      if ((off < win->start) || (off >= win->start + m_chunk)) {
+        if ((win = mapWindow(off)) == NULL) return EErr;
+      }
+      size_t n = win->start + m_chunk - off;
+      if (n > rem) n = rem;
+      memcpy(win->base + (off - win->start), src, n);
+      off += n;
+      src += n;
+      rem -= n;
+    }
+  }
+  return ENoErr;
+}
+
+MmapSink::window_t *MmapSink::mapWindow(uint64_t off) {
+
+  window_t *cur  = m_win.load();
+  window_t *next = (cur == &m_windows[0]) ? &m_windows[1] : &m_windows[0];
+  uint64_t start = (off / m_chunk) * m_chunk;
+
+  // make sure the chunk is backed by the file
+  int ret = fallocate(m_fd, 0, start, m_chunk);
+  if ((ret != 0) && (errno == EOPNOTSUPP)) {
+    struct stat st;
+    ret = 0;
+    if ((fstat(m_fd, &st) == 0) && ((uint64_t)st.st_size < start + m_chunk)) {
+      ret = ftruncate(m_fd, start + m_chunk);
+    }
+  }
+  if (ret != 0) {
+    fprintf(stderr, "Failed to grow logfile: %d\n", errno);
+    return NULL;
+  }
+
+  // prefault the chunk so writers don't take page faults on the hot path
+  void *base = mmap(NULL, m_chunk, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, start);
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "Failed to map logfile: %d\n", errno);
+    return NULL;
+  }
+
+  // nobody references the previous window anymore, it was retired by the last move
+  if (next->base != NULL) munmap(next->base, m_chunk);
+  next->base  = (char*)base;
+  next->start = start;
+  m_win.store(next);
+
+  // wait for writers still copying through the old window before it is reused
+  while (m_users.load() != 0) {
+    std::this_thread::yield();
+  }
+  return next;
+}
+
+int MmapSink::flush(void) {
+
+  if (m_fd < 0) return EErr;
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  uint64_t end = m_cursor.load();
+  if (end <= m_synced) return ENoErr;
+
+  // records may still lie in the previous window, or in windows unmapped since the last sync
+  long cur  = syncWindow(m_win.load(), m_synced, end);
+  long prev = syncWindow((m_win.load() == &m_windows[0]) ? &m_windows[1] : &m_windows[0], m_synced, end);
+  if ((cur < 0) || (prev < 0)) return EErr;
+  if ((uint64_t)(cur + prev) < end - m_synced) {
+    if (fdatasync(m_fd) != 0) return EErr;
+  }
+  m_synced = end;
+  return ENoErr;
+}
+
+long MmapSink::syncWindow(const window_t *win, uint64_t from, uint64_t to) {
+
+  if (win->base == NULL) return 0;
+  if (from < win->start) from = win->start;
+  if (to > win->start + m_chunk) to = win->start + m_chunk;
+  if (to <= from) return 0;
+
+  // msync takes page aligned addresses, chunks start on a page
+  size_t page = sysconf(_SC_PAGESIZE);
+  uint64_t first = ((from - win->start) / page) * page;
+  if (msync(win->base + first, (to - win->start) - first, MS_SYNC) != 0) return -1;
+  return to - from;
+}
+
+RingSink::RingSink(int lines, int lineLen) {
+  m_lines   = (lines > 0) ? lines : 1;
+  m_lineLen = (lineLen > 0) ? lineLen : CLineLenDefault;
+  m_buf     = new char[(size_t)m_lines * m_lineLen];
+  m_len     = new int[m_lines];
+  m_next    = 0;
+}
+
+RingSink::~RingSink() {
+  delete[] m_buf;
+  delete[] m_len;
+}
+
+int RingSink::write(const struct iovec *iov, int cnt) {
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  int   idx = m_next++ % m_lines;
+  char *pos = &m_buf[(size_t)idx * m_lineLen];
+  int   len = 0;
+
+  for (int i = 0; (i < cnt) && (len < m_lineLen); i++) {
+    int n = iov[i].iov_len;
+    if (n > m_lineLen - len) n = m_lineLen - len;
+    memcpy(pos + len, iov[i].iov_base, n);
+    len += n;
+  }
+  m_len[idx] = len;
+  return ENoErr;
+}
+
+int RingSink::count(void) {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return (m_next < (uint64_t)m_lines) ? (int)m_next : m_lines;
+}
+
+int RingSink::dump(FILE *out) {
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  uint64_t first = (m_next < (uint64_t)m_lines) ? 0 : m_next - m_lines;
+
+  for (uint64_t i = first; i < m_next; i++) {
+    int idx = i % m_lines;
+    if (fwrite(&m_buf[(size_t)idx * m_lineLen], 1, m_len[idx], out) != (size_t)m_len[idx]) return EErr;
+  }
+  return ENoErr;
+}
+
+/// max number of records handed to one sendmmsg()
+static const int CSendMax = 64;
+
+/// Return a coarse monotonic timestamp in milliseconds
+static uint64_t nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/// Copy \a src as a syslog header field, at most \a max printable characters, "-" if it is empty
+static int addField(char *buf, const char *src, int max) {
+  int len = 0;
+  for (; (src != NULL) && (src[len] != '\0') && (len < max); len++) {
+    buf[len] = ((src[len] > ' ') && (src[len] < 127)) ? src[len] : '_';
+  }
+  if (len == 0) buf[len++] = '-';
+  return len;
+}
+
+SyslogSink::SyslogSink(const char *path, int facility, int batch, size_t bufLimit, const char *appName, int maxDelay) {
+
+  m_fd       = -1;
+  m_facility = ((facility >= 0) && (facility <= 23)) ? facility : CFacilityUser;
+  m_batch    = (batch > 0) ? batch : 1;
+  m_sendAt   = m_batch;
+  m_bufSize  = (bufLimit > sizeof(uint32_t) + CMaxRecordLen) ? bufLimit : sizeof(uint32_t) + CMaxRecordLen;
+  m_buf      = new char[m_bufSize];
+  m_head     = 0;
+  m_tail     = 0;
+  m_cnt      = 0;
+  m_retryAt  = 0;
+  m_maxDelay = (maxDelay > 0) ? maxDelay : 0;
+  m_sendBy   = UINT64_MAX;
+  m_dropped  = 0;
+  m_unreported = 0;
+  strncpy(m_path, path, sizeof(m_path) - 1);
+  m_path[sizeof(m_path) - 1] = '\0';
+
+  // everything between timestamp and msg is the same for all records
+  char host[256] = { 0 };
+  (void)gethostname(host, sizeof(host) - 1);
+  char *pos = m_ident;
+  *pos++ = ' ';
+  pos += addField(pos, host, 64);
+  *pos++ = ' ';
+  pos += addField(pos, (appName != NULL) ? appName : program_invocation_short_name, 48);
+  pos += sprintf(pos, " %d - - ", (int)getpid());
+  m_identLen = pos - m_ident;
+
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (connectLocked() != ENoErr) fprintf(stderr, "Failed to connect to %s: %d, buffering records\n", m_path, errno);
+}
+
+SyslogSink::~SyslogSink() {
+  {
+    std::lock_guard<std::mutex> lock(m_lock);
+    (void)sendLocked();
+  }
+  if (m_fd >= 0) close(m_fd);
+  delete[] m_buf;
+}
+
+bool SyslogSink::isConnected(void) {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return m_fd >= 0;
+}
+
+uint64_t SyslogSink::getDropped(void) {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return m_dropped;
+}
+
+int SyslogSink::writeRecord(int level, const struct iovec *iov, int cnt) {
+
+  std::lock_guard<std::mutex> lock(m_lock);
+
+  int ret = appendLocked(level, iov, cnt);
+  if (ret != ENoErr) {
+    // a full buffer may only be waiting for a batch to go out
+    (void)sendLocked();
+    ret = appendLocked(level, iov, cnt);
+  }
+  if (ret != ENoErr) {
+    m_dropped++;
+    m_unreported++;
+    return EErr;
+  }
+
+  // errors and more severe msgs do not wait for the batch to fill up, nor do records waiting too long
+  if ((m_cnt >= m_sendAt) || (level <= CSeverityError) || (nowMs() >= m_sendBy)) (void)sendLocked();
+  return ENoErr;
+}
+
+int SyslogSink::flush(void) {
+  std::lock_guard<std::mutex> lock(m_lock);
+  return sendLocked();
+}
+
+void SyslogSink::tick(void) {
+  std::lock_guard<std::mutex> lock(m_lock);
+  if (nowMs() >= m_sendBy) (void)sendLocked();
+}
+
+int SyslogSink::appendLocked(int level, const struct iovec *iov, int cnt) {
+
+  size_t msgLen = 0;
+  for (int i = 0; i < cnt; i++) msgLen += iov[i].iov_len;
+
+  // "<PRI>1 " and the timestamp come first
+  size_t hdrLen = 8 + LogTime::CMaxTimeLen + m_identLen;
+  size_t recLen = (hdrLen + msgLen < (size_t)CMaxRecordLen) ? hdrLen + msgLen : (size_t)CMaxRecordLen;
+  size_t need = sizeof(uint32_t) + recLen;
+
+  if ((m_tail + need > m_bufSize) && (m_head > 0)) {
+    memmove(m_buf, m_buf + m_head, m_tail - m_head);
+    m_tail -= m_head;
+    m_head = 0;
+  }
+  if (m_tail + need > m_bufSize) return EErr;
+
+  char *rec = m_buf + m_tail + sizeof(uint32_t);
+  char *pos = rec;
+  char *end = rec + recLen;
+
+  // the Logger levels up to debug are the syslog severities
+  int severity = ((level >= 0) && (level <= 7)) ? level : CSeverityNotice;
+  pos += sprintf(pos, "<%d>1 ", m_facility * 8 + severity);
+  struct timespec ts;
+  LogTime::now(LogTime::ETimeIso, &ts);
+  int n = LogTime::format(pos, LogTime::CMaxTimeLen, LogTime::ETimeIso, &ts);
+  if (n > 0) pos += n;
+  else *pos++ = '-';
+  memcpy(pos, m_ident, m_identLen);
+  pos += m_identLen;
+
+  for (int i = 0; (i < cnt) && (pos < end); i++) {
+    size_t len = iov[i].iov_len;
+    if (len > (size_t)(end - pos)) len = end - pos;
+    memcpy(pos, iov[i].iov_base, len);
+    pos += len;
+  }
+  // the datagram is the record, a line end is not part of the msg
+  while ((pos > rec) && ((pos[-1] == '\n') || (pos[-1] == '\r'))) pos--;
+
+  uint32_t len = pos - rec;
+  memcpy(m_buf + m_tail, &len, sizeof(len));
+  m_tail += sizeof(len) + len;
+  // the first record of a batch starts the clock
+  if (m_cnt++ == 0) m_sendBy = nowMs() + m_maxDelay;
+  return ENoErr;
+}
+
+int SyslogSink::connectLocked(void) {
+
+  uint64_t now = nowMs();
+  if (now < m_retryAt) return EErr;
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  // m_path is terminated already
+  static_assert(sizeof(addr.sun_path) == sizeof(m_path), "m_path must be as long as sun_path");
+  memcpy(addr.sun_path, m_path, sizeof(m_path));
+
+  // connecting a datagram socket only resolves the path, it never waits for the collector
+  m_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if ((m_fd < 0) || (connect(m_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)) {
+    if (m_fd >= 0) close(m_fd);
+    m_fd = -1;
+    m_retryAt = now + CRetryMs;
+    return EErr;
+  }
+  return ENoErr;
+}
+
+int SyslogSink::sendLocked(void) {
+
+  if (m_cnt == 0) return ENoErr;
+  if ((m_fd < 0) && (connectLocked() != ENoErr)) {
+    m_sendBy = m_retryAt;
+    return EErr;
+  }
+
+  struct mmsghdr msgs[CSendMax];
+  struct iovec   vec[CSendMax];
+
+  while (m_cnt > 0) {
+    int    n = 0;
+    size_t off = m_head;
+    memset(msgs, 0, sizeof(msgs));
+    for (; (n < m_cnt) && (n < CSendMax); n++) {
+      uint32_t len;
+      memcpy(&len, m_buf + off, sizeof(len));
+      vec[n].iov_base = m_buf + off + sizeof(len);
+      vec[n].iov_len  = len;
+      msgs[n].msg_hdr.msg_iov = &vec[n];
+      msgs[n].msg_hdr.msg_iovlen = 1;
+      off += sizeof(len) + len;
+    }
+
+    int sent = sendmmsg(m_fd, msgs, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      // the collector is busy, the records wait for another batch before trying again
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == ENOBUFS)) {
+        m_sendAt = m_cnt + m_batch;
+        m_sendBy = nowMs() + m_maxDelay;
+        return EErr;
+      }
+      if (errno == EMSGSIZE) {
+        // a record the collector will never take must not hold up the others
+        sent = 1;
+        m_dropped++;
+      } else {
+        // the collector is gone, e.g. restarted with a fresh socket
+        close(m_fd);
+        m_fd = -1;
+        m_retryAt = nowMs() + CRetryMs;
+        m_sendBy  = m_retryAt;
+        return EErr;
+      }
+    }
+    for (int i = 0; i < sent; i++) m_head += sizeof(uint32_t) + vec[i].iov_len;
+    m_cnt -= sent;
+
+    // the records kept through an outage are out, tell the collector about the rest
+    if ((m_cnt == 0) && (m_unreported > 0)) {
+      char msg[64];
+      struct iovec warn = { msg, (size_t)snprintf(msg, sizeof(msg), "syslog sink dropped %llu records", (unsigned long long)m_unreported) };
+      m_head = 0;
+      m_tail = 0;
+      (void)appendLocked(CSeverityWarning, &warn, 1);
+      m_unreported = 0;
+    }
+  }
+  m_head = 0;
+  m_tail = 0;
+  m_sendAt = m_batch;
+  m_sendBy = UINT64_MAX;
+  return ENoErr;
+}
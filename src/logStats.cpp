@@ -0,0 +1,110 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logStats.cpp
+/// @brief Implementation of the LogStats class
+
+#include "logStats.h"
+#include <string.h>
+#include <stdlib.h>
+#include <new>
+
+thread_local int               LogStats::s_shard = -1;
+thread_local LogStats::owner_t LogStats::s_owner = { -1 };
+std::atomic<uint64_t>          LogStats::s_owned(0);
+
+LogStats::owner::~owner() {
+  if (shard >= 0) s_owned.fetch_and(~(1ULL << shard), std::memory_order_release);
+}
+
+LogStats::LogStats() {
+
+  // new does not honor the alignment of the shards before C++17
+  void *mem = NULL;
+  if (posix_memalign(&mem, 64, sizeof(shard_t) * (CShards + 1)) != 0) throw std::bad_alloc();
+  m_shards = (shard_t*)mem;
+  for (int i = 0; i <= CShards; i++) {
+    shard_t *s = &m_shards[i];
+    for (int l = 0; l < CLevels; l++) {
+      s->emitted[l].store(0, std::memory_order_relaxed);
+      s->filtered[l].store(0, std::memory_order_relaxed);
+    }
+    s->bytes.store(0, std::memory_order_relaxed);
+    s->truncated.store(0, std::memory_order_relaxed);
+    s->writeErrors.store(0, std::memory_order_relaxed);
+    s->flushes.store(0, std::memory_order_relaxed);
+    s->flushNs.store(0, std::memory_order_relaxed);
+    for (int b = 0; b < CFlushBuckets; b++) s->flushHist[b].store(0, std::memory_order_relaxed);
+  }
+}
+
+LogStats::~LogStats() {
+  free(m_shards);
+}
+
+int LogStats::claim(void) {
+
+  uint64_t owned = s_owned.load(std::memory_order_relaxed);
+  int i = CShards;
+
+  while (~owned != 0) {
+    i = __builtin_ctzll(~owned);
+    if (s_owned.compare_exchange_weak(owned, owned | (1ULL << i), std::memory_order_acquire)) break;
+    i = CShards;
+  }
+  // threads beyond CShards share the last shard for good
+  s_shard = i;
+  if (i < CShards) s_owner.shard = i;
+  return i;
+}
+
+void LogStats::flushed(uint64_t ns) {
+
+  shard_t *s = shard();
+  uint64_t us = ns / 1000;
+  int b = 0;
+
+  while ((b < CFlushBuckets - 1) && (us >= (1ULL << b))) b++;
+  bump(&s->flushes, 1);
+  bump(&s->flushNs, ns);
+  bump(&s->flushHist[b], 1);
+}
+
+void LogStats::snapshot(stats_t *stats) const {
+
+  memset(stats, 0, sizeof(*stats));
+  for (int i = 0; i <= CShards; i++) {
+    const shard_t *s = &m_shards[i];
+    for (int l = 0; l < CLevels; l++) {
+      stats->emitted[l]  += s->emitted[l].load(std::memory_order_relaxed);
+      stats->filtered[l] += s->filtered[l].load(std::memory_order_relaxed);
+    }
+    stats->bytes       += s->bytes.load(std::memory_order_relaxed);
+    stats->truncated   += s->truncated.load(std::memory_order_relaxed);
+    stats->writeErrors += s->writeErrors.load(std::memory_order_relaxed);
+    stats->flushes     += s->flushes.load(std::memory_order_relaxed);
+    stats->flushNs     += s->flushNs.load(std::memory_order_relaxed);
+    for (int b = 0; b < CFlushBuckets; b++) stats->flushHist[b] += s->flushHist[b].load(std::memory_order_relaxed);
+  }
+}
+
+uint64_t LogStats::flushQuantile(const stats_t *stats, double q) {
+
+  uint64_t total = 0;
+  for (int b = 0; b < CFlushBuckets; b++) total += stats->flushHist[b];
+  if (total == 0) return 0;
+
+  uint64_t rank = (uint64_t)(q * total + 0.5);
+  uint64_t seen = 0;
+  if (rank == 0) rank = 1;
+  for (int b = 0; b < CFlushBuckets; b++) {
+    seen += stats->flushHist[b];
+    if (seen >= rank) return 1ULL << b;
+  }
+  return 1ULL << (CFlushBuckets - 1);
+}
@@ -0,0 +1,148 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logTime.cpp
+/// @brief Implementation of the LogTime class
+
+#include "logTime.h"
+#include <string.h>
+
+/// read the monotonic clock once at startup so ETimeMono counts from process start
+static struct timespec startTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts;
+}
+
+struct timespec LogTime::s_start = startTime();
+
+/// write two decimal digits
+static inline void put2(char *buf, int val) {
+  buf[0] = '0' + val / 10;
+  buf[1] = '0' + val % 10;
+}
+
+void LogTime::now(format_e fmt, struct timespec *ts) {
+  clock_gettime((fmt == ETimeMono) ? CLOCK_MONOTONIC : CLOCK_REALTIME, ts);
+}
+
+int LogTime::render(char *buf, int len, format_e fmt) {
+  struct timespec ts;
+  now(fmt, &ts);
+  return format(buf, len, fmt, &ts);
+}
+
+int LogTime::format(char *buf, int len, format_e fmt, const struct timespec *ts) {
+
+  char tmp[CMaxTimeLen];
+  const timeCache_t *tc = NULL;
+  int n = 0;
+
+  switch (fmt) {
+    case ETimeClock:
+      tc = lookup(ts->tv_sec);
+      memcpy(tmp, tc->clock, 8);
+      n = 8;
+      break;
+    case ETimeClockUs:
+      tc = lookup(ts->tv_sec);
+      memcpy(tmp, tc->clock, 8);
+      tmp[8] = '.';
+      putFraction(&tmp[9], ts->tv_nsec, 6);
+      n = 15;
+      break;
+    case ETimeIso:
+      tc = lookup(ts->tv_sec);
+      memcpy(tmp, tc->date, 11);
+      memcpy(&tmp[11], tc->clock, 8);
+      tmp[19] = '.';
+      putFraction(&tmp[20], ts->tv_nsec, 6);
+      memcpy(&tmp[26], tc->offset, 6);
+      n = 32;
+      break;
+    case ETimeEpochNs:
+      n = putUint(tmp, (uint64_t)ts->tv_sec * 1000000000ULL + ts->tv_nsec);
+      break;
+    case ETimeMono: {
+      struct timespec d;
+      d.tv_sec  = ts->tv_sec - s_start.tv_sec;
+      d.tv_nsec = ts->tv_nsec - s_start.tv_nsec;
+      if (d.tv_nsec < 0) {
+        d.tv_sec--;
+        d.tv_nsec += 1000000000L;
+      }
+      n = putUint(tmp, (uint64_t)d.tv_sec);
+      tmp[n++] = '.';
+      putFraction(&tmp[n], d.tv_nsec, 6);
+      n += 6;
+      break;
+    }
+    default:
+      return -1;
+  }
+
+  if (n > len) return -1;
+  memcpy(buf, tmp, n);
+  return n;
+}
+
+const LogTime::timeCache_t *LogTime::lookup(time_t sec) {
+
+  static thread_local timeCache_t cache = { (time_t)-1, {0}, {0}, {0} };
+
+  if (cache.sec != sec) {
+    struct tm tm;
+    localtime_r(&sec, &tm);
+
+    put2(&cache.clock[0], tm.tm_hour);
+    cache.clock[2] = ':';
+    put2(&cache.clock[3], tm.tm_min);
+    cache.clock[5] = ':';
+    put2(&cache.clock[6], tm.tm_sec);
+
+    int year = tm.tm_year + 1900;
+    put2(&cache.date[0], (year / 100) % 100);
+    put2(&cache.date[2], year % 100);
+    cache.date[4] = '-';
+    put2(&cache.date[5], tm.tm_mon + 1);
+    cache.date[7] = '-';
+    put2(&cache.date[8], tm.tm_mday);
+    cache.date[10] = 'T';
+
+    long off = tm.tm_gmtoff / 60;
+    cache.offset[0] = (off < 0) ? '-' : '+';
+    if (off < 0) off = -off;
+    put2(&cache.offset[1], (int)(off / 60) % 100);
+    cache.offset[3] = ':';
+    put2(&cache.offset[4], (int)(off % 60));
+
+    cache.sec = sec;
+  }
+  return &cache;
+}
+
+void LogTime::putFraction(char *buf, long ns, int digits) {
+  for (int i = 8; i >= digits; i--) ns /= 10;
+  for (int i = digits - 1; i >= 0; i--) {
+    buf[i] = '0' + ns % 10;
+    ns /= 10;
+  }
+}
+
+int LogTime::putUint(char *buf, uint64_t val) {
+  char tmp[20];
+  int n = 0;
+
+  do {
+    tmp[n++] = '0' + val % 10;
+    val /= 10;
+  } while (val != 0);
+
+  for (int i = 0; i < n; i++) buf[i] = tmp[n - 1 - i];
+  return n;
+}
@@ -0,0 +1,85 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file logWatch.cpp
+/// @brief Implementation of the LogWatch class
+
+#include "logWatch.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+
+LogWatch::LogWatch(const char *path) {
+
+  m_watch = -1;
+  m_inotify = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+  m_wake = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+  char dir[PATH_MAX];
+  const char *slash = strrchr(path, '/');
+  if (slash == NULL) {
+    strcpy(dir, ".");
+    strncpy(m_name, path, sizeof(m_name) - 1);
+  } else {
+    size_t len = (slash == path) ? 1 : (size_t)(slash - path);
+    if (len >= sizeof(dir)) len = sizeof(dir) - 1;
+    memcpy(dir, path, len);
+    dir[len] = '\0';
+    strncpy(m_name, slash + 1, sizeof(m_name) - 1);
+  }
+  m_name[sizeof(m_name) - 1] = '\0';
+
+  if (m_inotify >= 0) m_watch = inotify_add_watch(m_inotify, dir, IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (!isOpen()) fprintf(stderr, "Failed to watch %s: %d\n", path, errno);
+}
+
+LogWatch::~LogWatch() {
+  if (m_inotify >= 0) close(m_inotify);
+  if (m_wake >= 0) close(m_wake);
+}
+
+void LogWatch::stop(void) {
+  uint64_t one = 1;
+  if (m_wake >= 0) (void)!write(m_wake, &one, sizeof(one));
+}
+
+int LogWatch::wait(void) {
+
+  if (!isOpen()) return EFailed;
+
+  // events are aligned for struct inotify_event
+  alignas(struct inotify_event) char buf[4096];
+  struct pollfd fds[2] = { { m_inotify, POLLIN, 0 }, { m_wake, POLLIN, 0 } };
+
+  while (true) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      return EFailed;
+    }
+    if (fds[1].revents != 0) return EStopped;
+
+    // drain all queued events, a save often comes as several
+    bool changed = false;
+    ssize_t n;
+    while ((n = read(m_inotify, buf, sizeof(buf))) > 0) {
+      for (char *pos = buf; pos < buf + n; ) {
+        const struct inotify_event *ev = (const struct inotify_event*)pos;
+        if (ev->mask & IN_IGNORED) return EFailed;
+        if ((ev->len > 0) && (strcmp(ev->name, m_name) == 0)) changed = true;
+        pos += sizeof(struct inotify_event) + ev->len;
+      }
+    }
+    if ((n < 0) && (errno != EAGAIN) && (errno != EINTR)) return EFailed;
+    if (changed) return EChanged;
+  }
+}
@@ -0,0 +1,1393 @@
+//        __
+//       / /   ___   __ _  __ _  ___ _ __
+//      / /   / _ \ / _` |/ _` |/ _ \ '__|
+//     / /___| (_) | (_| | (_| |  __/ |
+//     \____/ \___/ \__, |\__, |\___|_|
+//                  |___/ |___/        v1.0
+//      <ramharter>
+
+/// @file main.cpp
+/// @brief Logger tests, built by make test and run as bin/out
+
+#include "log.h"
+#include "logSink.h"
+#include "logBinary.h"
+#include "logQueue.h"
+#include "logJson.h"
+#include "logDedup.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <string>
+
+/// number of failed checks
+static int failures = 0;
+
+/// Count and report a failed check, the test goes on
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+/// directory the tests write their files to
+static char tmpDir[64];
+
+/// Return the path of \a name in the test directory
+static std::string tmpPath(const char *name) {
+  return std::string(tmpDir) + "/" + name;
+}
+
+/// Read a whole file, empty if it does not exist
+static std::string readFile(const std::string &path) {
+  std::string data;
+  FILE *fd = fopen(path.c_str(), "r");
+  if (fd == NULL) return data;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), fd)) > 0) data.append(buf, n);
+  fclose(fd);
+  return data;
+}
+
+/// Write \a data to \a path, replacing the file by renaming a new one over it if \a replace is set
+static void writeFile(const std::string &path, const std::string &data, bool replace = false) {
+  std::string tmp = replace ? path + ".new" : path;
+  FILE *fd = fopen(tmp.c_str(), "w");
+  if (fd == NULL) return;
+  fwrite(data.data(), 1, data.size(), fd);
+  fclose(fd);
+  if (replace) (void)rename(tmp.c_str(), path.c_str());
+}
+
+/// Split \a data into lines without their line ends
+static std::vector<std::string> splitLines(const std::string &data) {
+  std::vector<std::string> lines;
+  size_t pos = 0, nl;
+  while ((nl = data.find('\n', pos)) != std::string::npos) {
+    lines.push_back(data.substr(pos, nl - pos));
+    pos = nl + 1;
+  }
+  if (pos < data.size()) lines.push_back(data.substr(pos));
+  return lines;
+}
+
+/// Remove all files of the test directory
+static void cleanDir(void) {
+  DIR *dir = opendir(tmpDir);
+  if (dir == NULL) return;
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL) {
+    if (ent->d_name[0] != '.') (void)unlink(tmpPath(ent->d_name).c_str());
+  }
+  closedir(dir);
+}
+
+/// Log continuously across many size rotations, no line may be lost or duplicated
+static void test_rotation(void) {
+
+  const int threads = 2;
+  const int lines = 20000;
+
+  for (int async = 0; async < 2; async++) {
+    cleanDir();
+    std::string path = tmpPath("rotate.log");
+
+    CfgLog *cfg = new CfgLog();
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, path.c_str(), CfgLog::CMaxPathLen - 1);
+    cfg->profile = CfgLog::ELogProfileNone;
+    cfg->useAsync = async;
+    cfg->rotateSize = 4 * 1024;
+    cfg->rotateKeep = 1000;
+    Logger *log = new Logger(cfg);
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; t++) {
+      writers.push_back(std::thread([log, t, lines] {
+        for (int i = 0; i < lines; i++) {
+          log->info("t%d line %d", t, i);
+          // give the rotator a chance to keep up, so the run covers many rotations
+          if (i % 200 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      }));
+    }
+    for (auto &w : writers) w.join();
+    delete log;
+    delete cfg;
+
+    // gather the lines of the logfile and all rotated ones
+    std::vector<int> seen(threads * lines, 0);
+    int files = 0, bad = 0;
+    for (int i = 0; i <= 1000; i++) {
+      std::string name = (i == 0) ? path : path + "." + std::to_string(i);
+      if (access(name.c_str(), F_OK) != 0) continue;
+      files++;
+      for (const std::string &l : splitLines(readFile(name))) {
+        int t, n;
+        if ((sscanf(l.c_str(), "t%d line %d", &t, &n) == 2) && (t >= 0) && (t < threads) && (n >= 0) && (n < lines)) {
+          seen[t * lines + n]++;
+        } else {
+          bad++;
+        }
+      }
+    }
+
+    int lost = 0, twice = 0;
+    for (int c : seen) {
+      if (c == 0) lost++;
+      if (c > 1) twice++;
+    }
+    CHECK(files > 20);
+    CHECK(bad == 0);
+    CHECK(lost == 0);
+    CHECK(twice == 0);
+  }
+  cleanDir();
+}
+
+/// A burst in interval flush mode reaches the file without another record following it
+static void test_flushInterval(void) {
+
+  for (int async = 0; async < 2; async++) {
+    cleanDir();
+    std::string path = tmpPath("interval.log");
+
+    CfgLog *cfg = new CfgLog();
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, path.c_str(), CfgLog::CMaxPathLen - 1);
+    cfg->profile = CfgLog::ELogProfileNone;
+    cfg->useAsync = async;
+    cfg->flushMode = CfgLog::EFlushInterval;
+    cfg->flushInterval = 100;
+    Logger *log = new Logger(cfg);
+
+    // the first lines are flushed right away, the interval starts with the Logger
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    log->info("first");
+    for (int i = 0; i < 10; i++) log->info("line %d", i);
+    std::string early = readFile(path);
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    std::vector<std::string> lines = splitLines(readFile(path));
+
+    CHECK(early.size() < 80);
+    CHECK(lines.size() == 11);
+    delete log;
+    delete cfg;
+  }
+  cleanDir();
+}
+
+/// Log through small mmap chunks with each msync policy, checking the msyncs and the file
+static void test_mmap(void) {
+
+  const int lines = 2000;
+
+  for (int mode = CfgLog::EMsyncNever; mode <= CfgLog::EMsyncSeverity; mode++) {
+    cleanDir();
+    std::string path = tmpPath("mmap.log");
+
+    CfgLog *cfg = new CfgLog();
+    CHECK(cfg->msyncMode == CfgLog::EMsyncNever);
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, path.c_str(), CfgLog::CMaxPathLen - 1);
+    cfg->profile = CfgLog::ELogProfileNone;
+    cfg->backend = CfgLog::EBackendMmap;
+    cfg->mmapChunkSize = 4096;
+    cfg->msyncMode = (CfgLog::msync_e)mode;
+    cfg->flushInterval = 60000;
+    Logger *log = new Logger(cfg);
+
+    for (int i = 0; i < lines; i++) {
+      if (i % 100 == 99) log->error("line %d", i);
+      else log->info("line %d", i);
+    }
+    LogStats::stats_t stats;
+    log->getStats(&stats);
+    // the interval has not passed since the Logger started
+    CHECK(stats.flushes == ((mode == CfgLog::EMsyncSeverity) ? (uint64_t)lines / 100 : 0));
+    log->flush();
+    delete log;
+    delete cfg;
+
+    // many chunks, cut to the bytes used
+    std::string data = readFile(path);
+    std::string expect;
+    for (int i = 0; i < lines; i++) expect += "line " + std::to_string(i) + "\n";
+    CHECK(data.size() > 4 * 4096);
+    CHECK(data == expect);
+  }
+  cleanDir();
+}
+
+/// Decode a binary logfile appended to by two Loggers whose format ids collide
+static void test_binarySessions(void) {
+
+  cleanDir();
+  std::string bin = tmpPath("binary.log");
+  std::string txt = tmpPath("decoded.log");
+
+  // both sessions number their first format string 1
+  for (int run = 0; run < 2; run++) {
+    CfgLog *cfg = new CfgLog();
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, bin.c_str(), CfgLog::CMaxPathLen - 1);
+    cfg->backend = CfgLog::EBackendBinary;
+    cfg->appendToFile = true;
+    Logger *log = new Logger(cfg);
+    if (run == 0) log->info("alpha %d", 1);
+    else log->info("beta %s and %d", "two", 3);
+    delete log;
+    delete cfg;
+  }
+
+  CfgLog *cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, txt.c_str(), CfgLog::CMaxPathLen - 1);
+  cfg->profile = CfgLog::ELogProfileNone;
+  Logger *out = new Logger(cfg);
+  const char *files[1] = { bin.c_str() };
+  CHECK(LogBinary::decode(files, 1, out) == LogBinary::ENoErr);
+  delete out;
+  delete cfg;
+
+  std::vector<std::string> lines = splitLines(readFile(txt));
+  CHECK(lines.size() == 2);
+  CHECK((lines.size() > 0) && (lines[0] == "alpha 1"));
+  CHECK((lines.size() > 1) && (lines[1] == "beta two and 3"));
+  cleanDir();
+}
+
+/// Decode corrupt and cut binary logfiles, which must be reported without reading past their end
+static void test_binaryCorrupt(void) {
+
+  cleanDir();
+  std::string bin = tmpPath("corrupt.bin");
+  std::string txt = tmpPath("decoded.log");
+
+  // a valid file to cut at every length
+  CfgLog *cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, bin.c_str(), CfgLog::CMaxPathLen - 1);
+  cfg->backend = CfgLog::EBackendBinary;
+  Logger *log = new Logger(cfg);
+  log->info("value %d of %s", 7, "seven");
+  delete log;
+  delete cfg;
+  std::string valid = readFile(bin);
+  CHECK(valid.size() > 0);
+
+  std::vector<std::string> files;
+  // a format record claiming more argument kinds than the file holds
+  files.push_back(std::string("F\x01\x00\x00\x00\xff", 6));
+  files.push_back(std::string("F\x01\x00\x00\x00\x02\x01", 7));
+  files.push_back(std::string("X", 1));
+  for (size_t n = 1; n < valid.size(); n++) files.push_back(valid.substr(0, n));
+
+  cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, txt.c_str(), CfgLog::CMaxPathLen - 1);
+  Logger *out = new Logger(cfg);
+  int failed = 0;
+  for (const std::string &data : files) {
+    // exactly sized heap copies, so a sanitizer catches reads past the end
+    FILE *fd = fopen(bin.c_str(), "w");
+    CHECK(fd != NULL);
+    if (fd == NULL) break;
+    fwrite(data.data(), 1, data.size(), fd);
+    fclose(fd);
+    const char *name = bin.c_str();
+    if (LogBinary::decode(&name, 1, out) != LogBinary::ENoErr) failed++;
+  }
+  delete out;
+  delete cfg;
+
+  // the corrupt records are reported, a cut may still end on a record boundary
+  CHECK(failed >= 3);
+  cleanDir();
+}
+
+/// Log messages of several KB, synchronously, asynchronously and as binary records, none may be cut
+static void test_longMessages(void) {
+
+  const int sizes[] = { 511, 512, 513, 1500, 4096, 20000, 60000 };
+  const int nsizes = sizeof(sizes) / sizeof(sizes[0]);
+
+  for (int mode = 0; mode < 4; mode++) {
+    bool async = (mode & 1) != 0;
+    bool binary = (mode & 2) != 0;
+    cleanDir();
+    std::string path = tmpPath("long.log");
+    std::string txt = tmpPath("decoded.log");
+
+    CfgLog *cfg = new CfgLog();
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, path.c_str(), CfgLog::CMaxPathLen - 1);
+    cfg->profile = CfgLog::ELogProfileNone;
+    cfg->useAsync = async;
+    if (binary) cfg->backend = CfgLog::EBackendBinary;
+    Logger *log = new Logger(cfg);
+
+    std::vector<std::string> msgs;
+    for (int i = 0; i < nsizes; i++) {
+      std::string msg;
+      for (int k = 0; k < sizes[i]; k++) msg += (char)('a' + (k + i) % 26);
+      msgs.push_back(msg);
+      log->info("%s", msg.c_str());
+      // the message as format string, longer than any stack buffer
+      log->info(msg.c_str());
+    }
+    LogStats::stats_t stats;
+    log->getStats(&stats);
+    CHECK(stats.truncated == 0);
+    delete log;
+    delete cfg;
+
+    if (binary) {
+      cfg = new CfgLog();
+      cfg->logToFile = true;
+      strncpy(cfg->logfile, txt.c_str(), CfgLog::CMaxPathLen - 1);
+      Logger *out = new Logger(cfg);
+      const char *name = path.c_str();
+      CHECK(LogBinary::decode(&name, 1, out) == LogBinary::ENoErr);
+      delete out;
+      delete cfg;
+      path = txt;
+    }
+
+    std::vector<std::string> lines = splitLines(readFile(path));
+    CHECK((int)lines.size() == 2 * nsizes);
+    for (int i = 0; (i < nsizes) && (2 * i + 1 < (int)lines.size()); i++) {
+      CHECK(lines[2 * i] == msgs[i]);
+      CHECK(lines[2 * i + 1] == msgs[i]);
+    }
+  }
+  cleanDir();
+}
+
+/// Fill async queue slots exactly, with the pid as the last item of each
+static void test_fullSlot(void) {
+
+  cleanDir();
+  std::string path = tmpPath("slot.log");
+
+  CfgLog *cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, path.c_str(), CfgLog::CMaxPathLen - 1);
+  cfg->useAsync = true;
+  cfg->asyncQueueLen = 2;
+  cfg->profile = CfgLog::ELogProfileUser;
+  strcpy(cfg->pattern, "&msg&pid");
+  Logger *log = new Logger(cfg);
+
+  char pid[16];
+  int pidLen = snprintf(pid, sizeof(pid), "%d", (int)getpid());
+  std::string expect;
+  for (int i = 0; i < 16; i++) {
+    // a record of exactly one slot, the pid ends at its last byte
+    std::string msg(LogQueue::CMaxRecordLen - pidLen, (char)('a' + i));
+    log->info("%s", msg.c_str());
+    expect += msg + pid;
+  }
+  delete log;
+  delete cfg;
+
+  CHECK(readFile(path) == expect);
+  cleanDir();
+}
+
+/// Dump the flight recorder on alerts while another thread keeps the async writer busy
+static void test_recorderAsync(void) {
+
+  const int lines = 4000;
+  const int alerts = 40;
+
+  cleanDir();
+  std::string path = tmpPath("recorder.log");
+
+  CfgLog *cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, path.c_str(), CfgLog::CMaxPathLen - 1);
+  cfg->profile = CfgLog::ELogProfileNone;
+  cfg->backend = CfgLog::EBackendFdBatch;
+  cfg->useAsync = true;
+  cfg->logLevel = CfgLog::ELogInfo;
+  cfg->useRecorder = true;
+  cfg->recorderLevel = CfgLog::ELogDebug;
+  Logger *log = new Logger(cfg);
+
+  std::thread writer([log, lines] {
+    for (int i = 0; i < lines; i++) log->info("w line %d", i);
+  });
+  std::thread alerter([log, alerts] {
+    for (int i = 0; i < alerts; i++) {
+      for (int k = 0; k < 20; k++) log->debug("d line %d", i * 20 + k);
+      log->alert("a line %d", i);
+    }
+  });
+  writer.join();
+  alerter.join();
+  delete log;
+  delete cfg;
+
+  // the replayed debug lines go out before their alert, no line may be mangled
+  std::vector<int> seen(lines, 0);
+  int alerted = 0, debugs = 0, bad = 0;
+  for (const std::string &l : splitLines(readFile(path))) {
+    int n;
+    char kind;
+    if ((sscanf(l.c_str(), "%c line %d", &kind, &n) != 2) || (n < 0)) bad++;
+    else if ((kind == 'w') && (n < lines)) seen[n]++;
+    else if (kind == 'a') alerted++;
+    else if (kind == 'd') debugs++;
+    else bad++;
+  }
+  int wrong = 0;
+  for (int c : seen) if (c != 1) wrong++;
+  CHECK(bad == 0);
+  CHECK(wrong == 0);
+  CHECK(alerted == alerts);
+  CHECK(debugs >= alerts * 20);
+  cleanDir();
+}
+
+/// Parse the JSON string starting at \a pos, just after its opening quote
+/// @return the position after the closing quote, std::string::npos if the string is malformed
+static size_t parseString(const std::string &line, size_t pos, std::string *str) {
+
+  str->clear();
+  while (pos < line.size()) {
+    unsigned char c = line[pos++];
+    if (c == '"') return pos;
+    if (c < 0x20) return std::string::npos;
+    if (c != '\\') {
+      str->push_back(c);
+      continue;
+    }
+    if (pos >= line.size()) return std::string::npos;
+    switch (line[pos++]) {
+      case '"':  str->push_back('"');  break;
+      case '\\': str->push_back('\\'); break;
+      case '/':  str->push_back('/');  break;
+      case 'b':  str->push_back('\b'); break;
+      case 'f':  str->push_back('\f'); break;
+      case 'n':  str->push_back('\n'); break;
+      case 'r':  str->push_back('\r'); break;
+      case 't':  str->push_back('\t'); break;
+      case 'u': {
+        unsigned v;
+        // only control characters are escaped this way, others pass as UTF-8
+        if ((pos + 4 > line.size()) || (sscanf(line.substr(pos, 4).c_str(), "%4x", &v) != 1) || (v > 0xff)) return std::string::npos;
+        str->push_back((char)v);
+        pos += 4;
+        break;
+      }
+      default:
+        return std::string::npos;
+    }
+  }
+  return std::string::npos;
+}
+
+/// Escape strings covering the vector loops and the scalar tail, then parse them back
+static void test_jsonRoundTrip(void) {
+
+  // around the 16 and 32 byte blocks and their multiples
+  const int lens[] = { 0, 1, 2, 3, 7, 15, 16, 17, 31, 32, 33, 47, 48, 63, 64, 65, 95, 96, 97, 200, 1000 };
+  const int nlens = sizeof(lens) / sizeof(lens[0]);
+  const char specials[] = { '"', '\\', '\n', '\t', '\0', 0x01, 0x1f, 0x7f, (char)0x80, (char)0xc3, (char)0xff };
+  uint32_t seed = 1;
+
+  std::vector<std::string> strs;
+  for (int i = 0; i < nlens; i++) {
+    for (int variant = 0; variant < 4; variant++) {
+      std::string str;
+      for (int k = 0; k < lens[i]; k++) {
+        seed = seed * 1103515245 + 12345;
+        if (variant == 0) str.push_back('a' + (seed >> 16) % 26);                     // clean, copied in blocks
+        else if (variant == 1) str.push_back((char)((seed >> 16) & 0xff));            // any byte
+        else str.push_back((k % 13 == 0) ? specials[(seed >> 16) % sizeof(specials)] : 'x');
+      }
+      // a special as last byte, inside the tail or the last block
+      if ((variant == 3) && (lens[i] > 0)) str[lens[i] - 1] = specials[i % sizeof(specials)];
+      strs.push_back(str);
+    }
+  }
+
+  // straight through the escaper, compared with the scalar loop
+  for (const std::string &str : strs) {
+    std::vector<char> buf(str.size() * 6 + 2), ref(str.size() * 6 + 2);
+    char *end = LogJson::escape(buf.data(), buf.data() + buf.size(), str.data(), str.size());
+    char *rend = LogJson::escapeScalar(ref.data(), ref.data() + ref.size(), str.data(), str.size());
+    CHECK((end != NULL) && (rend != NULL));
+    if ((end == NULL) || (rend == NULL)) continue;
+    std::string out(buf.data(), end - buf.data());
+    CHECK(out == std::string(ref.data(), rend - ref.data()));
+
+    std::string back;
+    out += '"';
+    CHECK(parseString(out, 0, &back) == out.size());
+    CHECK(back == str);
+  }
+
+  // through a JSON Logger, as msg and as field, one object per line
+  cleanDir();
+  std::string path = tmpPath("json.log");
+  CfgLog *cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, path.c_str(), CfgLog::CMaxPathLen - 1);
+  cfg->profile = CfgLog::ELogProfileJson;
+  Logger *log = new Logger(cfg);
+
+  std::vector<std::string> msgs;
+  for (const std::string &str : strs) {
+    // the msg is a C string, it ends at the first null byte
+    msgs.push_back(str.c_str());
+    log->info("%s", str.c_str());
+    log->info("f", {{"s", str}});
+  }
+  delete log;
+  delete cfg;
+
+  std::vector<std::string> lines = splitLines(readFile(path));
+  CHECK(lines.size() == 2 * strs.size());
+  for (size_t i = 0; (i < strs.size()) && (2 * i + 1 < lines.size()); i++) {
+    std::string back;
+    const std::string &m = lines[2 * i], &f = lines[2 * i + 1];
+    size_t pos = m.find("\"msg\":\"");
+    CHECK((pos != std::string::npos) && (parseString(m, pos + 7, &back) == m.size() - 1) && (back == msgs[i]));
+    pos = f.find("\"s\":\"");
+    CHECK((pos != std::string::npos) && (parseString(f, pos + 5, &back) == f.size() - 1) && (back == strs[i]));
+  }
+  cleanDir();
+}
+
+/// Bind a datagram collector socket at \a path, -1 on failure
+static int bindCollector(const std::string &path) {
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  (void)unlink(path.c_str());
+
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if ((fd >= 0) && (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0)) {
+    close(fd);
+    fd = -1;
+  }
+  return fd;
+}
+
+/// Receive all datagrams waiting at \a fd
+static void receiveAll(int fd, std::vector<std::string> *msgs) {
+  char buf[SyslogSink::CMaxRecordLen];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), 0)) >= 0) msgs->push_back(std::string(buf, n));
+}
+
+/// Split an RFC 5424 record into its PRI and msg, checking the fields in between
+static bool parseSyslog(const std::string &rec, const std::string &ident, int *pri, std::string *msg) {
+
+  int hdr = 0;
+  char stamp[64];
+  if ((sscanf(rec.c_str(), "<%d>1 %63s%n", pri, stamp, &hdr) != 2) || (strlen(stamp) < 20)) return false;
+  if (rec.compare(hdr, ident.size(), ident) != 0) return false;
+  *msg = rec.substr(hdr + ident.size());
+  return true;
+}
+
+/// Send records to a local collector, through an outage and back
+static void test_syslog(void) {
+
+  const int outage = 400;
+
+  cleanDir();
+  std::string sock = tmpPath("syslog.sock");
+  int fd = bindCollector(sock);
+  CHECK(fd >= 0);
+  if (fd < 0) return;
+
+  char host[256] = { 0 }, ident[512];
+  (void)gethostname(host, sizeof(host) - 1);
+  snprintf(ident, sizeof(ident), " %s tester %d - - ", host, (int)getpid());
+
+  // records are sent one by one, the buffer keeps a few dozen through the outage
+  SyslogSink *sink = new SyslogSink(sock.c_str(), SyslogSink::CFacilityLocal0, 1, 8 * 1024, "tester");
+  CHECK(sink->isConnected());
+
+  CfgLog *cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, tmpPath("syslog.log").c_str(), CfgLog::CMaxPathLen - 1);
+  Logger *log = new Logger(cfg);
+  CHECK(log->addSink(sink, CfgLog::ELogDebug, "&msg&end") == Logger::ENoErr);
+
+  // PRI is facility * 8 + severity, always msgs go out as notices
+  const int local0 = SyslogSink::CFacilityLocal0 * 8;
+  log->error("an error");
+  log->warning("a warning");
+  log->notice("a notice");
+  log->info("an info");
+  log->debug("a debug msg");
+  log->always("an always msg");
+  const int pris[] = { local0 + 3, local0 + 4, local0 + 5, local0 + 6, local0 + 7, local0 + 5 };
+  const char *texts[] = { "an error", "a warning", "a notice", "an info", "a debug msg", "an always msg" };
+
+  std::vector<std::string> recs;
+  receiveAll(fd, &recs);
+  CHECK(recs.size() == 6);
+  for (size_t i = 0; (i < recs.size()) && (i < 6); i++) {
+    int pri = 0;
+    std::string msg;
+    CHECK(parseSyslog(recs[i], ident, &pri, &msg));
+    CHECK(pri == pris[i]);
+    CHECK(msg == texts[i]);
+  }
+
+  // the collector goes away, records are buffered until the buffer is full
+  close(fd);
+  (void)unlink(sock.c_str());
+  for (int i = 0; i < outage; i++) log->info("outage %d", i);
+  uint64_t dropped = sink->getDropped();
+  CHECK(!sink->isConnected());
+  CHECK((dropped > 0) && (dropped < (uint64_t)outage));
+
+  // and comes back, the timer of the Logger retries without further records
+  fd = bindCollector(sock);
+  CHECK(fd >= 0);
+  if (fd < 0) return;
+  recs.clear();
+  // the collector queues a few datagrams only, it is drained while the sink catches up
+  for (int i = 0; i < 500; i++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    receiveAll(fd, &recs);
+    if (!recs.empty() && (recs.back().find("syslog sink dropped") != std::string::npos)) break;
+  }
+  CHECK(sink->isConnected());
+
+  // the oldest records were kept, the report of the drops comes after them
+  int kept = 0, reports = 0;
+  for (const std::string &rec : recs) {
+    int pri = 0, n = -1;
+    unsigned long long cnt = 0;
+    std::string msg;
+    CHECK(parseSyslog(rec, ident, &pri, &msg));
+    if (sscanf(msg.c_str(), "outage %d", &n) == 1) {
+      CHECK((n == kept) && (pri == local0 + 6) && (reports == 0));
+      kept++;
+    } else if (sscanf(msg.c_str(), "syslog sink dropped %llu records", &cnt) == 1) {
+      CHECK((cnt == dropped) && (pri == local0 + 4));
+      reports++;
+    } else {
+      CHECK(false);
+    }
+  }
+  CHECK((uint64_t)kept + dropped == (uint64_t)outage);
+  CHECK(reports == 1);
+
+  delete log;
+  delete cfg;
+  close(fd);
+  cleanDir();
+}
+
+/// Send a batch which does not fill up once its oldest record has waited long enough
+static void test_syslogDelay(void) {
+
+  const int delay = 100;
+
+  cleanDir();
+  std::string sock = tmpPath("syslog.sock");
+  int fd = bindCollector(sock);
+  CHECK(fd >= 0);
+  if (fd < 0) return;
+
+  SyslogSink *sink = new SyslogSink(sock.c_str(), SyslogSink::CFacilityLocal0, 32, 64 * 1024, "tester", delay);
+  CfgLog *cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, tmpPath("syslog.log").c_str(), CfgLog::CMaxPathLen - 1);
+  Logger *log = new Logger(cfg);
+  CHECK(log->addSink(sink, CfgLog::ELogDebug, "&msg&end") == Logger::ENoErr);
+
+  // infos wait for their batch
+  for (int i = 0; i < 3; i++) log->info("info %d", i);
+  std::vector<std::string> recs;
+  receiveAll(fd, &recs);
+  CHECK(recs.empty());
+
+  // and go out by the tick of the Logger, nothing is logged or flushed meanwhile
+  std::this_thread::sleep_for(std::chrono::milliseconds(delay + 3 * Logger::CSinkTickMs));
+  receiveAll(fd, &recs);
+  CHECK(recs.size() == 3);
+
+  // without a Logger ticking it, the next write past the delay sends the batch
+  SyslogSink *alone = new SyslogSink(sock.c_str(), SyslogSink::CFacilityLocal0, 32, 64 * 1024, "tester", delay);
+  struct iovec iov = { (void*)"alone", 5 };
+  recs.clear();
+  CHECK(alone->write(&iov, 1) == LogSink::ENoErr);
+  std::this_thread::sleep_for(std::chrono::milliseconds(delay + 20));
+  receiveAll(fd, &recs);
+  CHECK(recs.empty());
+  CHECK(alone->write(&iov, 1) == LogSink::ENoErr);
+  receiveAll(fd, &recs);
+  CHECK(recs.size() == 2);
+  delete alone;
+
+  delete log;
+  delete cfg;
+  close(fd);
+  cleanDir();
+}
+
+/// Format \a args with format string \a F into at most \a room bytes, checking that nothing is written behind them
+template<typename F, typename... Args>
+static std::string formatted(F, size_t room, const Args&... args) {
+  char buf[256];
+  memset(buf, 'Z', sizeof(buf));
+  char *end = LogFormat::format(buf, buf + room, F::value(), args...);
+  CHECK((end >= buf) && (end <= buf + room));
+  for (size_t i = room; i < sizeof(buf); i++) {
+    if (buf[i] != 'Z') {
+      CHECK(buf[i] == 'Z');
+      break;
+    }
+  }
+  return std::string(buf, end - buf);
+}
+
+/// Numbers rendered by the type-safe formatter: rounding, scientific notation, hex and cut buffers
+static void test_format(void) {
+
+  const size_t all = 128;
+
+  // rounding to the default precision drops trailing zeros, a carry reaches the integer part
+  CHECK(formatted(LOGGER_FMT("{}"), all, 1.5) == "1.5");
+  CHECK(formatted(LOGGER_FMT("{}"), all, 0.1 + 0.2) == "0.3");
+  CHECK(formatted(LOGGER_FMT("{}"), all, 0.9999999) == "1");
+  CHECK(formatted(LOGGER_FMT("{}"), all, 2.0) == "2");
+  CHECK(formatted(LOGGER_FMT("{}"), all, -1.25f) == "-1.25");
+  CHECK(formatted(LOGGER_FMT("{}"), all, -0.0) == "0");
+  CHECK(formatted(LOGGER_FMT("{:.0}"), all, 2.5) == "3");
+  CHECK(formatted(LOGGER_FMT("{:.2}"), all, 1.005) == "1.00");
+  CHECK(formatted(LOGGER_FMT("{:.2}"), all, 1.999) == "2.00");
+  CHECK(formatted(LOGGER_FMT("{:.3}"), all, 1e-5) == "0.000");
+  CHECK(formatted(LOGGER_FMT("{:.9}"), all, 0.123456789) == "0.123456789");
+  CHECK(formatted(LOGGER_FMT("{} {} {}"), all, NAN, INFINITY, -INFINITY) == "nan inf -inf");
+
+  // scientific notation from 1e18 up and below 1e-4 without precision, a carry moves the exponent
+  CHECK(formatted(LOGGER_FMT("{}"), all, 1e17) == "100000000000000000");
+  CHECK(formatted(LOGGER_FMT("{}"), all, 1e18) == "1e+18");
+  CHECK(formatted(LOGGER_FMT("{}"), all, 1.5e300) == "1.5e+300");
+  CHECK(formatted(LOGGER_FMT("{}"), all, 0.0001) == "0.0001");
+  CHECK(formatted(LOGGER_FMT("{}"), all, 0.00001) == "1e-5");
+  CHECK(formatted(LOGGER_FMT("{}"), all, -2.5e-10) == "-2.5e-10");
+  CHECK(formatted(LOGGER_FMT("{}"), all, 9.9999999e20) == "1e+21");
+  CHECK(formatted(LOGGER_FMT("{:.2}"), all, 9.999e30) == "1.00e+31");
+  CHECK(formatted(LOGGER_FMT("{}"), all, 9.99999999e-5) == "1e-4");
+  CHECK(formatted(LOGGER_FMT("{:.1}"), all, -9.96e19) == "-1.0e+20");
+
+  // integers, hex of negative values shows the bits of their own width
+  CHECK(formatted(LOGGER_FMT("{} {}"), all, INT64_MIN, UINT64_MAX) == "-9223372036854775808 18446744073709551615");
+  CHECK(formatted(LOGGER_FMT("{:x}"), all, -1) == "ffffffff");
+  CHECK(formatted(LOGGER_FMT("{:x}"), all, (int64_t)-2) == "fffffffffffffffe");
+  CHECK(formatted(LOGGER_FMT("{:x}"), all, (short)-16) == "fff0");
+  CHECK(formatted(LOGGER_FMT("{:x}"), all, (int8_t)-1) == "ff");
+  CHECK(formatted(LOGGER_FMT("{:x}"), all, (char)-1) == "ff");
+  CHECK(formatted(LOGGER_FMT("{:x} {:x}"), all, 0, 0xabcu) == "0 abc");
+
+  // a cut buffer holds the start of the msg and nothing more
+  std::string whole = formatted(LOGGER_FMT("{{{}}} {} {:x} {:.3} {} {}"), all, "str", -12345, -255, 3.14159, 9.9999999e20, nullptr);
+  CHECK(whole == "{str} -12345 ffffff01 3.142 1e+21 (nil)");
+  for (size_t room = 0; room <= whole.size(); room++) {
+    CHECK(formatted(LOGGER_FMT("{{{}}} {} {:x} {:.3} {} {}"), room, "str", -12345, -255, 3.14159, 9.9999999e20, nullptr) == whole.substr(0, room));
+  }
+}
+
+/// Children follow the nearest level along their path, overrides and module levels included
+static void test_children(void) {
+
+  cleanDir();
+  std::string path = tmpPath("children.log");
+  CfgLog *cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, path.c_str(), CfgLog::CMaxPathLen - 1);
+  cfg->profile = CfgLog::ELogProfileNone;
+  cfg->logLevel = CfgLog::ELogInfo;
+  Logger *log = new Logger(cfg);
+
+  // parents are created along the path, names are looked up again
+  LogChild *client = log->getChild("net.http.client");
+  LogChild *http = log->getChild("net.http");
+  LogChild *net = log->getChild("net");
+  LogChild *db = log->getChild("db");
+  CHECK((client != NULL) && (http != NULL) && (net != NULL) && (db != NULL));
+  if ((client == NULL) || (http == NULL) || (net == NULL) || (db == NULL)) return;
+  CHECK(log->getChild("net.http.client") == client);
+  CHECK(strcmp(client->getName(), "net.http.client") == 0);
+  CHECK(log->getChild("") == NULL);
+  CHECK(log->getChild("net..client") == NULL);
+  CHECK(log->getChild("net.") == NULL);
+  CHECK((client->getLevel() == CfgLog::ELogInfo) && !client->hasLevel());
+
+  // the Logger level reaches all children without an override
+  log->setLevel(CfgLog::ELogDebug);
+  CHECK((client->getLevel() == CfgLog::ELogDebug) && (db->getLevel() == CfgLog::ELogDebug));
+
+  // an override holds for the subtree, the rest follows the Logger
+  net->setLevel(CfgLog::ELogWarn);
+  log->setLevel(CfgLog::ELogError);
+  CHECK(net->hasLevel() && !http->hasLevel());
+  CHECK((http->getLevel() == CfgLog::ELogWarn) && (client->getLevel() == CfgLog::ELogWarn));
+  CHECK(db->getLevel() == CfgLog::ELogError);
+  LogChild *late = log->getChild("net.http.server");
+  CHECK((late != NULL) && (late->getLevel() == CfgLog::ELogWarn));
+
+  // a deeper override wins, dropping it returns to the parent
+  client->setLevel(CfgLog::ELogDebug);
+  CHECK((client->getLevel() == CfgLog::ELogDebug) && (http->getLevel() == CfgLog::ELogWarn));
+  client->debug("client debug");
+  http->debug("http debug");
+  http->warning("http warning");
+  db->warning("db warning");
+  client->clearLevel();
+  CHECK(client->getLevel() == CfgLog::ELogWarn);
+  client->debug("client cleared");
+  net->clearLevel();
+  CHECK((client->getLevel() == CfgLog::ELogError) && (net->getLevel() == CfgLog::ELogError));
+  http->warning("http follows");
+
+  // module levels of a config applied with reload() are overrides, dropped ones inherit again
+  CfgLog *mod = new CfgLog();
+  mod->copyLists(cfg);
+  mod->logLevel = CfgLog::ELogError;
+  mod->profile = CfgLog::ELogProfileNone;
+  mod->addModuleLevel("net.http", CfgLog::ELogInfo);
+  mod->addModuleLevel("cache", CfgLog::ELogDebug);
+  CHECK(log->reload(mod) == Logger::ENoErr);
+  CHECK(http->hasLevel() && (client->getLevel() == CfgLog::ELogInfo) && (net->getLevel() == CfgLog::ELogError));
+  LogChild *cache = log->getChild("cache");
+  CHECK((cache != NULL) && (cache->getLevel() == CfgLog::ELogDebug));
+  client->info("client module");
+  delete mod;
+  mod = new CfgLog();
+  mod->logLevel = CfgLog::ELogError;
+  mod->profile = CfgLog::ELogProfileNone;
+  CHECK(log->reload(mod) == Logger::ENoErr);
+  CHECK(!http->hasLevel() && (client->getLevel() == CfgLog::ELogError));
+  client->info("client dropped");
+  delete mod;
+
+  delete log;
+  delete cfg;
+  std::vector<std::string> lines = splitLines(readFile(path));
+  const char *expected[] = { "client debug", "http warning", "client module" };
+  CHECK(lines.size() == 3);
+  for (size_t i = 0; (i < lines.size()) && (i < 3); i++) CHECK(lines[i] == expected[i]);
+  cleanDir();
+}
+
+/// Read config files, good and bad ones, and reload a watched one while logging
+static void test_config(void) {
+
+  cleanDir();
+  std::string path = tmpPath("logger.cfg");
+  std::string logfile = tmpPath("config.log");
+
+  // comments, blanks, names of levels and enums in any case, sizes and quoted values
+  writeFile(path,
+    "# a comment\n"
+    "\n"
+    "   logLevel   =   warning   \n"
+    "logLevel.net.http = DEBUG\n"
+    "logLevel.db = error\n"
+    "pattern = &lvl&msg\n"
+    "profile = Minimal\n"
+    "prefix = \"> \"\n"
+    "separator = \"\\t|\"\n"
+    "usrPattern.2 = abc\n"
+    "color.error = red\n"
+    "useAsync = yes\n"
+    "asyncPolicy = droplowest\n"
+    "backend = FdBatch\n"
+    "flushMode = interval\n"
+    "flushInterval = 250\n"
+    "rotateSize = 4k\n"
+    "msyncMode = severity\n"
+    "logfile = " + logfile + "\n"
+    "watchConfig = on");
+  CfgLog *cfg = new CfgLog();
+  CHECK(cfg->load(path.c_str()) == CfgLog::ENoErr);
+  CHECK(cfg->logLevel == CfgLog::ELogWarn);
+  CHECK((cfg->profile == CfgLog::ELogProfileMinimal) && (strcmp(cfg->pattern, "&lvl&msg") == 0));
+  CHECK((strcmp(cfg->prefix, "> ") == 0) && (strcmp(cfg->separator, "\t|") == 0));
+  CHECK(cfg->useUsrPattern && (cfg->getUsrPattern(2) != NULL) && (strcmp(cfg->getUsrPattern(2), "abc") == 0));
+  CHECK(cfg->levelColor[CfgLog::ELogError] == CfgLog::EColorRed);
+  CHECK(cfg->useAsync && (cfg->asyncPolicy == CfgLog::EAsyncDropLowest));
+  CHECK((cfg->backend == CfgLog::EBackendFdBatch) && (cfg->msyncMode == CfgLog::EMsyncSeverity));
+  CHECK((cfg->flushMode == CfgLog::EFlushInterval) && (cfg->flushInterval == 250) && (cfg->rotateSize == 4096));
+  CHECK(cfg->logToFile && (logfile == cfg->logfile) && cfg->watchConfig && (path == cfg->configFile));
+  CfgLog::level_e lev = CfgLog::ELogAlways;
+  const char *mod0 = cfg->getModuleLevel(0, &lev);
+  CHECK((mod0 != NULL) && (strcmp(mod0, "net.http") == 0) && (lev == CfgLog::ELogDebug));
+  const char *mod1 = cfg->getModuleLevel(1, &lev);
+  CHECK((mod1 != NULL) && (strcmp(mod1, "db") == 0) && (lev == CfgLog::ELogError));
+  CHECK(cfg->getModuleLevel(2, &lev) == NULL);
+  delete cfg;
+
+  // a pattern alone selects the user profile
+  writeFile(path, "pattern = &msg&end\n");
+  cfg = new CfgLog();
+  CHECK((cfg->load(path.c_str()) == CfgLog::ENoErr) && (cfg->profile == CfgLog::ELogProfileUser));
+  delete cfg;
+
+  // each profile name selects its profile
+  const char *profiles[] = { "none", "minimal", "default", "verbose", "user", "json" };
+  const CfgLog::profile_e values[] = { CfgLog::ELogProfileNone, CfgLog::ELogProfileMinimal, CfgLog::ELogProfileDefault,
+                                       CfgLog::ELogProfileVerbose, CfgLog::ELogProfileUser, CfgLog::ELogProfileJson };
+  for (int i = 0; i < 6; i++) {
+    writeFile(path, std::string("profile = ") + profiles[i] + "\n");
+    cfg = new CfgLog();
+    CHECK((cfg->load(path.c_str()) == CfgLog::ENoErr) && (cfg->profile == values[i]));
+    delete cfg;
+  }
+
+  // bad lines fail the load, the settings before them are kept
+  const char *bad[] = { "flushMode = sometimes", "noSuchKey = 1", "just a line", "useColor = maybe", "logLevel = loud",
+                        "rotateSize = -1", "logLevel. = info", "asyncQueueLen = 12q", "prefix = \"much too long\"" };
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    writeFile(path, std::string("logLevel = error\n") + bad[i] + "\nlogLevel = debug\n");
+    cfg = new CfgLog();
+    CHECK(cfg->load(path.c_str()) == CfgLog::EErr);
+    CHECK(cfg->logLevel == CfgLog::ELogError);
+    delete cfg;
+  }
+  cfg = new CfgLog();
+  CHECK(cfg->load(tmpPath("missing.cfg").c_str()) == CfgLog::EErr);
+  delete cfg;
+
+  // a watched config is applied while logging, also when an editor renames a new file over it
+  writeFile(path, "logLevel = info\nprofile = none\nwatchConfig = true\nlogfile = " + logfile + "\n");
+  cfg = new CfgLog();
+  CHECK(cfg->load(path.c_str()) == CfgLog::ENoErr);
+  Logger *log = new Logger(cfg);
+  LogChild *net = log->getChild("net");
+  log->debug("before");
+  for (int step = 0; step < 2; step++) {
+    std::string data = (step == 0) ? "logLevel = debug\nlogLevel.net = error\nprofile = none\n" : "logLevel = notice\nprofile = none\n";
+    CfgLog::level_e want = (step == 0) ? CfgLog::ELogDebug : CfgLog::ELogNotice;
+    writeFile(path, data, step == 1);
+    for (int i = 0; (i < 200) && (log->getLevel() != want); i++) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(log->getLevel() == want);
+    if (step == 0) {
+      CHECK(net->getLevel() == CfgLog::ELogError);
+      log->debug("after");
+      net->warning("net warning");
+    } else {
+      CHECK(!net->hasLevel() && (net->getLevel() == CfgLog::ELogNotice));
+    }
+  }
+
+  // a broken file leaves the settings alone
+  writeFile(path, "logLevel = debug\nbroken line\n");
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  CHECK(log->getLevel() == CfgLog::ELogNotice);
+  delete log;
+  delete cfg;
+
+  std::vector<std::string> lines = splitLines(readFile(logfile));
+  std::string reloaded = "reloaded config " + path;
+  const char *expected[] = { reloaded.c_str(), "after", reloaded.c_str() };
+  CHECK(lines.size() == 3);
+  for (size_t i = 0; (i < lines.size()) && (i < 3); i++) CHECK(lines[i] == expected[i]);
+  cleanDir();
+}
+
+/// Create a Logger writing to \a name in the test directory, keeping debug msgs in the flight recorder
+static Logger *newRecording(CfgLog *cfg, const char *name) {
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, tmpPath(name).c_str(), CfgLog::CMaxPathLen - 1);
+  cfg->profile = CfgLog::ELogProfileNone;
+  cfg->logLevel = CfgLog::ELogInfo;
+  cfg->useRecorder = true;
+  cfg->recorderLevel = CfgLog::ELogDebug;
+  return new Logger(cfg);
+}
+
+/// Loggers sharing the flight recorder dump their own records only
+static void test_recorderScope(void) {
+
+  cleanDir();
+  CfgLog cfgA, cfgB, cfgC;
+  Logger *a = newRecording(&cfgA, "a.log");
+  Logger *b = newRecording(&cfgB, "b.log");
+
+  // both Loggers record from the same threads
+  std::thread other([a, b] {
+    for (int i = 0; i < 50; i++) {
+      a->debug("a thread %d", i);
+      b->debug("b thread %d", i);
+    }
+  });
+  for (int i = 0; i < 50; i++) {
+    a->debug("a main %d", i);
+    b->debug("b main %d", i);
+  }
+  other.join();
+
+  // the alert of one Logger replays its own context, the other still has all of its records
+  a->alert("a alert");
+  CHECK(a->dumpRecorder() == 0);
+  CHECK(b->dumpRecorder() == 100);
+  CHECK(b->dumpRecorder() == 0);
+  b->debug("b later");
+  CHECK(a->dumpRecorder() == 0);
+  CHECK(b->dumpRecorder() == 1);
+  delete a;
+
+  // a new Logger does not inherit the records of a deleted one
+  Logger *c = newRecording(&cfgC, "c.log");
+  CHECK(c->dumpRecorder() == 0);
+  delete c;
+  delete b;
+
+  std::vector<std::string> linesA = splitLines(readFile(tmpPath("a.log")));
+  std::vector<std::string> linesB = splitLines(readFile(tmpPath("b.log")));
+  CHECK((linesA.size() == 101) && (linesA.back() == "a alert"));
+  CHECK(linesB.size() == 101);
+  for (const std::string &l : linesA) CHECK(l[0] == 'a');
+  for (const std::string &l : linesB) CHECK(l[0] == 'b');
+  cleanDir();
+}
+
+/// Check a msg with LogDedup \a d at \a now, returning whether it is suppressed and the summary text if there is one
+static bool dedupCheck(LogDedup *d, const char *msg, uint64_t now, int *cnt, std::string *sum) {
+  LogDedup::summary_t sums[LogDedup::CMaxSummaries];
+  // msgs are keyed on their format string, here the msg itself
+  bool ret = d->check(msg, CfgLog::ELogInfo, msg, strlen(msg), now, sums, cnt);
+  sum->clear();
+  for (int i = 0; i < *cnt; i++) *sum += std::string(sums[i].text, sums[i].len) + ((i + 1 < *cnt) ? "|" : "");
+  return ret;
+}
+
+/// Repeats within the window are summarized when it closes, another msg arrives, a msg takes the slot or expire() runs
+static void test_dedup(void) {
+
+  const int window = 100;
+  int cnt = 0;
+  std::string sum;
+
+  // the window closes with the next occurrence
+  LogDedup *d = new LogDedup(window);
+  CHECK(!dedupCheck(d, "a", 0, &cnt, &sum) && (cnt == 0));
+  CHECK(dedupCheck(d, "a", 10, &cnt, &sum) && (cnt == 0));
+  CHECK(dedupCheck(d, "a", 20, &cnt, &sum) && (cnt == 0));
+  CHECK(!dedupCheck(d, "a", window + 50, &cnt, &sum) && (sum == "last message repeated 2 times: a"));
+  CHECK(dedupCheck(d, "a", window + 60, &cnt, &sum));
+  delete d;
+
+  // two msgs of the same slot and two of different slots, found by their behaviour
+  static char names[400][16];
+  int same = -1, other = -1;
+  for (int i = 1; (i < 400) && ((same < 0) || (other < 0)); i++) {
+    snprintf(names[0], sizeof(names[0]), "msg 0");
+    snprintf(names[i], sizeof(names[i]), "msg %d", i);
+    d = new LogDedup(window);
+    (void)dedupCheck(d, names[0], 0, &cnt, &sum);
+    (void)dedupCheck(d, names[i], 1, &cnt, &sum);
+    // a msg still tracked is suppressed, an evicted one is logged
+    if (dedupCheck(d, names[0], 2, &cnt, &sum)) other = (other < 0) ? i : other;
+    else same = (same < 0) ? i : same;
+    delete d;
+  }
+  CHECK((same > 0) && (other > 0));
+  if ((same < 0) || (other < 0)) return;
+
+  // another msg arriving reports the repeats of the one before, which keeps its slot and window
+  d = new LogDedup(window);
+  CHECK(!dedupCheck(d, names[0], 0, &cnt, &sum));
+  CHECK(dedupCheck(d, names[0], 1, &cnt, &sum));
+  CHECK(!dedupCheck(d, names[other], 2, &cnt, &sum) && (sum == "last message repeated 1 time: msg 0"));
+  CHECK(dedupCheck(d, names[0], 3, &cnt, &sum) && (cnt == 0));
+  CHECK(dedupCheck(d, names[other], 4, &cnt, &sum) && (cnt == 0));
+  delete d;
+
+  // a colliding msg evicts the one in its slot, reporting it once
+  d = new LogDedup(window);
+  CHECK(!dedupCheck(d, names[0], 0, &cnt, &sum));
+  CHECK(dedupCheck(d, names[0], 1, &cnt, &sum));
+  CHECK(dedupCheck(d, names[0], 2, &cnt, &sum));
+  CHECK(!dedupCheck(d, names[same], 3, &cnt, &sum) && (cnt == 1) && (sum == "last message repeated 2 times: msg 0"));
+  CHECK(!dedupCheck(d, names[0], 4, &cnt, &sum) && (cnt == 0));
+  delete d;
+
+  // expire() reports closed windows only, the next occurrence is logged again
+  d = new LogDedup(window);
+  LogDedup::summary_t one;
+  int cursor = 0;
+  CHECK(!d->expiring(window));
+  CHECK(!dedupCheck(d, names[0], 0, &cnt, &sum));
+  CHECK(dedupCheck(d, names[0], 10, &cnt, &sum));
+  CHECK(dedupCheck(d, names[0], 20, &cnt, &sum));
+  CHECK(!dedupCheck(d, names[other], 30, &cnt, &sum) && (cnt == 1));
+  CHECK(dedupCheck(d, names[other], 40, &cnt, &sum));
+  CHECK(!d->expiring(window - 1));
+  CHECK(d->expiring(window + 20));
+  // msg 0 was reported already, the other window is still open and rearms the expiry
+  CHECK(!d->expire(window + 20, &cursor, &one));
+  CHECK(!d->expiring(window + 20));
+  CHECK(d->expiring(window + 30));
+  cursor = 0;
+  CHECK(d->expire(window + 30, &cursor, &one));
+  CHECK((std::string(one.text, one.len) == std::string("last message repeated 1 time: ") + names[other]) && (one.level == CfgLog::ELogInfo));
+  CHECK(!d->expire(window + 30, &cursor, &one));
+  CHECK(!d->expiring(UINT64_MAX - 1));
+  CHECK(!dedupCheck(d, names[other], window + 50, &cnt, &sum) && (cnt == 0));
+  // UINT64_MAX reports open windows as well
+  CHECK(dedupCheck(d, names[other], window + 60, &cnt, &sum));
+  cursor = 0;
+  CHECK(d->expire(UINT64_MAX, &cursor, &one) && (std::string(one.text, one.len) == std::string("last message repeated 1 time: ") + names[other]));
+  CHECK(!d->expire(UINT64_MAX, &cursor, &one));
+  delete d;
+
+  // threads logging two msgs through a Logger: every call is logged or counted in a summary
+  const int threads = 4;
+  const int calls = 5000;
+  cleanDir();
+  std::string path = tmpPath("dedup.log");
+  CfgLog *cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, path.c_str(), CfgLog::CMaxPathLen - 1);
+  cfg->profile = CfgLog::ELogProfileNone;
+  cfg->dedupWindow = 5;
+  Logger *log = new Logger(cfg);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.push_back(std::thread([log, t]() {
+      for (int i = 0; i < calls; i++) {
+        if ((i + t) % 3 == 0) log->info("ping");
+        else log->info("pong");
+      }
+    }));
+  }
+  for (std::thread &w : workers) w.join();
+  delete log;
+  delete cfg;
+
+  long pings = 0, pongs = 0;
+  for (const std::string &line : splitLines(readFile(path))) {
+    int n = 0;
+    size_t pos = line.find(": ");
+    std::string msg = (pos != std::string::npos) ? line.substr(pos + 2) : line;
+    if ((pos != std::string::npos) && (sscanf(line.c_str(), "last message repeated %d time", &n) != 1)) n = -1;
+    else if (pos == std::string::npos) n = 1;
+    if ((n > 0) && (msg == "ping")) pings += n;
+    else if ((n > 0) && (msg == "pong")) pongs += n;
+    else CHECK(false);
+  }
+  long expected = 0;
+  for (int t = 0; t < threads; t++) for (int i = 0; i < calls; i++) expected += ((i + t) % 3 == 0);
+  CHECK(pings == expected);
+  CHECK(pongs == (long)threads * calls - expected);
+  cleanDir();
+}
+
+/// Count the lines starting with \a prefix and add up the reports of suppressed calls among \a lines
+static int countLimited(const std::vector<std::string> &lines, const char *prefix, unsigned *suppressed) {
+  int logged = 0;
+  *suppressed = 0;
+  for (const std::string &line : lines) {
+    unsigned cnt = 0;
+    if (line.compare(0, strlen(prefix), prefix) == 0) logged++;
+    else if (sscanf(line.c_str(), "suppressed %u lines at main.cpp:", &cnt) == 1) *suppressed += cnt;
+  }
+  return logged;
+}
+
+/// Rate limited and sampled call sites, reporting what they suppressed also after going quiet
+static void test_limit(void) {
+
+  const int threads = 4;
+  const int calls = 2000;
+
+  cleanDir();
+  std::string path = tmpPath("limit.log");
+  CfgLog *cfg = new CfgLog();
+  cfg->logToFile = true;
+  strncpy(cfg->logfile, path.c_str(), CfgLog::CMaxPathLen - 1);
+  cfg->profile = CfgLog::ELogProfileNone;
+  cfg->logLevel = CfgLog::ELogInfo;
+  Logger *log = new Logger(cfg);
+  LogChild *child = log->getChild("net");
+  child->setLevel(CfgLog::ELogDebug);
+
+  // a burst starting with a fresh second, then quiet: the timer reports the rest
+  struct timespec ts, start;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &start);
+  do clock_gettime(CLOCK_MONOTONIC_COARSE, &ts); while (ts.tv_sec == start.tv_sec);
+  for (int i = 0; i < 10; i++) LOGGER_INFO_RATE(log, 3, "rate %d", i);
+  for (int i = 0; i < 10; i++) LOGGER_WARNING_SAMPLE(log, 4, "sample %d", i);
+  for (int i = 0; i < 10; i++) LOGGER_DEBUG_SAMPLE(child, 5, "child %d", i);
+  // disabled levels neither log nor count as suppressed
+  for (int i = 0; i < 10; i++) LOGGER_DEBUG_RATE(log, 3, "disabled %d", i);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2 * Logger::CReportMs + 200));
+  log->flush();
+
+  std::vector<std::string> lines = splitLines(readFile(path));
+  unsigned suppressed = 0;
+  CHECK(countLimited(lines, "rate ", &suppressed) == 3);
+  CHECK(countLimited(lines, "sample ", &suppressed) == 3);
+  CHECK(countLimited(lines, "child ", &suppressed) == 2);
+  CHECK(suppressed == 7 + 7 + 8);
+  CHECK(countLimited(lines, "disabled ", &suppressed) == 0);
+  CHECK(lines.size() == 3 + 3 + 2 + 3);
+
+  // racing threads: every call is logged or reported as suppressed, the last ones when the Logger goes
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.push_back(std::thread([log]() {
+      for (int i = 0; i < calls; i++) {
+        LOGGER_INFO_RATE(log, 50, "burst %d", i);
+        if (i % 100 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }));
+  }
+  for (std::thread &w : workers) w.join();
+  delete log;
+  delete cfg;
+
+  lines = splitLines(readFile(path));
+  int logged = countLimited(lines, "burst ", &suppressed);
+  CHECK(logged > 0);
+  CHECK((unsigned)logged + suppressed == 7 + 7 + 8 + threads * calls);
+  cleanDir();
+}
+
+/// number of heap allocations while counting is on
+static std::atomic<long> allocs(0);
+/// count heap allocations
+static std::atomic<bool> counting(false);
+
+extern "C" {
+  extern void *__libc_malloc(size_t size);
+  extern void *__libc_calloc(size_t n, size_t size);
+  extern void *__libc_realloc(void *ptr, size_t size);
+  extern void  __libc_free(void *ptr);
+
+  // operator new comes here as well
+  void *malloc(size_t size) {
+    if (counting.load(std::memory_order_relaxed)) allocs++;
+    return __libc_malloc(size);
+  }
+  void *calloc(size_t n, size_t size) {
+    if (counting.load(std::memory_order_relaxed)) allocs++;
+    return __libc_calloc(n, size);
+  }
+  void *realloc(void *ptr, size_t size) {
+    if (counting.load(std::memory_order_relaxed)) allocs++;
+    return __libc_realloc(ptr, size);
+  }
+  void free(void *ptr) {
+    __libc_free(ptr);
+  }
+}
+
+/// Once the arena has grown, logging short and long lines must not allocate
+static void test_allocations(void) {
+
+  for (int async = 0; async < 2; async++) {
+    cleanDir();
+    std::string path = tmpPath("alloc.log");
+
+    CfgLog *cfg = new CfgLog();
+    cfg->logToFile = true;
+    strncpy(cfg->logfile, path.c_str(), CfgLog::CMaxPathLen - 1);
+    cfg->useAsync = async;
+    Logger *log = new Logger(cfg);
+
+    std::string longMsg(8000, 'x');
+    for (int round = 0; round < 2; round++) {
+      // the first round warms up the arena, the file buffer and the time zone
+      if (round == 1) {
+        allocs = 0;
+        counting = true;
+      }
+      for (int i = 0; i < 1000; i++) {
+        log->info("short line %d", i);
+        log->warning("long line %d %s", i, longMsg.c_str());
+      }
+      counting = false;
+    }
+    long counted = allocs;
+    delete log;
+    delete cfg;
+
+    CHECK(counted == 0);
+    if (counted != 0) fprintf(stderr, "%s: %ld allocations\n", async ? "async" : "sync", counted);
+    CHECK(splitLines(readFile(path)).size() == 4000);
+  }
+  cleanDir();
+}
+
+/// A test and its name
+typedef struct test {
+  const char *name;
+  void (*run)(void);
+} test_t;
+
+static const test_t tests[] = {
+  { "rotation", test_rotation },
+  { "mmap", test_mmap },
+  { "flushInterval", test_flushInterval },
+  { "binarySessions", test_binarySessions },
+  { "binaryCorrupt", test_binaryCorrupt },
+  { "longMessages", test_longMessages },
+  { "allocations", test_allocations },
+  { "fullSlot", test_fullSlot },
+  { "recorderAsync", test_recorderAsync },
+  { "recorderScope", test_recorderScope },
+  { "jsonRoundTrip", test_jsonRoundTrip },
+  { "syslog", test_syslog },
+  { "syslogDelay", test_syslogDelay },
+  { "limit", test_limit },
+  { "dedup", test_dedup },
+  { "children", test_children },
+  { "config", test_config },
+  { "format", test_format },
+};
+
+int main(int argc, char *argv[]) {
+
+  // out [name ...] runs the named tests only
+  strcpy(tmpDir, "/tmp/logger-test-XXXXXX");
+  if (mkdtemp(tmpDir) == NULL) {
+    fprintf(stderr, "Failed to create a test directory: %d\n", errno);
+    return 1;
+  }
+
+  int run = 0;
+  for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+    bool selected = (argc < 2);
+    for (int a = 1; a < argc; a++) selected |= (strcmp(argv[a], tests[i].name) == 0);
+    if (!selected) continue;
+
+    int before = failures;
+    tests[i].run();
+    printf("%-20s %s\n", tests[i].name, (failures == before) ? "ok" : "FAILED");
+    run++;
+  }
+
+  cleanDir();
+  (void)rmdir(tmpDir);
+  printf("%d tests, %d failed checks\n", run, failures);
+  return (failures == 0) ? 0 : 1;
+}